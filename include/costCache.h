@@ -5,6 +5,7 @@
 #include <map>
 #include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <mutex>
 #include <cstdint>
@@ -26,15 +27,36 @@ struct pair_hash {
     };
 };
 
+// new demand 의 cost 를 재사용하는 기본 시간 (s), quote -> 재 quote -> confirm 사이
+#define NEW_DEMAND_CACHE_MAX_AGE    10
+
+// station cache 를 사용할 때 station_id 가 없는 위치를 가까운 station 으로 근사
+#define STATION_APPROX_RADIUS       300.0   // anchor station 을 찾는 거리 (m)
+#define STATION_APPROX_VERIFY_RATIO 20      // 근사할 수 있는 항목 중 1/N 은 실제로 조회해서 정확도를 기록
+
+// station 근사의 정확도 counter (누적)
+struct StationApproxStats {
+    size_t approximatedNodes = 0;   // 근사한 node 수
+    size_t approximatedCells = 0;   // 근사값으로 채운 cell 수
+    size_t verifiedCells = 0;       // 실제 조회한 값과 비교한 cell 수
+    size_t underestimated = 0;      // 근사한 time 이 실제보다 작은 cell 수
+    double timeErrorSum = 0.0;      // |근사 - 실제| / 실제 (time) 의 합
+    double timeErrorMax = 0.0;
+};
+
 class CCostCache {
 public:
     CCostCache(std::chrono::seconds maxAge = std::chrono::seconds(3600));
     virtual ~CCostCache();
 
     void setMaxAge(std::chrono::seconds maxAge);
+    // 0 이면 new demand 를 캐싱하지 않음
+    void setNewDemandMaxAge(std::chrono::seconds maxAge);
     void clear();
     bool checkChangedItem(const ModRequest &modRequest, std::vector<int>& changed);
     void updateCacheAndCost(const ModRequest &modRequest, size_t nodeCount, const std::vector<int>& changed, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix);
+    // changed 항목을 만료 처리 (routing engine 대신 추정값을 사용한 경우)
+    void discardChanged(const ModRequest &modRequest, const std::vector<int>& changed);
 
     friend class CCostCacheTest;
 
@@ -47,9 +69,14 @@ public:
 
     void exportStationCache(const std::string& path);
 
+    // station cache 를 사용할 때 station_id 가 없는 위치를 가까운 anchors 개의 station 으로 근사, 0 이면 사용하지 않음
+    void setStationApproximation(size_t anchors, double radius = STATION_APPROX_RADIUS);
+    StationApproxStats stationApproxStats();
+
 private:
     std::chrono::seconds m_maxAge;
     std::map<std::string, int> m_mapId;
+    std::map<std::string, std::string> m_mapSupply;    // 캐싱할 때의 supplyIdx (배정이 바뀌면 다시 조회)
     std::vector<std::chrono::time_point<std::chrono::steady_clock>> m_expirationTimes;
     std::vector<std::vector<int64_t>> m_distCache;
     std::vector<std::vector<int64_t>> m_timeCache;
@@ -65,13 +92,51 @@ private:
 
     std::unordered_map<std::pair<std::string, std::string>, std::pair<int64_t, int64_t>, pair_hash> m_stationCache;
 
+    // new demand 와 다른 node 사이의 arc (위치 key 기준, 짧은 시간만 유지)
+    struct NewDemandArc {
+        int64_t dist;
+        int64_t time;
+        std::chrono::steady_clock::time_point expiration;
+    };
+    std::chrono::seconds m_newDemandMaxAge{NEW_DEMAND_CACHE_MAX_AGE};
+    std::unordered_map<std::pair<std::string, std::string>, NewDemandArc, pair_hash> m_newDemandArcs;
+
+    /*
+    station 근사
+    요청에 나온 station 의 좌표를 기억해 두고, station_id 가 없는 위치 P 는 radius 안의 가까운 station 들을 anchor 로 사용
+    P -> X 는 min(P -> S (추정) + S -> X (station cache)), X -> P 도 같은 방식 (last-mile 구간은 g_costEstimator 로 추정)
+    */
+    struct StationAnchor {
+        std::string station;
+        int64_t outDist;    // P -> station
+        int64_t outTime;
+        int64_t inDist;     // station -> P
+        int64_t inTime;
+    };
+    size_t m_approxAnchors = 0;
+    double m_approxRadius = STATION_APPROX_RADIUS;
+    std::unordered_map<std::string, Location> m_stationLocs;
+    std::unordered_set<std::string> m_approxVerifyKeys;    // 근사하지 않고 조회해서 정확도를 확인할 위치 key
+    size_t m_approxCandidates = 0;
+    StationApproxStats m_approxStats;
+
+    std::vector<StationAnchor> findStationAnchors(const Location& loc);
+    bool approximateArc(const std::vector<StationAnchor>& from, const std::vector<StationAnchor>& to, int64_t& dist, int64_t& time);
+
     bool checkForStationCache(const ModRequest &modRequest, std::vector<int>& changed);
     void updateForStationCache(const ModRequest &modRequest, size_t nodeCount, const std::vector<int>& changed, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix);
 
+    bool isSupplyChanged(const std::string& id, const std::string& supplyIdx);
     bool checkForLocalCache(const ModRequest &modRequest, std::vector<int>& changed);
     void updateForLocalCache(const ModRequest &modRequest, size_t nodeCount, const std::vector<int>& changed, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix);
+
+    bool isNewDemandCached(const std::vector<std::string>& nodeKeys, const std::vector<char>& queried, size_t newDemandNode, std::chrono::steady_clock::time_point now);
+    void updateForNewDemandCache(const ModRequest &modRequest, size_t nodeCount, const std::vector<int>& changed, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix);
 };
 
+// new demand cache 에서 사용하는 위치 key (station_id 가 있으면 station, 없으면 좌표)
+std::string makeLocationKey(const Location& loc);
+
 struct order_hash {
     std::size_t operator()(const std::pair<std::string, int>& p) const {
         std::size_t h1 = std::hash<std::string>{}(p.first);
@@ -93,6 +158,8 @@ inline std::pair<std::string, int> makeStationKey(const std::string& stationId,
 void pushStationToIdx(StationToIdxMap& stationToIdx, const std::string& stationId, int direction, int idx);
 
 #define CHECK_COST_VEHICLE_ONLY_ASSIGNED
+// 서로 다른 vehicle 에 고정된 onboard, waiting node 사이의 arc 는 조회하지 않고 INT_MAX 로 채움
+#define CHECK_COST_FIXED_ASSIGNMENT
 
 int updateFromVehicleCostMatrixWithStationCache(
     const ModRequest& modRequest,
@@ -0,0 +1,100 @@
+#ifndef _INC_COST_ESTIMATOR_HDR
+#define _INC_COST_ESTIMATOR_HDR
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <mod_parameters.h>
+
+// routing engine 이 budget 을 넘기거나 응답하지 않을 때 사용하는 추정 정책 (main 의 command line 으로 설정)
+struct CostEstimatePolicy {
+    bool enabled = true;            // false 이면 예전처럼 cost 조회 실패
+    double detourFactor = 1.3;      // 관측값이 없을 때 사용하는 직선 거리 대비 도로 거리 비율
+    double speed = 8.0;             // 관측값이 없을 때 사용하는 속도 (m/s)
+    int breakerFailures = 3;        // 연속으로 실패하면 routing engine 조회를 중단하는 횟수
+    int breakerCooldown = 10000;    // 조회 중단 후 다시 시도하기까지의 시간 (ms)
+};
+
+extern CostEstimatePolicy g_costEstimatePolicy;
+
+// 두 좌표 사이의 직선 거리 (m)
+double haversineDistance(const Location& from, const Location& to);
+
+// 최근 routing engine 응답으로 region 별 detour factor, 속도를 보정하는 추정기
+class CCostEstimator {
+public:
+    void observe(const Location& from, const Location& to, int64_t dist, int64_t time);
+    void estimate(const Location& from, const Location& to, int64_t& dist, int64_t& time);
+
+private:
+    struct RegionModel {
+        double detour = 0.0;
+        double speed = 0.0;
+        size_t samples = 0;
+    };
+
+    static int64_t regionKey(const Location& loc);
+    static void update(RegionModel& model, double detour, double speed);
+
+    std::mutex m_mutex;
+    RegionModel m_global;
+    std::unordered_map<int64_t, RegionModel> m_regions;
+};
+
+extern CCostEstimator g_costEstimator;
+
+// routing backend 별 circuit breaker
+// 연속 실패가 breakerFailures 번이면 open, cooldown 이 지나면 한 요청만 통과시켜(half open) 결과로 close/open 결정
+// 성공/실패는 backend 로 보낸 tile 요청마다 기록 (CRouteBackend)
+class CCircuitBreaker {
+public:
+    enum State { CLOSED, OPEN, HALF_OPEN };
+
+    // half open 이면 한 요청(probe)만 허용, 허용한 요청은 record* 또는 releaseProbe 로 끝내야 함
+    bool allowRequest();
+    void recordSuccess();
+    void recordFailure();
+    // 결과를 판단할 수 없이 끝난 요청 (4xx, 취소) 의 probe 를 반납
+    void releaseProbe();
+    void reset();
+    // cooldown 이 지난 open 은 half open 으로 보고함 (probe 는 잡지 않음)
+    State state();
+
+private:
+    std::mutex m_mutex;
+    State m_state = CLOSED;
+    int m_failures = 0;
+    bool m_probing = false;
+    std::chrono::steady_clock::time_point m_openedAt;
+};
+
+// backend url 별 circuit breaker (같은 backend 를 여러 route path 에 지정해도 하나를 공유)
+CCircuitBreaker& getCircuitBreaker(const std::string& url);
+
+// 모든 circuit breaker 를 close 로 초기화 (reset API)
+void resetCircuitBreakers();
+
+// tile 의 모든 cell 을 추정값으로 채우고 추정한 cell 수를 반환
+size_t estimateCostTile(
+    const std::vector<Location>& locs,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+// 조회에 성공한 tile 에서 일부 cell 을 골라 추정기를 보정
+void observeCostTile(
+    const std::vector<Location>& locs,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    const std::vector<int64_t>& distMatrix,
+    const std::vector<int64_t>& timeMatrix);
+
+#endif // _INC_COST_ESTIMATOR_HDR
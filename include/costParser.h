@@ -0,0 +1,56 @@
+#ifndef _INC_COST_PARSER_HDR
+#define _INC_COST_PARSER_HDR
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// routing engine 응답 전용 streaming parser
+// DOM을 만들지 않고 응답 body를 한번만 scan 하면서 dist/time matrix 에 바로 값을 기록한다
+// sources/destinations 는 tile 에서 사용한 node index (baseVehicle 적용 전)
+
+void parseOsrmTable(
+    const char *begin,
+    const char *end,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+void parseValhallaMatrix(
+    const char *begin,
+    const char *end,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+inline void parseOsrmTable(
+    const std::string& body,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    parseOsrmTable(body.data(), body.data() + body.size(), baseVehicle, nodeCount, sources, destinations, distMatrix, timeMatrix);
+}
+
+inline void parseValhallaMatrix(
+    const std::string& body,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    parseValhallaMatrix(body.data(), body.data() + body.size(), baseVehicle, nodeCount, sources, destinations, distMatrix, timeMatrix);
+}
+
+#endif // _INC_COST_PARSER_HDR
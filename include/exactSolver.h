@@ -0,0 +1,27 @@
+#ifndef _INC_EXACT_SOLVER_HDR
+#define _INC_EXACT_SOLVER_HDR
+
+#include <vector>
+#include <cstdint>
+#include <solverPortfolio.h>
+
+#define EXACT_MAX_REQUESTS          16      // exact 탐색에서 다루는 최대 demand 수 (vehicle 별 demand 집합을 bit 로 표현)
+#define EXACT_POLISH_ITERATIONS     1       // exact route 로 Solution 을 만들 때의 LNS 반복 횟수
+
+/*
+작은 요청 (node 수가 SolvePolicy::exactMaxNodes 이하) 의 exact 탐색
+- demand (pickup-delivery, onboard 는 delivery 만) 를 fixedAssignment 가 허용하는 vehicle 에 배정하는 모든 조합을 보고
+  vehicle 마다 배정된 demand 집합의 가장 좋은 순서를 pickup -> delivery 순서를 지키며 branch-and-bound 로 찾음 (집합별로 memo)
+- latestArrival, capacity 를 지키지 못하면 사용하지 않고, 점수는 route cost + acceptableArrival 을 넘긴 시간 * delaytime_penalty
+  + earliestArrival 보다 먼저 도착해서 기다린 시간 * waittime_penalty
+- 모든 demand 를 배정할 수 없으면 찾지 못한 것으로 보고 LNS 로 풂
+*/
+
+// 가장 좋은 route 를 initialSolution 형식 ([vehicle, stop..., 0] 반복) 으로 반환, 찾지 못하면 빈 vector
+std::vector<int> solveExactRoutes(const SolveInput& input, const AlgorithmParameters* ap, int64_t* score = nullptr);
+
+// exact route 를 initialSolution 으로 solve_lns_pdptw 를 EXACT_POLISH_ITERATIONS 만 돌려서 Solution 을 만듦
+// (Solution 은 library 가 할당/삭제), 찾지 못하면 nullptr
+Solution* solveExact(const SolveInput& input, const AlgorithmParameters* ap, bool showLog);
+
+#endif // _INC_EXACT_SOLVER_HDR
@@ -0,0 +1,93 @@
+#ifndef _INC_INSERTION_EVALUATOR_HDR
+#define _INC_INSERTION_EVALUATOR_HDR
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class CModState;
+
+#define INSERTION_BATCH_CHUNK   8   // evaluateBatch 에서 한 작업이 평가하는 pickup 수
+
+// new demand (pickup, delivery) 를 vehicle 의 현재 route 에 넣는 방법 하나
+struct InsertionOption {
+    int vehicle = -1;           // 0 부터 시작하는 vehicle index
+    int pickupPos = 0;          // route 의 이 위치 (0 = vehicle) 다음에 pickup
+    int deliveryPos = 0;        // route 의 이 위치 다음에 delivery (pickupPos 와 같으면 pickup 바로 다음)
+    int64_t costDelta = 0;      // route cost 증가량
+    int64_t pickupArrival = 0;
+    int64_t deliveryArrival = 0;
+    bool acceptable = true;     // pickup, delivery 모두 acceptableArrival 안에 도착
+};
+
+/*
+modState.initialSolution 의 route (assigned 가 없는 vehicle 은 빈 route) 에 new demand 를 넣는 위치를 평가
+- route 마다 도착 시간, 출발 시간, 탑승 인원, 뒤의 stop 들이 늦어지지 않고 미룰 수 있는 시간 (forward slack) 을 미리 계산하고
+  pickup 위치마다 delivery 위치를 늘려가며 route 를 다시 계산하지 않고 평가 (route 길이 L 에 대해 vehicle 당 O(L^2))
+- latestArrival, capacity, fixedAssignment (고정/제외 vehicle) 를 지키는 위치만 사용
+- 이미 latestArrival 을 넘긴 stop 은 원래 도착 시간보다 늦어지지 않는 경우만 허용
+*/
+class CInsertionEvaluator {
+public:
+    struct RouteState {
+        std::vector<int> nodes;
+        std::vector<int64_t> arrival;   // 갈 수 없는 arc 뒤는 INT_MAX
+        std::vector<int64_t> departure;
+        std::vector<int64_t> load;      // node 를 떠날 때의 탑승 인원
+        std::vector<int64_t> slack;     // node 의 도착 시간을 미룰 수 있는 시간
+    };
+
+    CInsertionEvaluator(
+        const CModState& modState,
+        size_t nodeCount,
+        size_t vehicleCount,
+        const std::vector<int64_t>& costMatrix,
+        const std::vector<int64_t>& timeMatrix);
+
+    // pickup node (delivery 는 deliverySibling) 를 넣는 방법 중 좋은 순서로 limit 개 (0 이면 모두)
+    // bestPerVehicle 이면 vehicle 마다 가장 좋은 방법 하나만
+    std::vector<InsertionOption> evaluate(int pickup, size_t limit, bool bestPerVehicle) const;
+
+    // pickups 를 각각 (다른 pickup 없이 현재 route 에 넣는 경우) evaluate 해서 같은 순서로 반환
+    // INSERTION_BATCH_CHUNK 개씩 나눠서 호출한 thread 와 solver pool (solverPortfolio.h) 에서 동시에 평가
+    std::vector<std::vector<InsertionOption>> evaluateBatch(const std::vector<int>& pickups, size_t limit, bool bestPerVehicle) const;
+
+    // 평가한 route (vehicle 마다 vehicle node 로 시작해서 0 으로 끝남)
+    const std::vector<int>& route(size_t vehicle) const { return m_routes[vehicle].nodes; }
+    const RouteState& routeState(size_t vehicle) const { return m_routes[vehicle]; }
+
+private:
+    int64_t cost(int from, int to) const { return m_cost[from * (m_nodeCount + 1) + to]; }
+    int64_t travel(int from, int to) const { return m_time[from * (m_nodeCount + 1) + to]; }
+    bool allowed(int node, size_t vehicle) const;
+    void buildRoute(size_t vehicle, std::vector<int> nodes);
+    void evaluateRoute(size_t vehicle, int pickup, int delivery, std::vector<InsertionOption>& options, bool bestOnly) const;
+
+    const CModState& m_modState;
+    size_t m_nodeCount;
+    size_t m_vehicleCount;
+    const std::vector<int64_t>& m_cost;
+    const std::vector<int64_t>& m_time;
+    std::vector<RouteState> m_routes;
+};
+
+// fixedAssignment 값 (양수는 고정 vehicle, 음수는 제외한 vehicle 목록) 으로 vehicle 에 배정할 수 있는지
+bool isVehicleAllowed(int fixedAssignment, size_t vehicle, size_t vehicleCount);
+
+// 좋은 순서로 정렬할 때의 비교 (acceptable 우선, cost 증가량이 작은 순서)
+bool isBetterInsertion(const InsertionOption& a, const InsertionOption& b);
+
+/*
+max_solution_number 의 alternative 를 동시에 풀기 위해 미리 만드는 modState
+alternative k (1 부터) 는 new demand 마다 insertion 이 좋은 vehicle 순서로 k 개를 fixedAssignment 에서 제외
+(순차로 풀 때 이전 solution 이 사용한 vehicle 을 제외하는 것을 insertion 순위로 예상)
+제외할 vehicle 이 더 없는 alternative 부터는 만들지 않음
+*/
+std::vector<CModState> makeAlternativeStates(
+    const CModState& modState,
+    const CInsertionEvaluator& evaluator,
+    size_t vehicleCount,
+    size_t baseNewDemand,
+    size_t alternatives);
+
+#endif // _INC_INSERTION_EVALUATOR_HDR
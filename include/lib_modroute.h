@@ -18,6 +18,7 @@ struct ModDispatchSolution {
     std::vector<ModRoute> unacceptables;
     int64_t total_distance;
     int64_t total_time;
+    size_t estimated_cells = 0;     // routing engine 대신 추정값을 사용한 cost matrix cell 수 (요청의 모든 solution 이 같은 값)
 };
 
 std::vector<ModDispatchSolution> run_optimize(
@@ -29,6 +30,21 @@ std::vector<ModDispatchSolution> run_optimize(
     struct AlgorithmParameters* ap,
     struct ModRouteConfiguration& conf);
 
+// assigned route 를 solver 없이 평가 (도착 시간, slack, 탑승 인원, time window 위반)
+std::vector<ModRouteEvaluation> evaluate_routes(
+    ModRequest& mod_request,
+    std::string& route_path,
+    RouteType route_type,
+    int route_tasks,
+    std::string& cache_path,
+    struct ModRouteConfiguration& conf);
+
 void clear_cache();
 
+// 위치 update (telemetry) 를 받은 vehicle 의 row 를 background 에서 미리 조회, 처리를 기다리는 vehicle 수를 반환
+size_t update_vehicles(
+    std::vector<VehicleLocation>& vehicles,
+    std::string& route_path,
+    RouteType route_type);
+
 #endif // _INC_LIB_MODROUTE_HDR
@@ -30,6 +30,9 @@ struct ModRequest {
     std::string locHash;
     std::optional<std::string> dateTime;
     int maxDuration = 0;
+    int maxOptions = 0;     // quote 에서 new demand 마다 반환하는 insertion 수 (0 이면 QUOTE_DEFAULT_OPTIONS)
+    bool independentNewDemands = false;  // new demand 를 서로 독립된 후보로 평가 (quote, what-if), 다른 new demand 사이의 arc 는 조회하지 않음
+    bool routeArcsOnly = false;         // assigned route 를 그대로 평가 (evaluate), route 의 연속한 stop 사이 arc 만 조회
 
     ModRequest() = default;
 };
@@ -44,6 +47,31 @@ struct ModCacheRequest {
     std::string cacheKey;
 };
 
+// runOptimize 처리 중에 수집한 정보
+struct ModOptimizeStats {
+    size_t estimatedCells = 0;  // routing engine 대신 추정값으로 채운 cell 수
+};
+
+#define QUOTE_DEFAULT_OPTIONS   3
+
+// 현재 assigned route 에 new demand 를 넣는 방법 하나
+struct ModInsertionOption {
+    std::string supplyIdx;
+    int pickupIndex = 0;        // route 의 이 위치 (0 = vehicle, 1 부터 assigned 의 stop) 다음에 pickup
+    int destinationIndex = 0;   // route 의 이 위치 다음에 drop off (pickupIndex 와 같으면 pickup 바로 다음)
+    int64_t costDelta = 0;
+    int64_t pickupEta = 0;
+    int64_t destinationEta = 0;
+    bool acceptable = true;
+};
+
+// new demand 하나의 quote (options 가 비어 있으면 현재 route 에 넣을 수 없음)
+struct ModQuote {
+    std::string id;
+    int demand = 0;
+    std::vector<ModInsertionOption> options;
+};
+
 std::unordered_map<int, ModRoute> makeNodeToModRoute(const ModRequest& modRequest, const size_t vehicleCount);
 
 std::vector<Solution *> runOptimize(
@@ -54,6 +82,61 @@ std::vector<Solution *> runOptimize(
     std::unordered_map<int, ModRoute> mapNodeToModRoute,
     const struct AlgorithmParameters* ap,
     const struct ModRouteConfiguration& conf,
-    bool showLog);
+    bool showLog,
+    ModOptimizeStats* stats = nullptr);
+
+/*
+다시 최적화하지 않고 new demand 마다 현재 assigned route 에 넣는 위치를 모두 평가해서 좋은 순서로 maxOptions 개 반환
+- new demand 는 서로 영향을 주지 않고 각각 평가 (CInsertionEvaluator::evaluateBatch 로 동시에)
+- cost matrix 는 모든 new demand 를 합쳐서 한번만 만듦 (what-if 는 new demand 를 후보 trip 으로 사용하고 maxOptions 를 1 로 호출)
+- OSRM, Valhalla 는 new demand 의 start_loc, destination_loc 사이와 기존 node 와의 arc 만 조회하고, 다른 new demand 사이의 arc 는 INT_MAX (independentNewDemands)
+*/
+std::vector<ModQuote> runQuote(
+    ModRequest& modRequest,
+    std::string& sRoutePath,
+    RouteType eRouteType,
+    int nRouteTasks,
+    const struct ModRouteConfiguration& conf,
+    bool showLog,
+    ModOptimizeStats* stats = nullptr);
+
+// assigned route 의 stop 하나의 평가
+struct ModStopEvaluation {
+    ModRoute route;
+    int64_t arrival = 0;
+    int64_t departure = 0;
+    int64_t slack = 0;          // 뒤의 stop 들이 늦어지지 않고 이 stop 의 도착을 미룰 수 있는 시간
+    int64_t load = 0;           // stop 을 떠날 때의 탑승 인원
+    bool late = false;          // latestArrival (time window) 초과
+    bool unacceptable = false;  // acceptableArrival 초과
+};
+
+// assigned route 하나의 평가 (solver 를 사용하지 않음)
+struct ModRouteEvaluation {
+    std::string supplyIdx;
+    std::vector<ModStopEvaluation> stops;
+    int64_t distance = 0;
+    int64_t time = 0;
+    bool overCapacity = false;
+    bool unreachable = false;   // 갈 수 없는 arc 가 있어서 이후 도착 시간을 모름
+    bool lateEnd = false;       // 마지막 stop 을 마치는 시간이 vehicle 의 operation_time 종료 이후
+    int64_t endTime = 0;        // 마지막 stop 을 마치고 운행을 끝내는 시간 (ghost depot 도착)
+    bool feasible = true;       // late, overCapacity, unreachable, lateEnd 가 모두 없음
+};
+
+/*
+assigned route 를 그대로 따라갈 때의 도착 시간, slack, 탑승 인원, time window 위반을 계산 (ETA)
+- new demand 는 사용하지 않으므로 cost matrix 는 vehicle -> 첫 stop 과 route 의 연속한 stop 사이 arc 만 조회
+  (route_times 로 알고 있는 arc 는 조회하지 않음)
+- 마지막 stop 이후 운행 종료 (ghost depot) 가 operation_time 종료를 넘으면 lateEnd
+*/
+std::vector<ModRouteEvaluation> runEvaluateRoutes(
+    ModRequest& modRequest,
+    std::string& sRoutePath,
+    RouteType eRouteType,
+    int nRouteTasks,
+    const struct ModRouteConfiguration& conf,
+    bool showLog,
+    ModOptimizeStats* stats = nullptr);
 
 #endif // _INC_LNSMODROUTE_HDR
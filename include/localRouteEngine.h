@@ -0,0 +1,59 @@
+#ifndef _INC_LOCAL_ROUTE_ENGINE_HDR
+#define _INC_LOCAL_ROUTE_ENGINE_HDR
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <mod_parameters.h>
+
+/*
+process 내에서 동작하는 routing engine (ROUTE_LOCAL)
+서비스 지역의 도로 graph 파일을 읽어서 many-to-many table 을 계산한다
+
+graph 파일 형식 (text, node id 는 0 부터 순서대로)
+  <node 수> <edge 수>
+  <lat> <lng>                         : node 수 만큼
+  <from> <to> <distance(m)> <time(s)> : edge 수 만큼 (단방향)
+*/
+class CLocalRouteEngine {
+public:
+    void load(const std::string& path);
+
+    size_t nodeCount() const { return m_lat.size(); }
+
+    // 가장 가까운 graph node 와 직선 거리(m), graph 가 비어있으면 -1
+    int snap(const Location& loc, double& snapDistance) const;
+
+    // sources x destinations table 을 threadCount 개의 thread 로 계산
+    // 결과는 row major (sources.size() x destinations.size()), 도달 불가능하면 INT_MAX
+    void table(
+        const std::vector<Location>& sources,
+        const std::vector<Location>& destinations,
+        size_t threadCount,
+        std::vector<int64_t>& distTable,
+        std::vector<int64_t>& timeTable) const;
+
+private:
+    struct Edge {
+        int to;
+        int64_t dist;
+        int64_t time;
+    };
+
+    int64_t gridKey(int latIdx, int lngIdx) const;
+
+    std::vector<double> m_lat;
+    std::vector<double> m_lng;
+    std::vector<size_t> m_offsets;      // CSR
+    std::vector<Edge> m_edges;
+
+    std::vector<int64_t> m_gridKeys;    // 정렬된 grid cell key
+    std::vector<size_t> m_gridOffsets;
+    std::vector<int> m_gridNodes;
+};
+
+// graph 파일 별로 한번만 읽어서 공유
+std::shared_ptr<const CLocalRouteEngine> getLocalRouteEngine(const std::string& path);
+
+#endif // _INC_LOCAL_ROUTE_ENGINE_HDR
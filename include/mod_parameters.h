@@ -96,6 +96,7 @@ struct ModRouteConfiguration {
 enum RouteType {
     ROUTE_OSRM = 0,
     ROUTE_VALHALLA = 1,
+    ROUTE_LOCAL = 2,        // route path 에 도로 graph 파일을 지정, process 내에서 계산
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,101 @@
+#ifndef _INC_OBSERVED_ARCS_HDR
+#define _INC_OBSERVED_ARCS_HDR
+
+#include <vector>
+#include <list>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+struct ModRequest;
+struct AssignedArc;
+
+#define OBSERVED_ARC_BUCKET_HOURS   2       // 시간대 bucket 크기 (시간)
+#define OBSERVED_ARC_BUCKETS        (24 / OBSERVED_ARC_BUCKET_HOURS)
+#define OBSERVED_ARC_EWMA_ALPHA     0.2     // 관측값을 반영하는 비율
+#define OBSERVED_ARC_MAX_ENTRIES    200000  // 보관하는 위치 쌍의 최대 수
+
+/*
+client 가 assigned 의 route_times/route_distances 로 보내는 실제 이동 시간/거리를 위치 쌍별로 보관
+- key 는 위치 key (makeLocationKey) 쌍, 값은 시간대 bucket 별 EWMA 와 전체 시간대 EWMA
+- vehicle 위치에서 출발하는 arc 는 vehicle 이 계속 움직이므로 보관하지 않음 (stop -> stop 만 보관)
+- 같은 vehicle 의 같은 demand stop 쌍 (관측 id) 을 같은 값으로 다시 보내면 (같은 assigned 를 다시 보낸 요청) 표본으로 세지 않음
+- 조회할 때는 요청 시간대 bucket 의 표본이 부족하면 전체 시간대 값을 사용
+- 위치 쌍, 관측 id 가 OBSERVED_ARC_MAX_ENTRIES 를 넘으면 가장 오래 전에 갱신한 것부터 지움
+*/
+class CObservedArcStore {
+public:
+    struct Stats {
+        size_t recorded = 0;    // 보관한 관측 수
+        size_t applied = 0;     // matrix 에 관측값을 사용한 cell 수
+        size_t pairs = 0;       // 보관 중인 위치 쌍 수
+    };
+
+    // observation 은 관측 id (vehicle, demand stop 쌍), 이미 같은 값으로 보관한 관측이면 무시
+    void record(const std::string& fromKey, const std::string& toKey, int bucket, int64_t dist, int64_t time, const std::string& observation);
+
+    // minSamples 이상 관측한 값이 있으면 true
+    bool lookup(const std::string& fromKey, const std::string& toKey, int bucket, size_t minSamples, int64_t& dist, int64_t& time);
+
+    // fromKey 에서 출발하는 관측값이 있는 위치 key 목록
+    std::vector<std::string> destinations(const std::string& fromKey);
+
+    void addApplied(size_t cells);
+    Stats stats();
+    void clear();
+
+private:
+    struct Sample {
+        double dist = 0.0;
+        double time = 0.0;
+        size_t samples = 0;
+        std::chrono::steady_clock::time_point updated;
+    };
+    using PairOrder = std::list<std::pair<std::string, std::string>>;
+    struct Entry {
+        Sample all;
+        Sample buckets[OBSERVED_ARC_BUCKETS];
+        PairOrder::iterator order;      // m_pairOrder 의 위치
+    };
+    struct Observation {
+        int64_t dist;
+        int64_t time;
+        std::list<std::string>::iterator order;     // m_observationOrder 의 위치
+    };
+
+    static void update(Sample& sample, int64_t dist, int64_t time, std::chrono::steady_clock::time_point now);
+    static bool usable(const Sample& sample, size_t minSamples, std::chrono::steady_clock::time_point now);
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::unordered_map<std::string, Entry>> m_entries;
+    PairOrder m_pairOrder;                                          // 갱신한 순서 (앞이 가장 오래됨)
+    std::unordered_map<std::string, Observation> m_observations;    // 관측 id -> 마지막으로 보관한 (dist, time)
+    std::list<std::string> m_observationOrder;
+    size_t m_pairs = 0;
+    Stats m_stats;
+};
+
+extern CObservedArcStore g_observedArcs;
+
+// 요청 date_time 의 시간대 bucket (없으면 현재 local 시간)
+int observedArcBucket(const std::optional<std::string>& dateTime);
+
+// assigned 의 stop -> stop arc 를 보관하고 cost 추정기 보정에도 사용
+void recordObservedArcs(const ModRequest& modRequest, const std::vector<AssignedArc>& arcs);
+
+// observedMinSamples 이상 관측한 stop -> stop arc (ghost depot 을 제외한 node index)
+// 조회 전에 matrix 에 채우고 query planner 의 known arc 로 넘겨서 tile 에서 제외
+std::vector<AssignedArc> collectObservedArcs(const ModRequest& modRequest, size_t nodeCount);
+
+// 관측값이 있는 stop -> stop cell 을 관측값으로 채우고 채운 cell 수를 반환 (조회한 tile 이 덮어쓴 값을 다시 채움)
+size_t applyObservedArcs(
+    const ModRequest& modRequest,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+#endif // _INC_OBSERVED_ARCS_HDR
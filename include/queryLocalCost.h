@@ -0,0 +1,22 @@
+#ifndef _INC_QUERY_LOCAL_COST_HDR
+#define _INC_QUERY_LOCAL_COST_HDR
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <lnsModRoute.h>
+
+// graphPath 의 도로 graph 로 process 내에서 cost matrix 계산
+int queryCostLocal(
+    const ModRequest& modRequest,
+    const std::string& graphPath,
+    const int nRouteTasks,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix,
+    bool showLog);
+
+// 요청 사이에 보관하는 값 (관측값, snap 결과) 을 지움
+int queryCostLocalReset();
+
+#endif // _INC_QUERY_LOCAL_COST_HDR
@@ -8,6 +8,14 @@
 
 int queryCostOsrmReset();
 
+// 위치 update (telemetry) 를 받은 vehicle 의 row 를 미리 조회해서 vehicle row cache 에 보관, 조회한 vehicle 수를 반환
+size_t prefetchVehicleRowsOsrm(
+    const ModRequest& telemetry,
+    const std::string& routePath,
+    const size_t routeTasks,
+    bool showLog);
+
+// routing engine 대신 추정값으로 채운 cell 수를 반환
 int queryCostOsrm(
     const ModRequest& modRequest,
     const std::string& routePath,
@@ -0,0 +1,362 @@
+#ifndef _INC_QUERY_PLANNER_HDR
+#define _INC_QUERY_PLANNER_HDR
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <string>
+#include <utility>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+
+struct ModRequest;
+struct NewDemand;
+struct Location;
+
+// query planner 정책 (main 의 command line 으로 설정)
+struct QueryPlanPolicy {
+    int candidateVehicles = 50;     // new demand 마다 vehicle 에서 조회할 가까운 vehicle 수, 0 이면 모든 vehicle
+    double pruneSpeed = 30.0;       // 직선 거리로 불가능한 arc 를 판단할 때의 최대 속도 (m/s), 0 이면 사용하지 않음
+    double dedupRadius = 5.0;       // station 이 없는 위치를 같은 위치로 묶는 좌표 양자화 크기 (m), 0 이면 사용하지 않음
+    double rowReuseRadius = 30.0;   // vehicle 이 이 거리 (m) 안에서 움직였으면 이전에 조회한 row 를 재사용, 0 이면 사용하지 않음
+    double rowReuseAlong = 150.0;   // heading 방향으로 이 거리 (m) 안에서 앞으로 움직인 경우도 재사용, 0 이면 사용하지 않음
+    int rowReuseHeading = 30;       // 같은 heading 으로 판단하는 각도 차이 (degree)
+    int rowReuseMaxAge = 60;        // 재사용하는 row 의 최대 시간 (s)
+    double snapCell = 5.0;          // 이 거리 (m) 안에서 조회한 snap-to-road 결과를 재사용, 0 이면 snap 하지 않음
+    int prefetchIdle = 600;         // 마지막 optimize 요청 이후 위치 update 로 row 를 미리 조회하는 시간 (s), 0 이면 사용하지 않음
+    int observedMinSamples = 3;     // route_times 로 관측한 stop -> stop 값을 사용하는 최소 관측 수, 0 이면 사용하지 않음
+    int observedMaxAge = 604800;    // 관측값을 사용하는 최대 시간 (s), 0 이면 제한 없음
+};
+
+extern QueryPlanPolicy g_queryPlanPolicy;
+
+// 묶은 tile 에서 허용하는 추가 cell 의 비율 (필요한 cell 수 대비)
+#define VEHICLE_ROW_MAX_EXTRA_RATIO     1.0
+
+// vehicle 한 대에서 조회해야 하는 row
+struct VehicleRow {
+    int source;
+    std::vector<int> destinations;  // 정렬, 중복 없음
+};
+
+// 여러 vehicle row 를 묶은 multi-source tile (sources x destinations)
+struct VehicleRowGroup {
+    std::vector<int> sources;
+    std::vector<int> destinations;  // 묶인 row 들의 destination 합집합 (정렬)
+    size_t neededCells = 0;         // 묶기 전 row 들의 cell 수 합
+};
+
+/*
+destination 이 많이 겹치는 vehicle row 들을 multi-source tile 로 묶는다
+묶은 tile 의 cell 수 (sources x destinations 합집합) 가 필요한 cell 수의 (1 + maxExtraRatio) 배를 넘지 않는
+group 중 추가 cell 이 가장 적은 group 에 넣고, 없으면 새 group 을 만든다
+*/
+std::vector<VehicleRowGroup> groupVehicleRows(
+    std::vector<VehicleRow> rows,
+    size_t maxSources,
+    double maxExtraRatio = VEHICLE_ROW_MAX_EXTRA_RATIO);
+
+// assigned 의 route_times/route_distances 로 이미 알고 있는 arc
+// from, to 는 ghost depot 을 제외한 node index, 값이 음수이면 모르는 값
+struct AssignedArc {
+    int from;
+    int to;
+    int64_t time;
+    int64_t dist;
+    int vehicle = -1;   // route 의 vehicle node index
+};
+
+std::vector<AssignedArc> collectAssignedArcs(const ModRequest& modRequest);
+
+// assigned 의 route_order 를 따라가는 모든 arc (vehicle -> 첫 stop 포함), route_times 가 없으면 time, dist 는 -1
+std::vector<AssignedArc> collectRouteArcs(const ModRequest& modRequest);
+
+void applyAssignedArcs(
+    const std::vector<AssignedArc>& arcs,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+// time, distance 를 모두 알고 있어서 조회하지 않아도 되는 arc 의 key 집합
+std::unordered_set<int64_t> knownArcKeys(const std::vector<AssignedArc>& arcs, size_t nodeCount);
+
+/*
+fixedAssignment 로 vehicle 이 고정된 node 사이의 arc 필터링
+onboard, waiting node 는 supplyIdx 의 vehicle 에서만 방문하므로 서로 다른 vehicle 에 고정된 node 사이의 arc 는
+solver 가 사용할 수 없어서 조회하지 않고 INT_MAX 로 채운다
+*/
+
+// node 별로 고정된 vehicle index (ghost depot 을 제외한 node index 기준)
+// vehicle node 는 자기 자신, new demand 또는 vehicle 을 찾을 수 없는 node 는 -1
+std::vector<int> fixedNodeVehicles(const ModRequest& modRequest, size_t nodeCount);
+
+// station 으로 묶인 대표 node 기준으로 고정 vehicle 을 합침
+// 대표 node 가 여러 vehicle 이나 new demand 를 대표하면 -1 (모든 arc 조회)
+std::vector<int> mergeNodeVehicles(const std::vector<int>& nodeVehicles, const std::vector<int>& representative);
+
+inline bool isArcReachable(const std::vector<int>& nodeVehicles, int from, int to)
+{
+    return nodeVehicles[from] < 0 || nodeVehicles[to] < 0 || nodeVehicles[from] == nodeVehicles[to];
+}
+
+/*
+직선 거리 lower bound 로 시간 안에 도착할 수 없는 arc 제외
+source 의 가장 빠른 출발 시간 + 직선 거리 / pruneSpeed 가 target 의 latestArrival 을 넘으면 사용할 수 없는 arc
+- 직선 거리는 단위 구 위의 3차원 좌표 사이의 chord 길이 (haversine 거리보다 항상 짧아서 lower bound 로 사용 가능)
+- new demand 의 start_loc 으로 가는 arc 만 대상 (etaToStart[1] 이 있는 경우)
+  이미 배정된 onboard, waiting 은 늦더라도 경로를 유지해야 하고, destination_loc 의 latestArrival 은 cost matrix 로 계산함
+- station 으로 여러 node 를 대표하는 node 는 조회 단계에서 제외하지 않고, 조회 후 node 별로 INT_MAX 를 채움
+- independentNewDemands 요청은 서로 다른 new demand 의 node 사이 arc 도 제외 (pruneSpeed 와 상관없음)
+- routeArcsOnly 요청은 assigned route 의 다음 stop 으로 가는 arc 만 남김 (pruneSpeed 와 상관없음)
+- known arc (route_times, 관측값으로 미리 채운 arc) 는 조회 단계에서만 제외하고 fillInfeasible 에서는 채우지 않음
+*/
+class CArcPruner {
+public:
+    CArcPruner(const ModRequest& modRequest, const std::vector<int>& representative, double maxSpeed);
+
+    bool enabled() const { return m_maxSpeed > 0; }
+    bool independent() const { return !m_candidates.empty(); }
+    bool routeOnly() const { return !m_routeNext.empty(); }
+
+    // 값을 이미 알고 있어서 조회하지 않는 arc (arcKey, 대표 node 가 자기 자신만 대표하는 arc 만 제외)
+    void setKnownArcs(std::unordered_set<int64_t> arcs) { m_known = std::move(arcs); }
+
+    // 조회 단계에서 제외할 arc (대표 node 기준)
+    bool isPruned(int from, int to) const;
+
+    // destinations 에서 from 으로부터 제외할 arc 를 삭제, 삭제한 수를 반환
+    size_t filter(int from, std::vector<int>& destinations) const;
+
+    // node 별로 시간 안에 도착할 수 없는 arc 를 INT_MAX 로 채움, 채운 cell 수를 반환
+    size_t fillInfeasible(size_t baseVehicle, size_t nodeCount, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix) const;
+
+private:
+    double m_maxSpeed;
+    std::vector<double> m_x, m_y, m_z;      // 단위 구 위의 좌표
+    std::vector<double> m_earliest;         // 가장 빠른 출발 시간 (s)
+    std::vector<double> m_latest;           // 제외 대상 target 의 latestArrival (s), 대상이 아니면 음수
+    std::vector<char> m_shared;             // station 으로 여러 node 를 대표하는 node
+    std::vector<int> m_candidates;          // independentNewDemands 요청의 node 별 new demand index (다른 node 는 -1), 아니면 비어 있음
+    std::vector<int> m_routeNext;           // routeArcsOnly 요청의 node 별 route 의 다음 stop (없으면 -1), 아니면 비어 있음
+    std::unordered_set<int64_t> m_known;
+};
+
+// sources x destinations 중 사용할 수 있는 arc 만 조회하도록 source 별 row 를 만들어서 tile 로 묶음
+std::vector<VehicleRowGroup> planReachableTiles(
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    const std::vector<int>& nodeVehicles,
+    size_t maxSources,
+    const CArcPruner *pruner = nullptr);
+
+// 서로 다른 vehicle 에 고정된 node 사이 (vehicle -> 다른 vehicle 의 node 포함) 의 arc 를 INT_MAX 로 채움
+void fillUnreachableArcs(
+    const std::vector<int>& nodeVehicles,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+/*
+new demand 의 후보 vehicle 검색용 grid (요청마다 vehicle 위치로 새로 만듦)
+spare capacity (capacity - onboard demand) 가 부족하거나 operationTime 이 맞지 않는 vehicle 은 제외하고
+start_loc 에서 가까운 vehicle 부터 선택한다
+*/
+class CCandidateVehicleIndex {
+public:
+    explicit CCandidateVehicleIndex(const ModRequest& modRequest);
+
+    // 후보 vehicle index 목록 (정렬), k 가 0 이거나 vehicle 수 이상이면 조건에 맞는 모든 vehicle
+    std::vector<int> nearest(const NewDemand& newDemand, size_t k) const;
+
+private:
+    bool isCompatible(int vehicle, const NewDemand& newDemand) const;
+    int64_t gridKey(int latIdx, int lngIdx) const;
+
+    const ModRequest& m_modRequest;
+    std::vector<int> m_spareCapacity;
+
+    double m_cellDegree = 0.02;        // grid cell 크기 (약 2km)
+    int m_minLat = 0, m_maxLat = 0, m_minLng = 0, m_maxLng = 0;
+    std::vector<int64_t> m_gridKeys;    // 정렬된 grid cell key
+    std::vector<size_t> m_gridOffsets;
+    std::vector<int> m_gridVehicles;
+};
+
+// new demand 별 후보 vehicle (g_queryPlanPolicy.candidateVehicles 기준)
+std::vector<std::vector<int>> findCandidateVehicles(const ModRequest& modRequest);
+
+// 후보가 아닌 vehicle -> new demand start_loc arc 를 INT_MAX 로 채움
+void fillNonCandidateArcs(
+    const ModRequest& modRequest,
+    const std::vector<std::vector<int>>& candidates,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+/*
+좌표 기준 중복 제거
+station_id 가 없는 위치는 좌표를 radius 크기의 grid 로 양자화해서 가상 station_id 를 붙이고,
+기존 station 중복 처리 (pushStationToIdx, updateChangedCostMatrixWithStationCache 등) 로 같은 cell 의 node 를 한번만 조회한다
+- grid 경계를 사이에 둔 가까운 위치는 묶이지 않음
+- 가상 station_id 는 조회용 복사본에만 붙이고, station cache 에는 사용하지 않음
+*/
+
+// 양자화한 좌표의 가상 station_id
+std::string coordinateStationId(const Location& loc, double radius);
+
+// station_id 가 없는 위치에 가상 station_id 를 붙임, 붙인 위치 수를 반환
+size_t assignCoordinateStations(ModRequest& modRequest, double radius);
+
+// 같은 위치의 vehicle row 를 대표 vehicle 로 조회한 뒤 복사할 목록
+struct RowCopy {
+    int from;                       // 대표 vehicle
+    int to;
+    std::vector<int> destinations;
+};
+
+// sourceKeys[source] 가 같은 row 들을 하나로 합침 (합친 row 의 source 는 index 가 가장 작은 vehicle)
+std::vector<VehicleRow> mergeColocatedRows(
+    std::vector<VehicleRow> rows,
+    const std::vector<std::pair<std::string, int>>& sourceKeys,
+    std::vector<RowCopy>& copies);
+
+void applyRowCopies(
+    const std::vector<RowCopy>& copies,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+// vehicle row 재사용 시 움직인 거리에 더하는 시간의 기준 속도 (m/s)
+#define VEHICLE_ROW_ADJUST_SPEED    5.0
+// heading 방향으로 움직인 vehicle 이 지나친 것으로 보는 destination 의 거리 여유 (m)
+#define VEHICLE_ROW_PASSED_MARGIN   50.0
+
+// 재사용한 vehicle row 의 cell (조회 후 matrix 에 채움)
+struct RowFill {
+    int vehicle;
+    int destination;
+    int64_t dist;
+    int64_t time;
+};
+
+// 위치 update 로 미리 조회할 vehicle row
+// locs 는 vehicle 위치 (supplyIdxs 순서) 뒤에 알고 있는 stop 위치, rows 의 source/destination 은 locs 의 index
+struct VehiclePrefetch {
+    std::vector<std::string> supplyIdxs;
+    std::vector<Location> locs;
+    std::vector<VehicleRow> rows;
+};
+
+/*
+vehicle 별로 마지막에 조회한 row 를 위치 key 기준으로 보관하고, vehicle 이 거의 움직이지 않았으면 재사용
+- 조회한 위치에서 rowReuseRadius 안: 움직인 거리만큼 dist 를 더하고 VEHICLE_ROW_ADJUST_SPEED 로 time 을 더함
+- heading 이 같고 조회한 위치에서 heading 방향으로 rowReuseAlong 안: 같은 도로를 따라 앞으로 온 경우로 보고 그대로 사용
+  (조회한 위치에서 출발하는 경로가 현재 위치를 지나는 destination 만 보수적인 값)
+  이미 지나쳤을 수 있는 destination (보관한 dist 가 움직인 거리 + VEHICLE_ROW_PASSED_MARGIN 이하이거나
+  현재 위치에서 heading 의 뒤쪽에 있는 경우) 은 U-turn 이 필요할 수 있으므로 다시 조회
+- 재사용한 row 는 조회한 위치를 유지하고 새로 조회한 destination 을 추가, 재사용하지 못하면 현재 위치에서 조회한 row 로 교체
+- 위치 update (telemetry) 를 받으면 다음 요청에서 재사용하지 못할 vehicle 의 row 를 현재 위치에서 미리 조회해서 교체
+  (stop 은 마지막 optimize 요청에서 조회한 destination 을 사용)
+*/
+class CVehicleRowCache {
+public:
+    // rows 에서 재사용할 수 있는 cell 을 제외하고 fills 에 추가, vehicle 별 재사용 여부를 반환
+    std::vector<char> reuse(
+        const ModRequest& modRequest,
+        const std::vector<Location>& locs,
+        std::vector<VehicleRow>& rows,
+        std::vector<RowFill>& fills);
+
+    // 재사용하지 않은 vehicle 의 조회한 row 를 보관
+    void store(
+        const ModRequest& modRequest,
+        const std::vector<Location>& locs,
+        const std::vector<VehicleRow>& rows,
+        const std::vector<char>& reused,
+        size_t baseVehicle,
+        size_t nodeCount,
+        const std::vector<int64_t>& distMatrix,
+        const std::vector<int64_t>& timeMatrix);
+
+    // telemetry 의 vehicle 중 재사용하지 못할 vehicle 의 row (마지막 optimize 요청 후 prefetchIdle 안의 vehicle 만)
+    VehiclePrefetch prepare(const ModRequest& telemetry);
+
+    // prepare 로 만든 row 를 조회한 결과를 보관
+    void storePrefetched(
+        const VehiclePrefetch& prefetch,
+        size_t baseVehicle,
+        size_t nodeCount,
+        const std::vector<int64_t>& distMatrix,
+        const std::vector<int64_t>& timeMatrix);
+
+    void clear();
+
+private:
+    struct Entry {
+        double lat;
+        double lng;
+        int direction;
+        std::chrono::steady_clock::time_point updated;
+        std::chrono::steady_clock::time_point requested;                       // 마지막 optimize 요청에서 조회한 시각
+        std::unordered_map<std::string, std::pair<int64_t, int64_t>> cells;    // 위치 key -> (dist, time)
+        std::vector<Location> stops;                                           // 마지막 optimize 요청에서 조회한 destination
+    };
+
+    // 재사용할 수 없으면 -1, 재사용하면 움직인 거리 (m)
+    // along 은 rowReuseRadius 밖에서 heading 방향으로 움직여서 보정 없이 재사용하는 경우
+    double reuseDistance(const Entry& entry, const Location& loc, std::chrono::steady_clock::time_point now, bool* along = nullptr) const;
+
+    // 조회한 row 를 (supplyIdx 의 row 로) 교체, m_mutex 를 잡은 상태에서 호출
+    Entry& replaceRow(
+        const std::string& supplyIdx,
+        const std::vector<Location>& locs,
+        const VehicleRow& row,
+        size_t baseVehicle,
+        size_t nodeCount,
+        const std::vector<int64_t>& distMatrix,
+        const std::vector<int64_t>& timeMatrix,
+        std::chrono::steady_clock::time_point now);
+
+    // 재사용한 row 에서 새로 조회한 destination 을 추가 (조회한 위치는 유지), m_mutex 를 잡은 상태에서 호출
+    void mergeRow(
+        Entry& entry,
+        const std::vector<Location>& locs,
+        const VehicleRow& row,
+        size_t baseVehicle,
+        size_t nodeCount,
+        const std::vector<int64_t>& distMatrix,
+        const std::vector<int64_t>& timeMatrix);
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;     // supplyIdx -> row
+};
+
+extern CVehicleRowCache g_vehicleRowCache;
+
+// vehicle row 조회 계획 (조회 후 matrix 에 반영하고 row cache 에 보관)
+struct VehicleRowPlan {
+    std::vector<VehicleRow> rows;   // vehicle 별로 조회하는 row (같은 위치의 vehicle 을 합치기 전)
+    std::vector<RowCopy> copies;
+    std::vector<RowFill> fills;
+    std::vector<char> reused;
+};
+
+void applyRowFills(
+    const std::vector<RowFill>& fills,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix);
+
+inline int64_t arcKey(int from, int to, size_t nodeCount)
+{
+    return (int64_t) from * nodeCount + to;
+}
+
+#endif // _INC_QUERY_PLANNER_HDR
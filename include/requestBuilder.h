@@ -0,0 +1,66 @@
+#ifndef _INC_REQUEST_BUILDER_HDR
+#define _INC_REQUEST_BUILDER_HDR
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <mod_parameters.h>
+
+// routing engine 요청(OSRM URL, Valhalla body) 조립용 append-only buffer
+class CBufferWriter {
+public:
+    explicit CBufferWriter(size_t reserveSize = 0) {
+        m_buf.reserve(reserveSize);
+    }
+
+    CBufferWriter& append(std::string_view str) {
+        m_buf.append(str.data(), str.size());
+        return *this;
+    }
+
+    CBufferWriter& append(char c) {
+        m_buf.push_back(c);
+        return *this;
+    }
+
+    CBufferWriter& appendInt(int64_t value);
+
+    // 좌표 출력용 고정 소수점 (기존 std::fixed << std::setprecision(8) 과 동일한 형식)
+    CBufferWriter& appendFixed(double value, int precision = 8);
+
+    size_t size() const { return m_buf.size(); }
+    std::string_view view() const { return m_buf; }
+    std::string release() { return std::move(m_buf); }
+
+private:
+    std::string m_buf;
+};
+
+// 요청마다 한번만 만드는 node 별 좌표 문자열 cache
+// tile 마다 같은 좌표를 다시 formatting 하지 않고 미리 만든 조각을 이어 붙인다
+class CLocationFragments {
+public:
+    enum Format {
+        OSRM_COORDINATE,    // lng,lat
+        VALHALLA_LOCATION,  // {"lat":..,"lon":..[,"heading":..]}
+    };
+
+    CLocationFragments(const std::vector<Location>& locs, Format format);
+
+    std::string_view operator[](size_t idx) const {
+        return std::string_view(m_buf.data() + m_offsets[idx], m_offsets[idx + 1] - m_offsets[idx]);
+    }
+
+    size_t size() const { return m_offsets.size() - 1; }
+
+    // 모든 조각 길이의 최대값 (tile buffer reserve 용)
+    size_t maxLength() const { return m_maxLength; }
+
+private:
+    std::string m_buf;
+    std::vector<uint32_t> m_offsets;
+    size_t m_maxLength = 0;
+};
+
+#endif // _INC_REQUEST_BUILDER_HDR
@@ -0,0 +1,99 @@
+#ifndef _INC_ROUTE_FETCHER_HDR
+#define _INC_ROUTE_FETCHER_HDR
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+// routing engine tile 조회 정책 (main 의 command line 으로 설정)
+struct RouteFetchPolicy {
+    int tileTimeout = 3000;     // tile 하나의 deadline (ms)
+    int maxRetries = 2;         // 연결 실패, timeout, 5xx 인 경우 재시도 횟수
+    int retryBackoff = 50;      // 재시도 대기 시간 기준값 (ms), 재시도마다 2배 + jitter
+    bool hedge = true;          // 관측된 p95 를 넘긴 tile 에 대해 중복 요청을 보냄
+    int hedgeMinDelay = 50;     // hedge 요청을 보내기 전 최소 대기 시간 (ms)
+    int budget = 0;             // matrix 조회 전체 budget (ms), 0 이면 제한 없음
+};
+
+extern RouteFetchPolicy g_routeFetchPolicy;
+
+// tile 요청. body 가 비어있으면 GET, 아니면 POST (application/json)
+struct RouteFetchRequest {
+    std::string path;
+    std::string body;
+
+    RouteFetchRequest(std::string path, std::string body) : path(std::move(path)), body(std::move(body)) {}
+};
+
+// 성공한 tile 의 응답을 호출한 thread 에서 순서대로 전달
+using RouteFetchHandler = std::function<void(size_t tileIdx, std::string& body)>;
+
+// routing backend 별 최근 응답 시간 (hedge 시점 결정용)
+class CLatencyTracker {
+public:
+    void record(int64_t latency);
+
+    // 표본이 부족하면 -1
+    int64_t percentile(double p);
+
+private:
+    static constexpr size_t MAX_SAMPLES = 256;
+    static constexpr size_t MIN_SAMPLES = 20;
+
+    std::mutex m_mutex;
+    std::deque<int64_t> m_samples;
+};
+
+// routing backend 하나 (--route-path 에 ',' 로 여러 backend 를 지정할 수 있음)
+// 처리 중인 요청 수가 가장 적은 backend 로 tile 을 보내고, 연속으로 실패하면 일정 시간 제외(eject)
+// 성공/실패는 backend url 의 circuit breaker 에도 기록
+class CRouteBackend {
+public:
+    explicit CRouteBackend(std::string url) : m_url(std::move(url)) {}
+
+    const std::string& url() const { return m_url; }
+    int outstanding() const { return m_outstanding; }
+    void acquire() { m_outstanding++; }
+    void release() { m_outstanding--; }
+
+    bool isEjected(std::chrono::steady_clock::time_point now);
+    void recordSuccess();
+    void recordFailure();
+    void releaseProbe();
+
+    CLatencyTracker& latency() { return m_latency; }
+
+private:
+    std::string m_url;
+    std::atomic<int> m_outstanding{0};
+    CLatencyTracker m_latency;
+
+    std::mutex m_mutex;
+    int m_failures = 0;
+    int m_ejections = 0;
+    std::chrono::steady_clock::time_point m_ejectedUntil;
+};
+
+// routePath 를 ',' 로 나눈 backend 목록 (routePath 별로 한번만 만들어서 공유)
+std::vector<std::shared_ptr<CRouteBackend>> getRouteBackends(const std::string& routePath);
+
+// routePath 의 backend 중 circuit breaker (getCircuitBreaker) 가 요청을 허용하는 backend 가 있으면 true
+// 모두 open 이면 조회하지 않고 바로 추정값을 사용
+bool isRoutingAvailable(const std::string& routePath);
+
+// tile 들을 backend 마다 routeTasks 개 까지 동시에 조회
+// 실패한 tile (재시도 소진, 재시도 불가능한 응답, budget 초과) 의 index 목록을 반환
+std::vector<size_t> fetchRouteTiles(
+    const char *engineName,
+    const std::string& routePath,
+    const size_t routeTasks,
+    const std::vector<std::shared_ptr<RouteFetchRequest>>& requests,
+    const RouteFetchHandler& onResponse,
+    bool showLog);
+
+#endif // _INC_ROUTE_FETCHER_HDR
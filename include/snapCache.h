@@ -0,0 +1,82 @@
+#ifndef _INC_SNAP_CACHE_HDR
+#define _INC_SNAP_CACHE_HDR
+
+#include <vector>
+#include <list>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <mod_parameters.h>
+
+struct ModRequest;
+
+#define SNAP_KEY_CELL           5.0     // snap 한 위치를 같은 위치로 보는 도로 위 좌표 grid 크기 (m)
+#define SNAP_MAX_DISTANCE       30.0    // 도로에서 이 거리 (m) 보다 먼 좌표는 snap 하지 않음 (주차장 등)
+#define SNAP_FAILURE_RETRY      60      // snap 하지 못한 좌표를 다시 조회하는 시간 (s)
+#define SNAP_CACHE_MAX_ENTRIES  200000
+
+/*
+snap-to-road 결과 cache
+GPS 좌표는 요청마다 몇 m 씩 달라서 좌표 기준의 key 는 재사용되지 않음
+station_id 가 없는 좌표를 routing engine 의 nearest (OSRM) / locate (Valhalla) 로 한번 조회해서
+도로 edge 와 그 위의 위치 (SNAP_KEY_CELL grid) 로 만든 key 를 보관하고, 위치 key (makeLocationKey) 와 좌표 중복 제거에 사용
+- 조회 결과는 좌표를 snapCell 크기의 grid 로 양자화한 cell (+ direction) 단위로 보관하고,
+  조회 좌표가 snapCell 안에 있는 가장 가까운 결과를 사용 (GPS 가 몇 m 흔들려도 다시 조회하지 않음)
+- SNAP_CACHE_MAX_ENTRIES 를 넘으면 가장 오래 전에 조회한 cell 부터 지움
+- OSRM 은 도로의 어느 쪽인지 구분하지 않고, Valhalla 는 side_of_street 를 key 에 포함
+*/
+class CSnapCache {
+public:
+    struct Stats {
+        size_t hits = 0;        // snap 한 key 를 사용한 좌표 수
+        size_t misses = 0;      // snap 하지 못해서 좌표 key 를 사용한 좌표 수
+        size_t resolved = 0;    // routing engine 으로 snap 한 cell 수
+        size_t failed = 0;      // snap 하지 못한 cell 수 (조회 실패, 도로에서 먼 좌표)
+    };
+
+    // snap 한 위치 key, snap 하지 않았으면 빈 문자열
+    std::string lookup(const Location& loc);
+
+    // locs 중 아직 조회하지 않은 cell 의 좌표 (cell 마다 하나)
+    std::vector<Location> missing(const std::vector<Location>& locs);
+
+    // 조회 결과를 보관, edge 가 비어있으면 snap 하지 못한 좌표
+    void store(const Location& loc, const std::string& edge, double snappedLat, double snappedLng);
+
+    Stats stats();
+    void clear();
+
+private:
+    struct Entry {
+        std::string key;    // 비어있으면 snap 하지 못한 cell
+        double lat = 0.0;   // 조회한 좌표
+        double lng = 0.0;
+        std::chrono::steady_clock::time_point updated;
+        std::list<std::string>::iterator order;     // m_order 의 위치
+    };
+
+    std::string cellKey(int64_t row, int64_t column, int direction) const;
+    std::string cellKey(const Location& loc) const;
+
+    // loc 에서 snapCell 안의 가장 가까운 조회 결과, m_mutex 를 잡은 상태에서 호출
+    const Entry* findNearest(const Location& loc) const;
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::list<std::string> m_order;     // cell 을 조회한 순서 (앞이 가장 오래됨)
+    Stats m_stats;
+};
+
+extern CSnapCache g_snapCache;
+
+// modRequest 의 station_id 가 없는 stop 좌표 중 처음 보는 좌표를 snap (routing engine 이 정상인 경우만)
+void snapRequestLocations(
+    const ModRequest& modRequest,
+    RouteType routeType,
+    const std::string& routePath,
+    const size_t routeTasks,
+    bool showLog);
+
+#endif // _INC_SNAP_CACHE_HDR
@@ -0,0 +1,72 @@
+#ifndef _INC_SOLVER_PORTFOLIO_HDR
+#define _INC_SOLVER_PORTFOLIO_HDR
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <lnspdptw.h>
+
+class CModState;
+class CThreadPool;
+
+#define PORTFOLIO_START_SLACK_MS    100     // 이 시간 안에 시작한 solver 는 time_limit 을 줄이지 않음 (ms)
+
+// solver 실행 정책 (main 의 command line 으로 설정)
+struct SolvePolicy {
+    int portfolio = 1;          // 한 요청에서 동시에 푸는 solver 수 (seed, parameter preset 이 다름), 1 이면 사용하지 않음
+    int portfolioThreads = 0;   // portfolio solver, insertion 평가가 사용하는 worker 수 (모든 요청이 공유), 0 이면 core 수 - 1
+    bool parallelAlternatives = false;  // max_solution_number 의 alternative 를 미리 만든 제약으로 동시에 풂
+    int exactMaxNodes = 10;     // node 수가 이 이하이면 LNS 대신 exact 탐색으로 풂 (찾지 못하면 LNS), 0 이면 사용하지 않음
+};
+
+extern SolvePolicy g_solvePolicy;
+
+// solve_lns_pdptw 입력, 모든 solver 가 같이 읽기만 함
+struct SolveInput {
+    size_t nodeCount;
+    size_t vehicleCount;
+    const std::vector<int64_t>& costMatrix;
+    const std::vector<int64_t>& distMatrix;
+    const std::vector<int64_t>& timeMatrix;
+    const CModState& modState;
+};
+
+Solution* solveLns(const SolveInput& input, const AlgorithmParameters* ap);
+
+// solver 와 insertion 평가가 같이 사용하는 worker pool (CPU 를 나눠 쓰지 않도록 하나만 사용)
+CThreadPool& solverPool();
+
+// start 에 시작한 요청에서 지금 시작하는 solver 의 time_limit (초)
+// PORTFOLIO_START_SLACK_MS 보다 늦게 시작하면 지난 시간만큼 줄이고, 1초가 남지 않으면 -1 (풀지 않음)
+// time_limit 이 0 이하 (제한 없음) 이면 그대로 반환
+int remainingTimeLimit(const AlgorithmParameters& ap, std::chrono::steady_clock::time_point start);
+
+// portfolio 의 k 번째 solver parameter (0 은 ap 그대로)
+AlgorithmParameters portfolioParameters(const AlgorithmParameters& ap, int k);
+
+// 배정하지 못한 demand 수, 허용 시간을 넘긴 demand 수, route 의 cost 합 순서로 비교
+int64_t solutionCost(const SolveInput& input, const Solution* solution);
+bool isBetterSolution(const SolveInput& input, const Solution* a, const Solution* b);
+
+/*
+solvers 개의 solver 를 seed, parameter preset 을 바꿔서 같은 time_limit 으로 동시에 풀고 가장 좋은 solution 을 반환
+- 0 번 solver 는 호출한 thread 에서 풀고, 나머지는 공유 worker pool 에서 풀어서 전체 solver thread 수를 제한
+- 0 번 solver 가 끝날 때까지 시작하지 못한 solver 는 풀지 않음 (응답 시간이 늘어나지 않도록)
+- pool 에서 늦게 시작한 solver 는 start 부터 남은 시간만 풂 (remainingTimeLimit)
+- 나머지 solution 은 삭제
+- node 수가 SolvePolicy::exactMaxNodes 이하이면 먼저 exact 탐색으로 풀어 봄 (exactSolver.h)
+*/
+Solution* solvePortfolio(
+    const SolveInput& input,
+    const AlgorithmParameters* ap,
+    int solvers,
+    bool showLog,
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now());
+
+// inputs 를 모두 동시에 풀어서 같은 순서로 반환 (0 번은 호출한 thread, 나머지는 worker pool, 풀지 못하면 nullptr)
+// 각 input 은 solvePortfolio 로 portfolio 개의 solver 로 풂
+// 0 번이 끝날 때까지 시작하지 못한 input 은 풀지 않고, 늦게 시작한 input 은 남은 시간만 풂 (전체가 time_limit 안에 끝남)
+std::vector<Solution*> solveConcurrently(const std::vector<SolveInput>& inputs, const AlgorithmParameters* ap, int portfolio, bool showLog);
+
+#endif // _INC_SOLVER_PORTFOLIO_HDR
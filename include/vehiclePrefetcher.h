@@ -0,0 +1,57 @@
+#ifndef _INC_VEHICLE_PREFETCHER_HDR
+#define _INC_VEHICLE_PREFETCHER_HDR
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <mod_parameters.h>
+
+/*
+위치 update (telemetry) 로 vehicle row 를 미리 조회하는 background worker
+- 같은 vehicle 의 처리하지 않은 update 는 마지막 위치만 남기고 한번에 조회
+- optimize 요청이 cost matrix 를 조회하는 동안에는 시작하지 않고, backend 마다 요청 하나씩만 보냄 (낮은 우선순위)
+- 조회한 row 는 vehicle row cache 에 보관되어 다음 optimize 요청에서 재사용
+*/
+class CVehiclePrefetcher {
+public:
+    ~CVehiclePrefetcher();
+
+    // worker 를 시작하거나 routing engine 설정을 변경
+    void start(const std::string& routePath, RouteType routeType, bool showLog);
+    void stop();
+
+    // 위치 update 를 넣고 처리를 기다리는 vehicle 수를 반환
+    size_t submit(const std::vector<VehicleLocation>& vehicles);
+
+    // optimize 요청의 cost matrix 조회 구간
+    void beginForeground();
+    void endForeground();
+
+private:
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_worker;
+    bool m_stop = false;
+    int m_foreground = 0;
+    std::unordered_map<std::string, VehicleLocation> m_pending;    // supplyIdx -> 마지막 위치
+
+    std::string m_routePath;
+    RouteType m_routeType = ROUTE_VALHALLA;
+    bool m_showLog = false;
+};
+
+extern CVehiclePrefetcher g_vehiclePrefetcher;
+
+// cost matrix 조회 동안 prefetch 를 미룸
+class CForegroundQuery {
+public:
+    CForegroundQuery() { g_vehiclePrefetcher.beginForeground(); }
+    ~CForegroundQuery() { g_vehiclePrefetcher.endForeground(); }
+};
+
+#endif // _INC_VEHICLE_PREFETCHER_HDR
@@ -2,5 +2,6 @@ package com.ciel.microservices.dispatch_engine_service.mod_route;
 
 public enum RouteType {
     OSRM,
-    Valhalla
+    Valhalla,
+    Local
 }
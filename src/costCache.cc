@@ -6,10 +6,16 @@
 #include <map>
 #include <utility>
 #include <cassert>
+#include <climits>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
 #include <cpp-httplib/httplib.h>
 #include <gason/gason.h>
 #include <lnsModRoute.h>
 #include <costCache.h>
+#include <snapCache.h>
+#include <costEstimator.h>
 
 /*
 캐싱 기본 전략
@@ -21,13 +27,51 @@ vehicle이 제일 먼저 갈 수 있는 node는 무조건 조회한다.
 onboard, waiting 인 경우는 캐싱에 있는 내용을 우선, 없으면 조회 후 업데이트
 (onboard + waiting) * (onboard + waiting) 은 최대한 캐싱 처리
 
-new 인 경우는 (onboard + waiting + new) -> (new), (new) -> (onboard + waiting - new) 로 무조건 조회
-new 는 요청할 경우 들어오는데 기본적으로 많지 않고,
-아직 확정이 된 경우가 아니기 때문에 캐싱할 필요가 없음.
+new 인 경우는 (onboard + waiting + new) -> (new), (new) -> (onboard + waiting - new) 로 조회
+new 는 아직 확정이 된 경우가 아니기 때문에 id 로 캐싱하지 않고,
+quote, 재 quote, confirm 처럼 몇 초 안에 같은 new demand 가 다시 들어오는 경우만을 위해
+위치 key 기준의 arc 를 짧은 시간 (m_newDemandMaxAge) 동안만 유지
+(vehicle -> new 는 vehicle 위치가 바뀌므로 항상 조회)
 */
 
 extern std::string logNow();
 
+std::string makeLocationKey(const Location& loc)
+{
+    int direction = makeStationKey(loc.station_id, loc.direction).second;
+    if (!loc.station_id.empty()) {
+        return "S" + loc.station_id + "@" + std::to_string(direction);
+    }
+    // snap 한 좌표는 GPS 오차와 상관없이 같은 key
+    std::string snapped = g_snapCache.lookup(loc);
+    if (!snapped.empty()) {
+        return "R" + snapped + "@" + std::to_string(direction);
+    }
+    char key[64];
+    snprintf(key, sizeof(key), "%.6f,%.6f@%d", loc.lat, loc.lng, direction);
+    return key;
+}
+
+// vehicle 을 제외한 node (onboard, waiting, new 순서) 의 위치 key
+static std::vector<std::string> collectNodeKeys(const ModRequest &modRequest)
+{
+    std::vector<std::string> keys;
+    keys.reserve(modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size() + 2 * modRequest.newDemands.size());
+    for (auto& onboard : modRequest.onboardDemands) {
+        keys.push_back(makeLocationKey(onboard.destinationLoc));
+    }
+    for (auto& waiting : modRequest.onboardWaitingDemands) {
+        keys.push_back(makeLocationKey(waiting.startLoc));
+        keys.push_back(makeLocationKey(waiting.destinationLoc));
+    }
+    for (auto& newDemand : modRequest.newDemands) {
+        // start_loc 으로 가는 arc 는 eta_to_start 로 INT_MAX 를 채울 수 있어서 (CArcPruner) latest 를 key 에 포함
+        keys.push_back(makeLocationKey(newDemand.startLoc) + "#" + std::to_string(newDemand.etaToStart[1]));
+        keys.push_back(makeLocationKey(newDemand.destinationLoc));
+    }
+    return keys;
+}
+
 CCostCache::CCostCache(std::chrono::seconds maxAge)
     : m_maxAge(maxAge)
 {
@@ -39,7 +83,9 @@ CCostCache::~CCostCache()
 
 void CCostCache::clear()
 {
+    m_newDemandArcs.clear();
     m_mapId.clear();
+    m_mapSupply.clear();
     m_expirationTimes.clear();
     m_distCache.clear();
     m_timeCache.clear();
@@ -66,32 +112,107 @@ bool CCostCache::checkChangedItem(const ModRequest &modRequest, std::vector<int>
 
 bool CCostCache::checkForStationCache(const ModRequest &modRequest, std::vector<int>& changed)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 항목의 위치가 모두 station cache 에 있거나 근사할 수 있으면 조회하지 않음
+    auto checkItem = [&](int idx, std::initializer_list<const Location *> locs) {
+        bool approximated = false;
+        for (auto loc : locs) {
+            if (isEdgeCached(loc->station_id)) {
+                m_stationLocs.emplace(loc->station_id, *loc);
+                continue;
+            }
+            if (m_approxAnchors == 0 || !loc->station_id.empty() || findStationAnchors(*loc).empty()) {
+                changed.push_back(idx);
+                return;
+            }
+            approximated = true;
+        }
+        if (approximated && ++m_approxCandidates % STATION_APPROX_VERIFY_RATIO == 0) {
+            // 일부는 조회해서 근사값과 비교 (updateForStationCache)
+            if (m_approxVerifyKeys.size() > 1000) {
+                m_approxVerifyKeys.clear();
+            }
+            for (auto loc : locs) {
+                if (loc->station_id.empty()) {
+                    m_approxVerifyKeys.insert(makeLocationKey(*loc));
+                }
+            }
+            changed.push_back(idx);
+        }
+    };
+
     int idx = 0;
     for (size_t i = 0; i < modRequest.onboardDemands.size(); i++, idx++) {
         auto &onboard = modRequest.onboardDemands[i];
-        if (isEdgeCached(onboard.destinationLoc.station_id)) {
-            continue;
-        }
-        changed.push_back(idx);
+        checkItem(idx, { &onboard.destinationLoc });
     }
     for (size_t i = 0; i < modRequest.onboardWaitingDemands.size(); i++, idx++) {
         auto &waiting = modRequest.onboardWaitingDemands[i];
-        if (isEdgeCached(waiting.startLoc.station_id) && isEdgeCached(waiting.destinationLoc.station_id)) {
-            continue;
-        }
-        changed.push_back(idx);
+        checkItem(idx, { &waiting.startLoc, &waiting.destinationLoc });
     }
     for (size_t i = 0; i < modRequest.newDemands.size(); i++, idx++) {
         auto &newDemand = modRequest.newDemands[i];
-        if (isEdgeCached(newDemand.startLoc.station_id) && isEdgeCached(newDemand.destinationLoc.station_id)) {
-            continue;
-        }
-        changed.push_back(idx);
+        checkItem(idx, { &newDemand.startLoc, &newDemand.destinationLoc });
     }
 
     return true;
 }
 
+std::vector<CCostCache::StationAnchor> CCostCache::findStationAnchors(const Location& loc)
+{
+    std::vector<std::pair<double, const std::pair<const std::string, Location> *>> nearest;
+    for (auto& station : m_stationLocs) {
+        double distance = haversineDistance(loc, station.second);
+        if (distance <= m_approxRadius) {
+            nearest.push_back({ distance, &station });
+        }
+    }
+    size_t count = std::min(nearest.size(), m_approxAnchors);
+    std::partial_sort(nearest.begin(), nearest.begin() + count, nearest.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<StationAnchor> anchors(count);
+    for (size_t i = 0; i < count; i++) {
+        auto& station = *nearest[i].second;
+        anchors[i].station = station.first;
+        g_costEstimator.estimate(loc, station.second, anchors[i].outDist, anchors[i].outTime);
+        g_costEstimator.estimate(station.second, loc, anchors[i].inDist, anchors[i].inTime);
+    }
+    return anchors;
+}
+
+bool CCostCache::approximateArc(const std::vector<StationAnchor>& from, const std::vector<StationAnchor>& to, int64_t& dist, int64_t& time)
+{
+    bool found = false;
+    for (auto& a : from) {
+        for (auto& b : to) {
+            auto it = m_stationCache.find(std::make_pair(a.station, b.station));
+            if (it == m_stationCache.end()) {
+                continue;
+            }
+            int64_t t = a.outTime + it->second.second + b.inTime;
+            if (!found || t < time) {
+                time = t;
+                dist = a.outDist + it->second.first + b.inDist;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+// 캐싱한 이후에 배정된 vehicle 이 바뀐 경우 (다른 vehicle 의 node 와의 arc 를 조회하지 않았을 수 있음)
+bool CCostCache::isSupplyChanged(const std::string& id, const std::string& supplyIdx)
+{
+#ifdef CHECK_COST_FIXED_ASSIGNMENT
+    auto it = m_mapSupply.find(id);
+    return it != m_mapSupply.end() && it->second != supplyIdx;
+#else
+    return false;
+#endif
+}
+
 bool CCostCache::checkForLocalCache(const ModRequest &modRequest, std::vector<int>& changed)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
@@ -106,6 +227,8 @@ bool CCostCache::checkForLocalCache(const ModRequest &modRequest, std::vector<in
             changed.push_back(idx);
         } else if (m_expirationTimes[it->second] < now) {
             changed.push_back(idx);
+        } else if (isSupplyChanged(modRequest.onboardDemands[i].id, modRequest.onboardDemands[i].supplyIdx)) {
+            changed.push_back(idx);
         }
     }
     for (size_t i = 0; i < modRequest.onboardWaitingDemands.size(); i++, idx++) {
@@ -114,9 +237,31 @@ bool CCostCache::checkForLocalCache(const ModRequest &modRequest, std::vector<in
             changed.push_back(idx);
         } else if (m_expirationTimes[it->second] < now) {
             changed.push_back(idx);
+        } else if (isSupplyChanged(modRequest.onboardWaitingDemands[i].id, modRequest.onboardWaitingDemands[i].supplyIdx)) {
+            changed.push_back(idx);
         }
     }
+    std::vector<std::string> nodeKeys;
+    std::vector<char> queried;
+    if (m_newDemandMaxAge.count() > 0 && !modRequest.newDemands.empty()) {
+        // changed 인 onboard, waiting 과의 arc 는 어차피 조회하므로 확인하지 않음
+        nodeKeys = collectNodeKeys(modRequest);
+        queried.assign(nodeKeys.size(), 0);
+        size_t onboardSize = modRequest.onboardDemands.size();
+        for (auto c : changed) {
+            if (c < onboardSize) {
+                queried[c] = 1;
+            } else {
+                queried[2 * (c - onboardSize) + onboardSize] = 1;
+                queried[2 * (c - onboardSize) + onboardSize + 1] = 1;
+            }
+        }
+    }
+    size_t newBase = modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size();
     for (size_t i = 0; i < modRequest.newDemands.size(); i++, idx++) {
+        if (!nodeKeys.empty() && isNewDemandCached(nodeKeys, queried, newBase + 2 * i, now)) {
+            continue;
+        }
         changed.push_back(idx);
     }
 
@@ -146,17 +291,63 @@ void CCostCache::updateCacheAndCost(const ModRequest &modRequest, size_t nodeCou
     // std::cout << logNow() << " updateCacheAndCost nodeCount=" << nodeCount << "  changed=" << changed.size() << "  duration=" << duration << " ms" << std::endl;
 }
 
+void CCostCache::discardChanged(const ModRequest &modRequest, const std::vector<int>& changed)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_lastLocHash.clear();
+    m_lastDistMatrix.clear();
+    m_lastTimeMatrix.clear();
+
+    auto expired = std::chrono::steady_clock::time_point::min();
+    size_t onboardSizeInChange = modRequest.onboardDemands.size();
+    size_t waitingSizeInChange = onboardSizeInChange + modRequest.onboardWaitingDemands.size();
+    for (auto c : changed) {
+        std::map<std::string, int>::iterator it;
+        if (c < onboardSizeInChange) {
+            it = m_mapId.find(modRequest.onboardDemands[c].id);
+        } else if (c < waitingSizeInChange) {
+            it = m_mapId.find(modRequest.onboardWaitingDemands[c - onboardSizeInChange].id);
+        } else {
+            // 추정값을 사용한 new demand 의 arc 는 삭제
+            auto& newDemand = modRequest.newDemands[c - waitingSizeInChange];
+            auto startKey = makeLocationKey(newDemand.startLoc) + "#" + std::to_string(newDemand.etaToStart[1]);
+            auto destKey = makeLocationKey(newDemand.destinationLoc);
+            for (auto arc = m_newDemandArcs.begin(); arc != m_newDemandArcs.end(); ) {
+                auto& key = arc->first;
+                if (key.first == startKey || key.first == destKey || key.second == startKey || key.second == destKey) {
+                    arc = m_newDemandArcs.erase(arc);
+                } else {
+                    ++arc;
+                }
+            }
+            continue;
+        }
+        if (it != m_mapId.end()) {
+            m_expirationTimes[it->second] = expired;
+            m_expirationTimes[it->second + 1] = expired;
+        }
+    }
+}
+
 void CCostCache::updateForStationCache(const ModRequest &modRequest, size_t nodeCount, const std::vector<int>& changed, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     std::vector<std::string> cacheStation(modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size() + 2 * modRequest.newDemands.size());
+    std::vector<const Location *> nodeLocs(cacheStation.size());
+    std::vector<int> nodeItems(cacheStation.size());
     size_t idx = 0;
-    for (size_t i = 0; i < modRequest.onboardDemands.size(); i++, idx++) {
+    size_t item = 0;
+    for (size_t i = 0; i < modRequest.onboardDemands.size(); i++, idx++, item++) {
         auto &onboard = modRequest.onboardDemands[i];
         if (isEdgeCached(onboard.destinationLoc.station_id)) {
             cacheStation[idx] = onboard.destinationLoc.station_id;
         }
+        nodeLocs[idx] = &onboard.destinationLoc;
+        nodeItems[idx] = item;
     }
-    for (size_t i = 0; i < modRequest.onboardWaitingDemands.size(); i++, idx+=2) {
+    for (size_t i = 0; i < modRequest.onboardWaitingDemands.size(); i++, idx+=2, item++) {
         auto &waiting = modRequest.onboardWaitingDemands[i];
         if (isEdgeCached(waiting.startLoc.station_id)) {
             cacheStation[idx] = waiting.startLoc.station_id;
@@ -164,8 +355,11 @@ void CCostCache::updateForStationCache(const ModRequest &modRequest, size_t node
         if (isEdgeCached(waiting.destinationLoc.station_id)) {
             cacheStation[idx + 1] = waiting.destinationLoc.station_id;
         }
+        nodeLocs[idx] = &waiting.startLoc;
+        nodeLocs[idx + 1] = &waiting.destinationLoc;
+        nodeItems[idx] = nodeItems[idx + 1] = item;
     }
-    for (size_t i = 0; i < modRequest.newDemands.size(); i++, idx+=2) {
+    for (size_t i = 0; i < modRequest.newDemands.size(); i++, idx+=2, item++) {
         auto &newDemand = modRequest.newDemands[i];
         if (isEdgeCached(newDemand.startLoc.station_id)) {
             cacheStation[idx] = newDemand.startLoc.station_id;
@@ -173,6 +367,9 @@ void CCostCache::updateForStationCache(const ModRequest &modRequest, size_t node
         if (isEdgeCached(newDemand.destinationLoc.station_id)) {
             cacheStation[idx + 1] = newDemand.destinationLoc.station_id;
         }
+        nodeLocs[idx] = &newDemand.startLoc;
+        nodeLocs[idx + 1] = &newDemand.destinationLoc;
+        nodeItems[idx] = nodeItems[idx + 1] = item;
     }
     size_t base = modRequest.vehicleLocs.size() + 1;
     for (size_t i = 0; i < cacheStation.size(); i++) {
@@ -189,6 +386,81 @@ void CCostCache::updateForStationCache(const ModRequest &modRequest, size_t node
         }
     }
 
+    if (m_approxAnchors > 0) {
+        // station 은 anchor 하나 (last-mile 0), 조회하지 않은 station 이 없는 위치는 가까운 station 들, 조회한 위치는 비어있음
+        std::vector<char> isChanged(item, 0);
+        for (auto c : changed) {
+            isChanged[c] = 1;
+        }
+        std::vector<std::vector<StationAnchor>> anchors(cacheStation.size());
+        std::vector<char> approximated(cacheStation.size(), 0);
+        std::vector<size_t> verify;
+        for (size_t i = 0; i < cacheStation.size(); i++) {
+            if (!cacheStation[i].empty()) {
+                anchors[i].push_back({ cacheStation[i], 0, 0, 0, 0 });
+            } else if (nodeLocs[i]->station_id.empty()) {
+                if (isChanged[nodeItems[i]]) {
+                    if (!m_approxVerifyKeys.empty() && m_approxVerifyKeys.erase(makeLocationKey(*nodeLocs[i])) > 0) {
+                        verify.push_back(i);
+                    }
+                    continue;
+                }
+                anchors[i] = findStationAnchors(*nodeLocs[i]);
+                approximated[i] = 1;
+                m_approxStats.approximatedNodes++;
+            }
+        }
+
+        auto fill = [&](size_t i, size_t j) {
+            int64_t dist, time;
+            if (i == j) {
+                dist = time = 0;
+            } else if (!approximateArc(anchors[i], anchors[j], dist, time)) {
+                // station 사이의 값이 없으면 직접 추정
+                g_costEstimator.estimate(*nodeLocs[i], *nodeLocs[j], dist, time);
+            }
+            distMatrix[(i + base) * (nodeCount + 1) + (j + base)] = dist;
+            timeMatrix[(i + base) * (nodeCount + 1) + (j + base)] = time;
+            m_approxStats.approximatedCells++;
+        };
+        for (size_t i = 0; i < cacheStation.size(); i++) {
+            if (anchors[i].empty()) {
+                continue;
+            }
+            for (size_t j = 0; j < cacheStation.size(); j++) {
+                if (!anchors[j].empty() && (approximated[i] || approximated[j])) {
+                    fill(i, j);
+                }
+            }
+        }
+
+        // 조회한 값과 근사값 비교
+        auto compare = [&](size_t from, const std::vector<StationAnchor>& fromAnchors, size_t to, const std::vector<StationAnchor>& toAnchors) {
+            int64_t actual = timeMatrix[(from + base) * (nodeCount + 1) + (to + base)];
+            int64_t dist, time;
+            if (actual <= 0 || actual == INT_MAX || !approximateArc(fromAnchors, toAnchors, dist, time)) {
+                return;
+            }
+            double error = std::abs((double) (time - actual)) / actual;
+            m_approxStats.verifiedCells++;
+            m_approxStats.timeErrorSum += error;
+            m_approxStats.timeErrorMax = std::max(m_approxStats.timeErrorMax, error);
+            if (time < actual) {
+                m_approxStats.underestimated++;
+            }
+        };
+        for (auto v : verify) {
+            auto verifyAnchors = findStationAnchors(*nodeLocs[v]);
+            for (size_t j = 0; j < cacheStation.size(); j++) {
+                if (j == v || anchors[j].empty()) {
+                    continue;
+                }
+                compare(v, verifyAnchors, j, anchors[j]);
+                compare(j, anchors[j], v, verifyAnchors);
+            }
+        }
+    }
+
     if (!modRequest.locHash.empty()) {
         m_lastLocHash = modRequest.locHash;
         m_lastDistMatrix = distMatrix;
@@ -196,6 +468,81 @@ void CCostCache::updateForStationCache(const ModRequest &modRequest, size_t node
     }
 }
 
+// new demand (start_loc = newDemandNode, destination_loc = newDemandNode + 1) 와 다른 node 사이의 arc 가 모두 캐싱되어 있는지 확인
+bool CCostCache::isNewDemandCached(const std::vector<std::string>& nodeKeys, const std::vector<char>& queried, size_t newDemandNode, std::chrono::steady_clock::time_point now)
+{
+    auto isCached = [&](const std::string& from, const std::string& to) {
+        auto it = m_newDemandArcs.find(std::make_pair(from, to));
+        return it != m_newDemandArcs.end() && it->second.expiration >= now;
+    };
+    for (size_t node = newDemandNode; node < newDemandNode + 2; node++) {
+        for (size_t j = 0; j < nodeKeys.size(); j++) {
+            if (j == node || queried[j]) {
+                continue;
+            }
+            if (!isCached(nodeKeys[node], nodeKeys[j]) || !isCached(nodeKeys[j], nodeKeys[node])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void CCostCache::updateForNewDemandCache(const ModRequest &modRequest, size_t nodeCount, const std::vector<int>& changed, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix)
+{
+    if (m_newDemandMaxAge.count() == 0 || modRequest.newDemands.empty()) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = m_newDemandArcs.begin(); it != m_newDemandArcs.end(); ) {
+        if (it->second.expiration < now) {
+            it = m_newDemandArcs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    auto nodeKeys = collectNodeKeys(modRequest);
+    size_t base = modRequest.vehicleLocs.size() + 1;
+    size_t newBase = modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size();
+    size_t waitingSizeInChange = modRequest.onboardDemands.size() + modRequest.onboardWaitingDemands.size();
+    std::vector<char> newChanged(modRequest.newDemands.size(), 0);
+    for (auto c : changed) {
+        if (c >= waitingSizeInChange) {
+            newChanged[c - waitingSizeInChange] = 1;
+        }
+    }
+
+    auto expiration = now + m_newDemandMaxAge;
+    for (size_t i = 0; i < modRequest.newDemands.size(); i++) {
+        for (size_t node = newBase + 2 * i; node < newBase + 2 * i + 2; node++) {
+            for (size_t j = 0; j < nodeKeys.size(); j++) {
+                if (j == node) {
+                    continue;
+                }
+                size_t cells[2][2] = {
+                    { node, j },
+                    { j, node },
+                };
+                for (auto& cell : cells) {
+                    size_t matrixIdx = (cell[0] + base) * (nodeCount + 1) + (cell[1] + base);
+                    auto key = std::make_pair(nodeKeys[cell[0]], nodeKeys[cell[1]]);
+                    if (newChanged[i]) {
+                        m_newDemandArcs[key] = { distMatrix[matrixIdx], timeMatrix[matrixIdx], expiration };
+                    } else {
+                        auto it = m_newDemandArcs.find(key);
+                        if (it != m_newDemandArcs.end()) {
+                            distMatrix[matrixIdx] = it->second.dist;
+                            timeMatrix[matrixIdx] = it->second.time;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
 void CCostCache::updateForLocalCache(const ModRequest &modRequest, size_t nodeCount, const std::vector<int>& changed, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
@@ -203,6 +550,8 @@ void CCostCache::updateForLocalCache(const ModRequest &modRequest, size_t nodeCo
     // 현재 onboard + waiting 에 있는 것은 조회해서 cost array에 입력
     // changed 에 있는 것은 cost array에 있는 것을 cache에 업데이트
     // 오래된 항목은 캐시에서 삭제
+    updateForNewDemandCache(modRequest, nodeCount, changed, distMatrix, timeMatrix);
+
     size_t onboardBase = modRequest.vehicleLocs.size() + 1;
     size_t waitingBase = onboardBase + modRequest.onboardDemands.size();
 
@@ -274,6 +623,7 @@ void CCostCache::updateForLocalCache(const ModRequest &modRequest, size_t nodeCo
             int c = changed[i];
             if (c < onboardSizeInChange) {
                 // changed at onboard
+                m_mapSupply[modRequest.onboardDemands[c].id] = modRequest.onboardDemands[c].supplyIdx;
                 if (cacheIdx[c] == -1) {
                     cacheIdx[c] = cur_size + 1;
                     m_mapId[modRequest.onboardDemands[c].id] = cur_size;
@@ -287,6 +637,7 @@ void CCostCache::updateForLocalCache(const ModRequest &modRequest, size_t nodeCo
             } else if (c < waitingSizeInChange) {
                 // changed at waiting
                 c -= onboardSizeInChange;
+                m_mapSupply[modRequest.onboardWaitingDemands[c].id] = modRequest.onboardWaitingDemands[c].supplyIdx;
                 auto c_i = 2 * c + onboardSizeInChange;
                 if (cacheIdx[c_i] == -1) {
                     assert(cacheIdx[c_i + 1] == -1);
@@ -402,6 +753,7 @@ void CCostCache::updateForLocalCache(const ModRequest &modRequest, size_t nodeCo
     // 삭제할 위치에 속하는 value는 삭제하고, 그렇지 않은 value는 del_size 만큼 뺌
     for (auto it = m_mapId.begin(); it != m_mapId.end(); ) {
         if (it->second < del_size) {
+            m_mapSupply.erase(it->first);
             it = m_mapId.erase(it);
         } else {
             it->second -= del_size;
@@ -425,6 +777,26 @@ void CCostCache::setMaxAge(std::chrono::seconds maxAge)
     m_maxAge = maxAge;
 }
 
+void CCostCache::setStationApproximation(size_t anchors, double radius)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_approxAnchors = anchors;
+    m_approxRadius = radius;
+}
+
+StationApproxStats CCostCache::stationApproxStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_approxStats;
+}
+
+void CCostCache::setNewDemandMaxAge(std::chrono::seconds maxAge)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_newDemandMaxAge = maxAge;
+    m_newDemandArcs.clear();
+}
+
 void CCostCache::addEdge(std::string fromNode, std::string toNode, int64_t dist, int64_t time)
 {
     m_stationCache[std::make_pair(fromNode, toNode)] = std::make_pair(dist, time);
@@ -512,7 +884,9 @@ void CCostCache::exportStationCache(const std::string& path)
 
 void CCostCache::clearStationCache()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_stationCache.clear();
+    m_stationLocs.clear();
     m_lastLoadedCachePath.clear();
 }
 
@@ -0,0 +1,212 @@
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <costEstimator.h>
+
+#define EARTH_RADIUS            6371000.0
+#define REGION_GRID_DEGREE      0.05    // 약 5km
+#define ESTIMATE_MIN_DISTANCE   200.0   // 너무 가까운 cell 은 detour factor 가 튀므로 보정에 사용하지 않음
+#define ESTIMATE_MIN_SAMPLES    5
+#define ESTIMATE_EWMA_ALPHA     0.05
+#define OBSERVE_SAMPLES_PER_TILE 16
+
+CostEstimatePolicy g_costEstimatePolicy;
+CCostEstimator g_costEstimator;
+
+double haversineDistance(const Location& from, const Location& to)
+{
+    constexpr double toRad = M_PI / 180.0;
+    double dLat = (to.lat - from.lat) * toRad;
+    double dLng = (to.lng - from.lng) * toRad;
+    double a = std::sin(dLat / 2) * std::sin(dLat / 2)
+        + std::cos(from.lat * toRad) * std::cos(to.lat * toRad) * std::sin(dLng / 2) * std::sin(dLng / 2);
+    return 2.0 * EARTH_RADIUS * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+int64_t CCostEstimator::regionKey(const Location& loc)
+{
+    int64_t latIdx = (int64_t) std::floor(loc.lat / REGION_GRID_DEGREE);
+    int64_t lngIdx = (int64_t) std::floor(loc.lng / REGION_GRID_DEGREE);
+    return (latIdx << 32) ^ (lngIdx & 0xffffffff);
+}
+
+void CCostEstimator::update(RegionModel& model, double detour, double speed)
+{
+    if (model.samples == 0) {
+        model.detour = detour;
+        model.speed = speed;
+    } else {
+        model.detour += ESTIMATE_EWMA_ALPHA * (detour - model.detour);
+        model.speed += ESTIMATE_EWMA_ALPHA * (speed - model.speed);
+    }
+    model.samples++;
+}
+
+void CCostEstimator::observe(const Location& from, const Location& to, int64_t dist, int64_t time)
+{
+    if (dist == INT_MAX || time == INT_MAX || dist <= 0 || time <= 0) {
+        return;
+    }
+    double straight = haversineDistance(from, to);
+    if (straight < ESTIMATE_MIN_DISTANCE) {
+        return;
+    }
+    double detour = std::clamp(dist / straight, 1.0, 3.0);
+    double speed = std::clamp((double) dist / time, 1.0, 30.0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    update(m_global, detour, speed);
+    update(m_regions[regionKey(from)], detour, speed);
+}
+
+void CCostEstimator::estimate(const Location& from, const Location& to, int64_t& dist, int64_t& time)
+{
+    double detour = g_costEstimatePolicy.detourFactor;
+    double speed = g_costEstimatePolicy.speed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_regions.find(regionKey(from));
+        if (it != m_regions.end() && it->second.samples >= ESTIMATE_MIN_SAMPLES) {
+            detour = it->second.detour;
+            speed = it->second.speed;
+        } else if (m_global.samples >= ESTIMATE_MIN_SAMPLES) {
+            detour = m_global.detour;
+            speed = m_global.speed;
+        }
+    }
+    double estimated = haversineDistance(from, to) * detour;
+    dist = (int64_t) std::ceil(estimated);
+    time = (int64_t) std::ceil(estimated / speed);
+}
+
+bool CCircuitBreaker::allowRequest()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_state == CLOSED) {
+        return true;
+    }
+    if (m_state == OPEN) {
+        auto cooldown = std::chrono::milliseconds(g_costEstimatePolicy.breakerCooldown);
+        if (std::chrono::steady_clock::now() - m_openedAt < cooldown) {
+            return false;
+        }
+        m_state = HALF_OPEN;
+        m_probing = false;
+    }
+    // half open 에서는 한 요청만 routing engine 으로 보냄
+    if (m_probing) {
+        return false;
+    }
+    m_probing = true;
+    return true;
+}
+
+void CCircuitBreaker::recordSuccess()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_state = CLOSED;
+    m_failures = 0;
+    m_probing = false;
+}
+
+void CCircuitBreaker::recordFailure()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failures++;
+    if (m_state == HALF_OPEN || m_failures >= g_costEstimatePolicy.breakerFailures) {
+        m_state = OPEN;
+        m_openedAt = std::chrono::steady_clock::now();
+    }
+    m_probing = false;
+}
+
+void CCircuitBreaker::releaseProbe()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_probing = false;
+}
+
+void CCircuitBreaker::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_state = CLOSED;
+    m_failures = 0;
+    m_probing = false;
+}
+
+CCircuitBreaker::State CCircuitBreaker::state()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_state == OPEN) {
+        auto cooldown = std::chrono::milliseconds(g_costEstimatePolicy.breakerCooldown);
+        if (std::chrono::steady_clock::now() - m_openedAt >= cooldown) {
+            m_state = HALF_OPEN;
+            m_probing = false;
+        }
+    }
+    return m_state;
+}
+
+static std::mutex breakerMutex;
+static std::unordered_map<std::string, CCircuitBreaker> breakers;
+
+CCircuitBreaker& getCircuitBreaker(const std::string& url)
+{
+    std::lock_guard<std::mutex> lock(breakerMutex);
+    return breakers[url];
+}
+
+void resetCircuitBreakers()
+{
+    // 다른 thread 가 참조를 가지고 있을 수 있으므로 지우지 않고 초기화
+    std::lock_guard<std::mutex> lock(breakerMutex);
+    for (auto& entry : breakers) {
+        entry.second.reset();
+    }
+}
+
+size_t estimateCostTile(
+    const std::vector<Location>& locs,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    for (auto s : sources) {
+        size_t baseIdx = (s + baseVehicle) * (nodeCount + 1) + baseVehicle;
+        for (auto d : destinations) {
+            if (s == d) {
+                distMatrix[baseIdx + d] = 0;
+                timeMatrix[baseIdx + d] = 0;
+            } else {
+                g_costEstimator.estimate(locs[s], locs[d], distMatrix[baseIdx + d], timeMatrix[baseIdx + d]);
+            }
+        }
+    }
+    return sources.size() * destinations.size();
+}
+
+void observeCostTile(
+    const std::vector<Location>& locs,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    const std::vector<int64_t>& distMatrix,
+    const std::vector<int64_t>& timeMatrix)
+{
+    size_t cellCount = sources.size() * destinations.size();
+    if (cellCount == 0) {
+        return;
+    }
+    // tile 전체를 보지 않고 일정 간격으로 골라서 보정
+    size_t step = std::max((size_t) 1, cellCount / OBSERVE_SAMPLES_PER_TILE);
+    for (size_t c = step / 2; c < cellCount; c += step) {
+        int s = sources[c / destinations.size()];
+        int d = destinations[c % destinations.size()];
+        size_t idx = (s + baseVehicle) * (nodeCount + 1) + (d + baseVehicle);
+        g_costEstimator.observe(locs[s], locs[d], distMatrix[idx], timeMatrix[idx]);
+    }
+}
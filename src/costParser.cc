@@ -0,0 +1,298 @@
+#include <string_view>
+#include <charconv>
+#include <stdexcept>
+#include <climits>
+#include <cmath>
+#include <costParser.h>
+
+/*
+routing engine 응답 parser
+gason 으로 DOM 전체를 만든 후 key 마다 strcmp 하는 방식은
+valhalla 50x50 tile 의 경우 수천개의 작은 object 를 만들게 되어 parsing 시간이 커짐
+필요한 key 만 골라서 scan 하면서 값을 matrix 에 바로 기록하고 나머지 값은 skip 한다
+*/
+
+class CJsonScanner {
+public:
+    CJsonScanner(const char *begin, const char *end, const char *errorMessage)
+        : m_cur(begin), m_end(end), m_errorMessage(errorMessage) {}
+
+    void skipWs() {
+        while (m_cur < m_end && (*m_cur == ' ' || *m_cur == '\n' || *m_cur == '\r' || *m_cur == '\t')) {
+            m_cur++;
+        }
+    }
+
+    char peek() {
+        skipWs();
+        if (m_cur >= m_end) {
+            fail();
+        }
+        return *m_cur;
+    }
+
+    void expect(char c) {
+        if (peek() != c) {
+            fail();
+        }
+        m_cur++;
+    }
+
+    // 다음 문자가 c 이면 소비하고 true
+    bool consume(char c) {
+        if (peek() == c) {
+            m_cur++;
+            return true;
+        }
+        return false;
+    }
+
+    // object/array 의 다음 항목이 있는지 확인 (',' 이면 true, close 이면 false)
+    bool next(char close) {
+        char c = peek();
+        m_cur++;
+        if (c == ',') {
+            return true;
+        } else if (c == close) {
+            return false;
+        }
+        fail();
+        return false;
+    }
+
+    // 따옴표로 둘러싸인 문자열. escape 는 해석하지 않고 raw 문자열을 돌려줌 (key 비교용)
+    std::string_view string() {
+        expect('"');
+        const char *start = m_cur;
+        while (m_cur < m_end && *m_cur != '"') {
+            if (*m_cur == '\\') {
+                m_cur++;
+            }
+            m_cur++;
+        }
+        if (m_cur >= m_end) {
+            fail();
+        }
+        std::string_view sv(start, m_cur - start);
+        m_cur++;
+        return sv;
+    }
+
+    std::string_view key() {
+        std::string_view k = string();
+        expect(':');
+        return k;
+    }
+
+    // null 이면 false
+    bool number(double& value) {
+        char c = peek();
+        if (c == 'n') {
+            literal("null");
+            return false;
+        }
+        auto result = std::from_chars(m_cur, m_end, value);
+        if (result.ec != std::errc()) {
+            fail();
+        }
+        m_cur = result.ptr;
+        return true;
+    }
+
+    void skipValue() {
+        char c = peek();
+        if (c == '{') {
+            m_cur++;
+            if (consume('}')) {
+                return;
+            }
+            do {
+                key();
+                skipValue();
+            } while (next('}'));
+        } else if (c == '[') {
+            m_cur++;
+            if (consume(']')) {
+                return;
+            }
+            do {
+                skipValue();
+            } while (next(']'));
+        } else if (c == '"') {
+            string();
+        } else if (c == 't') {
+            literal("true");
+        } else if (c == 'f') {
+            literal("false");
+        } else if (c == 'n') {
+            literal("null");
+        } else {
+            double value;
+            number(value);
+        }
+    }
+
+    [[noreturn]] void fail() {
+        throw std::runtime_error(m_errorMessage);
+    }
+
+private:
+    void literal(std::string_view lit) {
+        if ((size_t) (m_end - m_cur) < lit.size() || std::string_view(m_cur, lit.size()) != lit) {
+            fail();
+        }
+        m_cur += lit.size();
+    }
+
+    const char *m_cur;
+    const char *m_end;
+    const char *m_errorMessage;
+};
+
+static inline int64_t costValue(bool valid, double value, double scale)
+{
+    return valid ? static_cast<int64_t>(std::ceil(value * scale)) : INT_MAX;
+}
+
+static void parseOsrmRows(
+    CJsonScanner& scanner,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& matrix)
+{
+    scanner.expect('[');
+    if (scanner.consume(']')) {
+        return;
+    }
+    size_t rowIdx = 0;
+    do {
+        if (rowIdx >= sources.size()) {
+            scanner.fail();
+        }
+        size_t baseIdx = (sources[rowIdx] + baseVehicle) * (nodeCount + 1) + baseVehicle;
+        scanner.expect('[');
+        if (!scanner.consume(']')) {
+            size_t colIdx = 0;
+            do {
+                if (colIdx >= destinations.size()) {
+                    scanner.fail();
+                }
+                double value;
+                bool valid = scanner.number(value);
+                matrix[baseIdx + destinations[colIdx++]] = costValue(valid, value, 1.0);
+            } while (scanner.next(']'));
+        }
+        rowIdx++;
+    } while (scanner.next(']'));
+}
+
+void parseOsrmTable(
+    const char *begin,
+    const char *end,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    CJsonScanner scanner(begin, end, "Fail to parse OSRM response");
+    scanner.expect('{');
+    if (scanner.consume('}')) {
+        return;
+    }
+    do {
+        std::string_view key = scanner.key();
+        if (key == "distances") {
+            parseOsrmRows(scanner, baseVehicle, nodeCount, sources, destinations, distMatrix);
+        } else if (key == "durations") {
+            parseOsrmRows(scanner, baseVehicle, nodeCount, sources, destinations, timeMatrix);
+        } else {
+            scanner.skipValue();
+        }
+    } while (scanner.next('}'));
+}
+
+static void parseValhallaCell(
+    CJsonScanner& scanner,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    int64_t distance_value = 0;
+    int64_t time_value = 0;
+    int to_index = -1;
+    int from_index = -1;
+
+    scanner.expect('{');
+    if (!scanner.consume('}')) {
+        do {
+            std::string_view key = scanner.key();
+            double value;
+            if (key == "distance") {
+                bool valid = scanner.number(value);
+                distance_value = costValue(valid, value, 1000.0);
+            } else if (key == "time") {
+                bool valid = scanner.number(value);
+                time_value = costValue(valid, value, 1.0);
+            } else if (key == "to_index") {
+                to_index = scanner.number(value) ? (int) value : -1;
+            } else if (key == "from_index") {
+                from_index = scanner.number(value) ? (int) value : -1;
+            } else {
+                scanner.skipValue();
+            }
+        } while (scanner.next('}'));
+    }
+
+    if (to_index != -1 && from_index != -1) {
+        if (from_index >= (int) sources.size() || to_index >= (int) destinations.size()) {
+            scanner.fail();
+        }
+        size_t idx = (sources[from_index] + baseVehicle) * (nodeCount + 1) + (destinations[to_index] + baseVehicle);
+        distMatrix[idx] = distance_value;
+        timeMatrix[idx] = time_value;
+    }
+}
+
+void parseValhallaMatrix(
+    const char *begin,
+    const char *end,
+    const size_t baseVehicle,
+    const size_t nodeCount,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    CJsonScanner scanner(begin, end, "Fail to parse Valhalla response");
+    scanner.expect('{');
+    if (scanner.consume('}')) {
+        return;
+    }
+    do {
+        std::string_view key = scanner.key();
+        if (key != "sources_to_targets") {
+            scanner.skipValue();
+            continue;
+        }
+        scanner.expect('[');
+        if (scanner.consume(']')) {
+            continue;
+        }
+        do {
+            scanner.expect('[');
+            if (scanner.consume(']')) {
+                continue;
+            }
+            do {
+                parseValhallaCell(scanner, baseVehicle, nodeCount, sources, destinations, distMatrix, timeMatrix);
+            } while (scanner.next(']'));
+        } while (scanner.next(']'));
+    } while (scanner.next('}'));
+}
@@ -0,0 +1,272 @@
+#include <iostream>
+#include <climits>
+#include <cmath>
+#include <unordered_map>
+#include <algorithm>
+#include <modState.h>
+#include <insertionEvaluator.h>
+#include <exactSolver.h>
+
+#define EXACT_MAX_ASSIGNMENTS   100000  // demand 를 vehicle 에 배정하는 조합 수가 이보다 많으면 LNS 로 풂
+
+extern std::string logNow();
+
+namespace {
+
+struct ExactRequest {
+    int pickup;     // onboard demand 는 -1
+    int delivery;
+    std::vector<size_t> vehicles;
+};
+
+class CExactSearch {
+public:
+    CExactSearch(const SolveInput& input, const AlgorithmParameters* ap)
+        : m_input(input), m_ms(input.modState), m_penalty(ap->delaytime_penalty), m_waitPenalty(ap->waittime_penalty) {}
+
+    bool prepare();
+    bool run(std::vector<int>& routes, int64_t& score);
+
+private:
+    struct RouteResult {
+        bool feasible = false;
+        int64_t score = 0;
+        std::vector<int> stops;
+    };
+
+    int64_t cost(int from, int to) const { return m_input.costMatrix[from * (m_input.nodeCount + 1) + to]; }
+    int64_t travel(int from, int to) const { return m_input.timeMatrix[from * (m_input.nodeCount + 1) + to]; }
+
+    const RouteResult& bestRoute(size_t vehicle, uint32_t mask);
+    void searchRoute(size_t vehicle, int last, int64_t departure, int64_t load, uint64_t visited, int64_t score, std::vector<int>& sequence, RouteResult& best);
+    void assign(size_t r, std::vector<uint32_t>& masks, std::vector<int>& routes, int64_t& best);
+
+    const SolveInput& m_input;
+    const CModState& m_ms;
+    double m_penalty;
+    double m_waitPenalty;
+    std::vector<ExactRequest> m_requests;
+    std::unordered_map<uint64_t, RouteResult> m_memo;
+
+    // searchRoute 중인 vehicle 의 stop (pickup 이 있으면 pickup 의 stop index)
+    std::vector<int> m_stops;
+    std::vector<int> m_required;
+};
+
+bool CExactSearch::prepare()
+{
+    size_t vehicleCount = m_input.vehicleCount;
+    size_t nodeCount = m_input.nodeCount;
+    std::vector<bool> covered(nodeCount + 1, false);
+    for (size_t node = vehicleCount + 1; node <= nodeCount; node++) {
+        if (covered[node]) {
+            continue;
+        }
+        ExactRequest request;
+        if (m_ms.deliverySibling[node] > 0) {
+            request.pickup = (int) node;
+            request.delivery = m_ms.deliverySibling[node];
+        } else if (m_ms.pickupSibling[node] == 0 && m_ms.demands[node] < 0) {
+            request.pickup = -1;  // onboard
+            request.delivery = (int) node;
+        } else {
+            return false;
+        }
+        if (request.delivery <= (int) vehicleCount || request.delivery > (int) nodeCount || covered[request.delivery]) {
+            return false;
+        }
+        for (size_t v = 0; v < vehicleCount; v++) {
+            bool allowed = isVehicleAllowed(m_ms.fixedAssignment[request.delivery], v, vehicleCount);
+            if (request.pickup >= 0) {
+                allowed = allowed && isVehicleAllowed(m_ms.fixedAssignment[request.pickup], v, vehicleCount);
+            }
+            if (allowed) {
+                request.vehicles.push_back(v);
+            }
+        }
+        if (request.vehicles.empty()) {
+            return false;
+        }
+        if (request.pickup >= 0) {
+            covered[request.pickup] = true;
+        }
+        covered[request.delivery] = true;
+        m_requests.push_back(std::move(request));
+    }
+    if (m_requests.size() > EXACT_MAX_REQUESTS) {
+        return false;
+    }
+    double assignments = 1;
+    for (auto& request : m_requests) {
+        assignments *= request.vehicles.size();
+    }
+    return assignments <= EXACT_MAX_ASSIGNMENTS;
+}
+
+void CExactSearch::searchRoute(size_t vehicle, int last, int64_t departure, int64_t load, uint64_t visited, int64_t score, std::vector<int>& sequence, RouteResult& best)
+{
+    if (best.feasible && score >= best.score) {
+        return;
+    }
+    size_t count = m_stops.size();
+    if (sequence.size() == count) {
+        int start = m_ms.startDepots[vehicle];
+        int64_t endLatest = std::min(m_ms.latestArrival[0], m_ms.latestArrival[start]);
+        if (travel(last, 0) >= INT_MAX || departure + travel(last, 0) > endLatest) {
+            return;
+        }
+        int64_t total = score + cost(last, 0);
+        if (!best.feasible || total < best.score) {
+            best.feasible = true;
+            best.score = total;
+            best.stops = sequence;
+        }
+        return;
+    }
+    int64_t capacity = m_ms.vehicleCapacities[vehicle];
+    for (size_t k = 0; k < count; k++) {
+        if ((visited >> k) & 1) {
+            continue;
+        }
+        if (m_required[k] >= 0 && !((visited >> m_required[k]) & 1)) {
+            continue;  // pickup 전에 delivery 할 수 없음
+        }
+        int node = m_stops[k];
+        int64_t t = travel(last, node);
+        int64_t c = cost(last, node);
+        if (t >= INT_MAX || c >= INT_MAX) {
+            continue;
+        }
+        int64_t arrival = departure + t;
+        if (arrival > m_ms.latestArrival[node]) {
+            continue;
+        }
+        int64_t nextLoad = load + m_ms.demands[node];
+        if (capacity > 0 && nextLoad > capacity) {
+            continue;
+        }
+        int64_t delay = std::max<int64_t>(0, arrival - m_ms.acceptableArrival[node]);
+        int64_t wait = std::max<int64_t>(0, m_ms.earliestArrival[node] - arrival);
+        int64_t nextScore = score + c + (int64_t) std::llround(m_penalty * delay) + (int64_t) std::llround(m_waitPenalty * wait);
+        int64_t nextDeparture = std::max(arrival, m_ms.earliestArrival[node]) + m_ms.serviceTimes[node];
+        sequence.push_back(node);
+        searchRoute(vehicle, node, nextDeparture, nextLoad, visited | (1ull << k), nextScore, sequence, best);
+        sequence.pop_back();
+    }
+}
+
+const CExactSearch::RouteResult& CExactSearch::bestRoute(size_t vehicle, uint32_t mask)
+{
+    uint64_t key = ((uint64_t) vehicle << EXACT_MAX_REQUESTS) | mask;
+    auto it = m_memo.find(key);
+    if (it != m_memo.end()) {
+        return it->second;
+    }
+
+    m_stops.clear();
+    m_required.clear();
+    int64_t load = 0;
+    for (size_t r = 0; r < m_requests.size(); r++) {
+        if (!((mask >> r) & 1)) {
+            continue;
+        }
+        auto& request = m_requests[r];
+        if (request.pickup >= 0) {
+            m_stops.push_back(request.pickup);
+            m_required.push_back(-1);
+            m_stops.push_back(request.delivery);
+            m_required.push_back((int) m_stops.size() - 2);
+        } else {
+            m_stops.push_back(request.delivery);
+            m_required.push_back(-1);
+            load -= m_ms.demands[request.delivery];
+        }
+    }
+
+    RouteResult result;
+    int start = m_ms.startDepots[vehicle];
+    int64_t capacity = m_ms.vehicleCapacities[vehicle];
+    if (capacity <= 0 || load <= capacity) {
+        std::vector<int> sequence;
+        int64_t departure = std::max<int64_t>(0, m_ms.earliestArrival[start]) + m_ms.serviceTimes[start];
+        searchRoute(vehicle, start, departure, load, 0, 0, sequence, result);
+    }
+    return m_memo.emplace(key, std::move(result)).first->second;
+}
+
+void CExactSearch::assign(size_t r, std::vector<uint32_t>& masks, std::vector<int>& routes, int64_t& best)
+{
+    if (r == m_requests.size()) {
+        int64_t total = 0;
+        for (size_t v = 0; v < masks.size(); v++) {
+            auto& route = bestRoute(v, masks[v]);
+            if (!route.feasible) {
+                return;
+            }
+            total += route.score;
+            if (best >= 0 && total >= best) {
+                return;
+            }
+        }
+        best = total;
+        routes.clear();
+        for (size_t v = 0; v < masks.size(); v++) {
+            if (masks[v] == 0) {
+                continue;
+            }
+            routes.push_back(m_ms.startDepots[v]);
+            auto& stops = bestRoute(v, masks[v]).stops;
+            routes.insert(routes.end(), stops.begin(), stops.end());
+            routes.push_back(0);
+        }
+        return;
+    }
+    for (size_t v : m_requests[r].vehicles) {
+        masks[v] |= 1u << r;
+        assign(r + 1, masks, routes, best);
+        masks[v] &= ~(1u << r);
+    }
+}
+
+bool CExactSearch::run(std::vector<int>& routes, int64_t& score)
+{
+    std::vector<uint32_t> masks(m_input.vehicleCount, 0);
+    int64_t best = -1;
+    assign(0, masks, routes, best);
+    score = best;
+    return best >= 0;
+}
+
+}
+
+std::vector<int> solveExactRoutes(const SolveInput& input, const AlgorithmParameters* ap, int64_t* score)
+{
+    std::vector<int> routes;
+    CExactSearch search(input, ap);
+    int64_t best = -1;
+    if (!search.prepare() || !search.run(routes, best)) {
+        routes.clear();
+    }
+    if (score) {
+        *score = best;
+    }
+    return routes;
+}
+
+Solution* solveExact(const SolveInput& input, const AlgorithmParameters* ap, bool showLog)
+{
+    int64_t score = -1;
+    auto routes = solveExactRoutes(input, ap, &score);
+    if (showLog) {
+        std::cout << logNow() << " exact : node=" << input.nodeCount << "  score=" << score << std::endl;
+    }
+    if (routes.empty()) {
+        return nullptr;
+    }
+    CModState modState = input.modState;
+    modState.initialSolution = std::move(routes);
+    SolveInput exactInput{ input.nodeCount, input.vehicleCount, input.costMatrix, input.distMatrix, input.timeMatrix, modState };
+    AlgorithmParameters parameter = *ap;
+    parameter.nb_iterations = EXACT_POLISH_ITERATIONS;
+    return solveLns(exactInput, &parameter);
+}
@@ -0,0 +1,321 @@
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <modState.h>
+#include <threadPool.h>
+#include <solverPortfolio.h>
+#include <insertionEvaluator.h>
+
+bool isBetterInsertion(const InsertionOption& a, const InsertionOption& b)
+{
+    if (a.acceptable != b.acceptable) {
+        return a.acceptable;
+    }
+    if (a.costDelta != b.costDelta) {
+        return a.costDelta < b.costDelta;
+    }
+    return a.pickupArrival < b.pickupArrival;
+}
+
+CInsertionEvaluator::CInsertionEvaluator(
+    const CModState& modState,
+    size_t nodeCount,
+    size_t vehicleCount,
+    const std::vector<int64_t>& costMatrix,
+    const std::vector<int64_t>& timeMatrix)
+    : m_modState(modState), m_nodeCount(nodeCount), m_vehicleCount(vehicleCount), m_cost(costMatrix), m_time(timeMatrix)
+{
+    m_routes.resize(vehicleCount);
+    std::vector<bool> hasRoute(vehicleCount, false);
+    auto& initial = modState.initialSolution;
+    for (size_t i = 0; i < initial.size(); ) {
+        int start = initial[i];
+        size_t end = i + 1;
+        while (end < initial.size() && initial[end] != 0) {
+            end++;
+        }
+        if (start >= 1 && start <= (int) vehicleCount && end < initial.size()) {
+            std::vector<int> nodes(initial.begin() + i, initial.begin() + end + 1);
+            buildRoute(start - 1, std::move(nodes));
+            hasRoute[start - 1] = true;
+        }
+        i = end + 1;
+    }
+    for (size_t v = 0; v < vehicleCount; v++) {
+        if (!hasRoute[v]) {
+            buildRoute(v, { modState.startDepots[v], 0 });
+        }
+    }
+}
+
+bool isVehicleAllowed(int fixedAssignment, size_t vehicle, size_t vehicleCount)
+{
+    int assigned = (int) vehicle + 1;
+    if (fixedAssignment > 0) {
+        return fixedAssignment == assigned;
+    }
+    // 음수는 제외할 vehicle 목록 (reflectAssignedForNewDemandRoute 참고, vehicleCount + 1 진법)
+    for (int64_t excluded = -(int64_t) fixedAssignment; excluded > 0; excluded /= (int64_t) (vehicleCount + 1)) {
+        if (excluded % (int64_t) (vehicleCount + 1) == assigned) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CInsertionEvaluator::allowed(int node, size_t vehicle) const
+{
+    return isVehicleAllowed(m_modState.fixedAssignment[node], vehicle, m_vehicleCount);
+}
+
+void CInsertionEvaluator::buildRoute(size_t vehicle, std::vector<int> nodes)
+{
+    auto& ms = m_modState;
+    auto& route = m_routes[vehicle];
+    size_t length = nodes.size();
+    route.nodes = std::move(nodes);
+    route.arrival.assign(length, 0);
+    route.departure.assign(length, 0);
+    route.load.assign(length, 0);
+    route.slack.assign(length, 0);
+
+    int start = route.nodes[0];
+    int64_t load = 0;
+    for (size_t k = 1; k < length; k++) {
+        int node = route.nodes[k];
+        if (ms.demands[node] < 0 && ms.pickupSibling[node] == 0) {
+            load -= ms.demands[node];  // onboard demand
+        }
+    }
+    route.arrival[0] = std::max<int64_t>(0, ms.earliestArrival[start]);
+    route.departure[0] = route.arrival[0] + ms.serviceTimes[start];
+    route.load[0] = load;
+    for (size_t k = 1; k < length; k++) {
+        int prev = route.nodes[k - 1];
+        int node = route.nodes[k];
+        int64_t t = travel(prev, node);
+        route.arrival[k] = t >= INT_MAX ? INT_MAX : route.departure[k - 1] + t;
+        route.departure[k] = std::max(route.arrival[k], ms.earliestArrival[node]) + ms.serviceTimes[node];
+        route.load[k] = route.load[k - 1] + ms.demands[node];
+    }
+
+    // 뒤에서부터 도착 시간을 미룰 수 있는 시간 (이미 늦은 stop 은 더 늦어질 수 없음)
+    int64_t endLatest = std::min(ms.latestArrival[0], ms.latestArrival[start]);
+    route.slack[length - 1] = std::max<int64_t>(0, endLatest - route.arrival[length - 1]);
+    for (size_t k = length - 1; k-- > 1; ) {
+        int node = route.nodes[k];
+        int64_t wait = std::max<int64_t>(0, ms.earliestArrival[node] - route.arrival[k]);
+        route.slack[k] = std::min(std::max<int64_t>(0, ms.latestArrival[node] - route.arrival[k]), wait + route.slack[k + 1]);
+    }
+    route.slack[0] = route.slack.size() > 1 ? route.slack[1] : 0;
+}
+
+void CInsertionEvaluator::evaluateRoute(size_t vehicle, int pickup, int delivery, std::vector<InsertionOption>& options, bool bestOnly) const
+{
+    auto& ms = m_modState;
+    auto& route = m_routes[vehicle];
+    auto& nodes = route.nodes;
+    size_t length = nodes.size();
+    if (std::find(nodes.begin(), nodes.end(), pickup) != nodes.end()) {
+        return;  // 이미 route 에 있는 demand
+    }
+    int64_t capacity = ms.vehicleCapacities[vehicle];
+    int64_t demand = ms.demands[pickup];
+    auto overCapacity = [&](int64_t load) { return capacity > 0 && load + demand > capacity; };
+    auto reachable = [&](int from, int to) { return travel(from, to) < INT_MAX && cost(from, to) < INT_MAX; };
+
+    InsertionOption best;
+    bool found = false;
+    auto add = [&](InsertionOption& option) {
+        if (bestOnly) {
+            if (!found || isBetterInsertion(option, best)) {
+                best = option;
+            }
+        } else {
+            options.push_back(option);
+        }
+        found = true;
+    };
+
+    // 마지막 node (0) 뒤에는 넣지 않음
+    for (size_t i = 0; i + 1 < length; i++) {
+        int prevNode = nodes[i];
+        if (route.arrival[i] >= INT_MAX || overCapacity(route.load[i]) || !reachable(prevNode, pickup)) {
+            continue;
+        }
+        int64_t pickupArrival = route.departure[i] + travel(prevNode, pickup);
+        if (pickupArrival > ms.latestArrival[pickup]) {
+            continue;
+        }
+        int64_t pickupDeparture = std::max(pickupArrival, ms.earliestArrival[pickup]) + ms.serviceTimes[pickup];
+        int64_t pickupDelta = cost(prevNode, pickup) - cost(prevNode, nodes[i + 1]);
+
+        // delivery 를 pickup 바로 다음에 넣는 경우
+        int next = nodes[i + 1];
+        if (reachable(pickup, delivery) && reachable(delivery, next)) {
+            int64_t deliveryArrival = pickupDeparture + travel(pickup, delivery);
+            int64_t deliveryDeparture = std::max(deliveryArrival, ms.earliestArrival[delivery]) + ms.serviceTimes[delivery];
+            int64_t shift = deliveryDeparture + travel(delivery, next) - route.arrival[i + 1];
+            if (deliveryArrival <= ms.latestArrival[delivery] && shift <= route.slack[i + 1]) {
+                InsertionOption option;
+                option.vehicle = (int) vehicle;
+                option.pickupPos = (int) i;
+                option.deliveryPos = (int) i;
+                option.costDelta = pickupDelta + cost(pickup, delivery) + cost(delivery, next);
+                option.pickupArrival = pickupArrival;
+                option.deliveryArrival = deliveryArrival;
+                option.acceptable = pickupArrival <= ms.acceptableArrival[pickup] && deliveryArrival <= ms.acceptableArrival[delivery];
+                add(option);
+            }
+        }
+
+        // pickup 과 delivery 사이의 stop 들을 하나씩 늘려가며 다시 계산
+        if (!reachable(pickup, next)) {
+            continue;
+        }
+        pickupDelta += cost(pickup, next);
+        int64_t departure = pickupDeparture;
+        int prev = pickup;
+        for (size_t j = i + 1; j + 1 < length; j++) {
+            int node = nodes[j];
+            if (!reachable(prev, node)) {
+                break;
+            }
+            int64_t arrival = departure + travel(prev, node);
+            // 이후 delivery 위치도 모두 이 stop 을 pickup 한 상태로 지나감
+            if (arrival > std::max(ms.latestArrival[node], route.arrival[j]) || overCapacity(route.load[j])) {
+                break;
+            }
+            departure = std::max(arrival, ms.earliestArrival[node]) + ms.serviceTimes[node];
+            prev = node;
+
+            int after = nodes[j + 1];
+            if (!reachable(node, delivery) || !reachable(delivery, after)) {
+                continue;
+            }
+            int64_t deliveryArrival = departure + travel(node, delivery);
+            if (deliveryArrival > ms.latestArrival[delivery]) {
+                continue;
+            }
+            int64_t deliveryDeparture = std::max(deliveryArrival, ms.earliestArrival[delivery]) + ms.serviceTimes[delivery];
+            int64_t shift = deliveryDeparture + travel(delivery, after) - route.arrival[j + 1];
+            if (shift > route.slack[j + 1]) {
+                continue;
+            }
+            InsertionOption option;
+            option.vehicle = (int) vehicle;
+            option.pickupPos = (int) i;
+            option.deliveryPos = (int) j;
+            option.costDelta = pickupDelta + cost(node, delivery) + cost(delivery, after) - cost(node, after);
+            option.pickupArrival = pickupArrival;
+            option.deliveryArrival = deliveryArrival;
+            option.acceptable = pickupArrival <= ms.acceptableArrival[pickup] && deliveryArrival <= ms.acceptableArrival[delivery];
+            add(option);
+        }
+    }
+    if (bestOnly && found) {
+        options.push_back(best);
+    }
+}
+
+std::vector<InsertionOption> CInsertionEvaluator::evaluate(int pickup, size_t limit, bool bestPerVehicle) const
+{
+    std::vector<InsertionOption> options;
+    int delivery = m_modState.deliverySibling[pickup];
+    if (pickup <= 0 || pickup > (int) m_nodeCount || delivery <= 0) {
+        return options;
+    }
+    for (size_t v = 0; v < m_vehicleCount; v++) {
+        if (!allowed(pickup, v) || !allowed(delivery, v)) {
+            continue;
+        }
+        evaluateRoute(v, pickup, delivery, options, bestPerVehicle);
+    }
+    if (limit > 0 && limit < options.size()) {
+        std::partial_sort(options.begin(), options.begin() + limit, options.end(), isBetterInsertion);
+        options.resize(limit);
+    } else {
+        std::sort(options.begin(), options.end(), isBetterInsertion);
+    }
+    return options;
+}
+
+std::vector<std::vector<InsertionOption>> CInsertionEvaluator::evaluateBatch(const std::vector<int>& pickups, size_t limit, bool bestPerVehicle) const
+{
+    std::vector<std::vector<InsertionOption>> results(pickups.size());
+    if (pickups.empty()) {
+        return results;
+    }
+    // 호출한 thread 와 solver pool 의 worker 가 chunk 를 하나씩 가져가서 평가
+    // pool 이 다른 요청의 solver 로 바쁘면 호출한 thread 가 모두 평가하고, 늦게 시작한 worker 는 할 일이 없으면 바로 끝남
+    struct Batch {
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto batch = std::make_shared<Batch>();
+    size_t count = pickups.size();
+    auto work = [this, batch, count, &pickups, &results, limit, bestPerVehicle]() {
+        for (size_t begin; (begin = batch->next.fetch_add(INSERTION_BATCH_CHUNK)) < count; ) {
+            size_t end = std::min(count, begin + INSERTION_BATCH_CHUNK);
+            for (size_t i = begin; i < end; i++) {
+                results[i] = evaluate(pickups[i], limit, bestPerVehicle);
+            }
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->done += end - begin;
+            if (batch->done == count) {
+                batch->finished.notify_all();
+            }
+        }
+    };
+    size_t chunks = (count + INSERTION_BATCH_CHUNK - 1) / INSERTION_BATCH_CHUNK;
+    for (size_t k = 1; k < chunks; k++) {
+        // future 는 기다리지 않음 (chunk 를 가져가지 못한 worker 는 pickups, results 를 읽지 않음)
+        solverPool().enqueue(work);
+    }
+    work();
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&]() { return batch->done == count; });
+    return results;
+}
+
+std::vector<CModState> makeAlternativeStates(
+    const CModState& modState,
+    const CInsertionEvaluator& evaluator,
+    size_t vehicleCount,
+    size_t baseNewDemand,
+    size_t alternatives)
+{
+    std::vector<CModState> states;
+    size_t nodeCount = modState.demands.size() - 1;
+    std::vector<std::pair<int, std::vector<InsertionOption>>> rankings;
+    for (size_t pickup = baseNewDemand; pickup < nodeCount; pickup += 2) {
+        if (modState.fixedAssignment[pickup] > 0) {
+            continue;
+        }
+        rankings.push_back({ (int) pickup, evaluator.evaluate((int) pickup, alternatives, true) });
+    }
+    for (size_t k = 1; k <= alternatives; k++) {
+        CModState state = modState;
+        bool changed = false;
+        for (auto& [pickup, options] : rankings) {
+            int delivery = modState.deliverySibling[pickup];
+            for (size_t r = 0; r < k && r < options.size(); r++) {
+                int assigned = options[r].vehicle + 1;
+                state.fixedAssignment[pickup] = state.fixedAssignment[pickup] * (int) (vehicleCount + 1) - assigned;
+                state.fixedAssignment[delivery] = state.fixedAssignment[delivery] * (int) (vehicleCount + 1) - assigned;
+            }
+            // 이전 alternative 보다 더 제외한 vehicle 이 있는 경우만 새로운 alternative
+            changed = changed || options.size() >= k;
+        }
+        if (!changed) {
+            break;
+        }
+        states.push_back(std::move(state));
+    }
+    return states;
+}
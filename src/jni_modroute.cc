@@ -139,6 +139,8 @@ public:
         routeTypeOsrm = env->GetStaticObjectField(enumClass, enumFieldID);
         enumFieldID = env->GetStaticFieldID(enumClass, "Valhalla", "Lcom/ciel/microservices/dispatch_engine_service/mod_route/RouteType;");
         routeTypeValhalla = env->GetStaticObjectField(enumClass, enumFieldID);
+        enumFieldID = env->GetStaticFieldID(enumClass, "Local", "Lcom/ciel/microservices/dispatch_engine_service/mod_route/RouteType;");
+        routeTypeLocal = env->GetStaticObjectField(enumClass, enumFieldID);
 
         modDispatchSolutionClass = env->FindClass("com/ciel/microservices/dispatch_engine_service/mod_route/ModDispatchSolution");
         modDispatchSolutionConstructor = env->GetMethodID(modDispatchSolutionClass, "<init>", "(Ljava/util/List;Ljava/util/List;Ljava/util/List;JJ)V");
@@ -394,6 +396,8 @@ public:
             return RouteType::ROUTE_OSRM;
         } else if (env->CallBooleanMethod(object, equalsMethodID, routeTypeValhalla)) {
             return RouteType::ROUTE_VALHALLA;
+        } else if (env->CallBooleanMethod(object, equalsMethodID, routeTypeLocal)) {
+            return RouteType::ROUTE_LOCAL;
         }
         return RouteType::ROUTE_VALHALLA;
     }
@@ -656,6 +660,7 @@ private:
 
     jobject routeTypeOsrm;
     jobject routeTypeValhalla;
+    jobject routeTypeLocal;
 
     jclass modDispatchSolutionClass;
     jmethodID modDispatchSolutionConstructor;
@@ -4,6 +4,11 @@
 #include <stdexcept>
 #include "lib_modroute.h"
 #include "costCache.h"
+#include "costEstimator.h"
+#include "queryPlanner.h"
+#include "vehiclePrefetcher.h"
+#include "snapCache.h"
+#include "observedArcs.h"
 #include "requestLogger.h"
 
 
@@ -26,7 +31,8 @@ std::vector<ModDispatchSolution> run_optimize(
     }
     size_t vehicleCount = mod_request.vehicleLocs.size();
     std::unordered_map<int, ModRoute> mapNodeToModRoute = makeNodeToModRoute(mod_request, vehicleCount);
-    std::vector<Solution *> solutions = runOptimize(mod_request, route_path, route_type, route_tasks,  mapNodeToModRoute, ap, conf, false);
+    ModOptimizeStats stats;
+    std::vector<Solution *> solutions = runOptimize(mod_request, route_path, route_type, route_tasks,  mapNodeToModRoute, ap, conf, false, &stats);
     std::vector<ModDispatchSolution> dispatch_solutions;
     for (int i = 0; i < solutions.size(); i++) {
         auto solution = solutions[i];
@@ -61,13 +67,41 @@ std::vector<ModDispatchSolution> run_optimize(
         }
         dispatch_solution.total_distance = solution->distance;
         dispatch_solution.total_time = solution->time;
+        dispatch_solution.estimated_cells = stats.estimatedCells;
         dispatch_solutions.push_back(dispatch_solution);
         delete_solution(solution);
     }
     return dispatch_solutions;  
 }
 
+std::vector<ModRouteEvaluation> evaluate_routes(
+    ModRequest& mod_request,
+    std::string& route_path,
+    RouteType route_type,
+    int route_tasks,
+    std::string& cache_path,
+    struct ModRouteConfiguration& conf)
+{
+    if (!cache_path.empty()) {
+        g_costCache.loadStationCache(cache_path);
+    }
+    return runEvaluateRoutes(mod_request, route_path, route_type, route_tasks, conf, false);
+}
+
 void clear_cache() {
     g_costCache.clear();
     g_costCache.clearStationCache();
+    g_vehicleRowCache.clear();
+    g_snapCache.clear();
+    g_observedArcs.clear();
+    resetCircuitBreakers();
+}
+
+size_t update_vehicles(
+    std::vector<VehicleLocation>& vehicles,
+    std::string& route_path,
+    RouteType route_type)
+{
+    g_vehiclePrefetcher.start(route_path, route_type, false);
+    return g_vehiclePrefetcher.submit(vehicles);
 }
@@ -10,13 +10,20 @@
 #include <chrono>
 #include <iomanip>
 #include <ctime>
+#include <climits>
 #include <lnspdptw.h>
 #include <lnsModRoute.h>
 #include <modState.h>
 #include <queryOsrmCost.h>
 #include <queryValhallaCost.h>
+#include <queryLocalCost.h>
 #include <costCache.h>
+#include <queryPlanner.h>
+#include <observedArcs.h>
 #include <requestLogger.h>
+#include <vehiclePrefetcher.h>
+#include <solverPortfolio.h>
+#include <insertionEvaluator.h>
 
 std::string logNow()
 {
@@ -44,70 +51,12 @@ void applyVehicleAssignedTimeDistance(
     std::vector<int64_t>& distMatrix,
     std::vector<int64_t>& timeMatrix)
 {
-    if (modRequest.assigned.empty()) {
-        return;
-    } else if (modRequest.assigned[0].routeTimes.empty()) {
-        // assigned 가 있지만 routeTimes 가 비어있는 경우 바꿔야 할 것이 없으므로 그냥 리턴
-        return;
-    }
-    std::unordered_map<std::string, int> supplyIdToIdx;
-    std::unordered_map<std::string, int> demandIdToIdx;
-    size_t baseIdx = 0;
-    for (int i = 0; i < modRequest.vehicleLocs.size(); i++) {
-        supplyIdToIdx[modRequest.vehicleLocs[i].supplyIdx] = i;
-    }
-    baseIdx = modRequest.vehicleLocs.size();
-    for (int i = 0; i < modRequest.onboardDemands.size(); i++) {
-        // 여기에서 minus 1을 하는 이유는,
-        // 이후에 routeOrder 에서 pickup, drop off 를 구분할 때
-        // drop off 의 경우 ++ 해서 toIdx를 증가시키기 때문
-        // routeOrder 에서는 해당 demand가 onboard인지 waiting인지 구분할 수 없기 때문임
-        demandIdToIdx[modRequest.onboardDemands[i].id] = baseIdx + i - 1;
-    }
-    baseIdx += modRequest.onboardDemands.size();
-    for (int i = 0; i < modRequest.onboardWaitingDemands.size(); i++) {
-        demandIdToIdx[modRequest.onboardWaitingDemands[i].id] = baseIdx + i * 2;
-    }
-    baseIdx += 2 * modRequest.onboardWaitingDemands.size();
-    for (int i = 0; i < modRequest.newDemands.size(); i++) {
-        demandIdToIdx[modRequest.newDemands[i].id] = baseIdx + i * 2;
-    }
-    size_t baseVehicle = 1; // 0 = ghost depot 
-    for (const auto& vehicleAssigned : modRequest.assigned) {
-        if (vehicleAssigned.routeOrder.empty()) {
-            continue;
-        }
-        if (vehicleAssigned.routeOrder.size() != vehicleAssigned.routeTimes.size() || 
-            vehicleAssigned.routeOrder.size() != vehicleAssigned.routeDistances.size()) {
-            continue; // routeOrder, routeTimes, routeDistances 크기가 일치하지 않는 경우
-        }
-        std::string supplyIdx = vehicleAssigned.supplyIdx;
-        auto supplyIt = supplyIdToIdx.find(supplyIdx);
-        if (supplyIt == supplyIdToIdx.end()) {
-            continue; // 해당 공급 차량이 없는 경우
-        }
-        int fromIdx = supplyIt->second + baseVehicle;
-        for (int i = 0; i < vehicleAssigned.routeOrder.size(); i++) {
-            auto routeOrder = vehicleAssigned.routeOrder[i];
-            auto demandIt = demandIdToIdx.find(routeOrder.first);
-            if (demandIt == demandIdToIdx.end()) {
-                break; // 해당 demand가 없는 경우 이후 loop 중단
-            }
-            int toIdx = demandIt->second + baseVehicle;
-            if (routeOrder.second < 0) {
-                // drop off 인 경우이기 때문에 toIdx 증가
-                toIdx++; 
-            }
-            int cacheIdx = fromIdx * (nodeCount + 1) + toIdx;
-            if (vehicleAssigned.routeTimes[i] >= 0) {
-                timeMatrix[cacheIdx] = vehicleAssigned.routeTimes[i];
-            }
-            if (vehicleAssigned.routeDistances[i] >= 0) {
-                distMatrix[cacheIdx] = vehicleAssigned.routeDistances[i];
-            }
-            fromIdx = toIdx;
-        }
-    }
+    size_t baseVehicle = 1; // 0 = ghost depot
+    auto assignedArcs = collectAssignedArcs(modRequest);
+    // 이전 요청들의 route_times 로 관측한 stop -> stop 값을 먼저 채우고, 이번 요청의 값은 그 위에 덮어씀
+    applyObservedArcs(modRequest, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    recordObservedArcs(modRequest, assignedArcs);
+    applyAssignedArcs(assignedArcs, baseVehicle, nodeCount, distMatrix, timeMatrix);
 }
 
 int queryCostMatrix(
@@ -120,14 +69,19 @@ int queryCostMatrix(
     std::vector<int64_t>& timeMatrix,
     bool showLog)
 {
+    // 조회하는 동안 위치 update 의 prefetch 는 미룸
+    CForegroundQuery foreground;
+    int estimated = 0;
     if (eRouteType == ROUTE_OSRM) {
-        queryCostOsrm(modRequest, routePath, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog);
+        estimated = queryCostOsrm(modRequest, routePath, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog);
     } else if (eRouteType == ROUTE_VALHALLA) {
-        queryCostValhalla(modRequest, routePath, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog);
+        estimated = queryCostValhalla(modRequest, routePath, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog);
+    } else if (eRouteType == ROUTE_LOCAL) {
+        estimated = queryCostLocal(modRequest, routePath, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog);
     }
     applyVehicleAssignedTimeDistance(modRequest, nodeCount, distMatrix, timeMatrix);
 
-    return 0;
+    return estimated;
 }
 
 std::vector<int64_t> calcCost(std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix, OptimizeType optimizeType)
@@ -323,6 +277,35 @@ CModState loadToModState(
     return modState;
 }
 
+// dist, time matrix 를 조회하고 optimizeType 의 cost matrix 를 반환
+std::vector<int64_t> buildCostMatrix(
+    const ModRequest& modRequest,
+    const std::string& sRoutePath,
+    RouteType eRouteType,
+    int nRouteTasks,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix,
+    bool showLog,
+    ModOptimizeStats* stats)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    int estimated = queryCostMatrix(modRequest, sRoutePath, eRouteType, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog);
+    if (stats) {
+        stats->estimatedCells = estimated;
+    }
+    auto costMatrix = calcCost(distMatrix, timeMatrix, modRequest.optimizeType);
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    if (showLog) {
+        std::cout << logNow() << " queryCostMatrix : " << duration << " ms" << std::endl;
+    }
+    return costMatrix;
+}
+
 bool reflectAssignedForNewDemandRoute(CModState& modState, size_t vehicleCount, size_t baseNewDemand, const Solution* solution)
 {
     if (solution->n_missing > 0) {
@@ -360,7 +343,8 @@ std::vector<Solution *> runOptimize(
     std::unordered_map<int, ModRoute> mapNodeToModRoute,
     const struct AlgorithmParameters* ap,
     const struct ModRouteConfiguration& conf,
-    bool showLog)
+    bool showLog,
+    ModOptimizeStats* stats)
 {
     size_t vehicleCount = modRequest.vehicleLocs.size();
     size_t nodeCount = modRequest.vehicleLocs.size() + modRequest.onboardDemands.size()
@@ -368,18 +352,7 @@ std::vector<Solution *> runOptimize(
 
     std::vector<int64_t> distMatrix((nodeCount + 1) * (nodeCount + 1));
     std::vector<int64_t> timeMatrix((nodeCount + 1) * (nodeCount + 1));
-
-    auto start = std::chrono::high_resolution_clock::now();
-
-    queryCostMatrix(modRequest, sRoutePath, eRouteType, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog);
-    auto costMatrix = calcCost(distMatrix, timeMatrix, modRequest.optimizeType);
-
-    auto end = std::chrono::high_resolution_clock::now();
-
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    if (showLog) {
-        std::cout << logNow() << " queryCostMatrix : " << duration << " ms" << std::endl;
-    }
+    auto costMatrix = buildCostMatrix(modRequest, sRoutePath, eRouteType, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog, stats);
 
     auto modState = loadToModState(modRequest, nodeCount, vehicleCount, timeMatrix, conf);
 
@@ -387,26 +360,55 @@ std::vector<Solution *> runOptimize(
         logRequest(nodeCount, vehicleCount, costMatrix, distMatrix, timeMatrix, modState);
     }
 
-    start = std::chrono::high_resolution_clock::now();
+    // 모든 solver 가 같은 matrix, modState 를 읽음 (alternative 는 modState.fixedAssignment 를 바꿔서 다시 풂)
+    SolveInput solveInput{ nodeCount, vehicleCount, costMatrix, distMatrix, timeMatrix, modState };
+    size_t baseNewDemand = 1 + vehicleCount + modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size();
+
+    // alternative 의 제약을 insertion 순위로 미리 만들어서 첫 solution 과 같이 풂
+    std::vector<CModState> alternativeStates;
+    if (g_solvePolicy.parallelAlternatives && modRequest.maxSolutions > 1) {
+        CInsertionEvaluator evaluator(modState, nodeCount, vehicleCount, costMatrix, timeMatrix);
+        alternativeStates = makeAlternativeStates(modState, evaluator, vehicleCount, baseNewDemand, std::min(modRequest.maxSolutions - 1, conf.nSolutionLimit));
+    }
 
-    auto solution = solve_lns_pdptw(
-        nodeCount + 1, costMatrix.data(), distMatrix.data(), timeMatrix.data(),
-        modState.demands.data(), modState.serviceTimes.data(), modState.earliestArrival.data(), modState.latestArrival.data(), modState.acceptableArrival.data(),
-        modState.pickupSibling.data(), modState.deliverySibling.data(), modState.fixedAssignment.data(),
-        (int) vehicleCount, modState.vehicleCapacities.data(), modState.startDepots.data(), modState.endDepots.data(),
-        (int) modState.initialSolution.size(), modState.initialSolution.data(), ap
-    );
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Solution* solution = nullptr;
+    std::vector<Solution *> alternatives;
+    if (alternativeStates.empty()) {
+        solution = solvePortfolio(solveInput, ap, g_solvePolicy.portfolio, showLog);
+    } else {
+        std::vector<SolveInput> inputs = { solveInput };
+        for (auto& state : alternativeStates) {
+            inputs.push_back({ nodeCount, vehicleCount, costMatrix, distMatrix, timeMatrix, state });
+        }
+        auto solved = solveConcurrently(inputs, ap, g_solvePolicy.portfolio, showLog);
+        solution = solved[0];
+        alternatives.assign(solved.begin() + 1, solved.end());
+    }
 
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
     if (showLog) {
         std::cout << logNow() << " solve_lns_pdptw :";
         std::cout << "  demand=" << (nodeCount - vehicleCount);
         std::cout << "  route=" << (solution ? solution->n_routes : -1);
+        if (!alternativeStates.empty()) {
+            std::cout << "  alternatives=" << alternativeStates.size();
+        }
         std::cout << "  duration=" << duration << " ms" << std::endl;
     }
 
+    if (solution == nullptr || solution->n_missing > 0) {
+        // 순차로 풀 때처럼 첫 solution 이 모든 demand 를 배정하지 못하면 alternative 는 사용하지 않음
+        for (auto alternative : alternatives) {
+            if (alternative != nullptr) {
+                delete_solution(alternative);
+            }
+        }
+        alternatives.clear();
+    }
     if (solution == nullptr) {
         throw std::runtime_error("Fail to dispatch");
     }
@@ -420,8 +422,22 @@ std::vector<Solution *> runOptimize(
     }
 #endif
 
+    if (!alternativeStates.empty()) {
+        for (size_t i = 0; i < alternatives.size(); i++) {
+            if (alternatives[i] == nullptr) {
+                continue;
+            }
+            solutions.push_back(alternatives[i]);
+#ifndef NDEBUG
+            if (conf.bLogRequest) {
+                logResponse(modRequest, alternativeStates[i], nodeCount, vehicleCount, mapNodeToModRoute, distMatrix, timeMatrix, alternatives[i]);
+            }
+#endif
+        }
+        return solutions;
+    }
+
     if (modRequest.maxSolutions > 1) {
-        size_t baseNewDemand = 1 + vehicleCount + modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size();
         for (int nRemain = std::min(modRequest.maxSolutions - 1, conf.nSolutionLimit); nRemain > 0; nRemain--) {
             if (!reflectAssignedForNewDemandRoute(modState, vehicleCount, baseNewDemand, solution)) {
                 break;
@@ -429,13 +445,7 @@ std::vector<Solution *> runOptimize(
 
             start = std::chrono::high_resolution_clock::now();            
 
-            solution = solve_lns_pdptw(
-                nodeCount + 1, costMatrix.data(), distMatrix.data(), timeMatrix.data(),
-                modState.demands.data(), modState.serviceTimes.data(), modState.earliestArrival.data(), modState.latestArrival.data(), modState.acceptableArrival.data(),
-                modState.pickupSibling.data(), modState.deliverySibling.data(), modState.fixedAssignment.data(),
-                (int) vehicleCount, modState.vehicleCapacities.data(), modState.startDepots.data(), modState.endDepots.data(),
-                (int) modState.initialSolution.size(), modState.initialSolution.data(), ap
-            );
+            solution = solvePortfolio(solveInput, ap, g_solvePolicy.portfolio, showLog);
 
             end = std::chrono::high_resolution_clock::now();
             duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
@@ -463,6 +473,148 @@ std::vector<Solution *> runOptimize(
     return solutions;
 }
 
+std::vector<ModQuote> runQuote(
+    ModRequest& modRequest,
+    std::string& sRoutePath,
+    RouteType eRouteType,
+    int nRouteTasks,
+    const struct ModRouteConfiguration& conf,
+    bool showLog,
+    ModOptimizeStats* stats)
+{
+    size_t vehicleCount = modRequest.vehicleLocs.size();
+    size_t nodeCount = modRequest.vehicleLocs.size() + modRequest.onboardDemands.size()
+        + 2 * (modRequest.onboardWaitingDemands.size() + modRequest.newDemands.size());
+
+    // new demand 끼리는 같은 route 에 넣지 않으므로 서로 사이의 arc 는 조회하지 않음
+    modRequest.independentNewDemands = true;
+    std::vector<int64_t> distMatrix((nodeCount + 1) * (nodeCount + 1));
+    std::vector<int64_t> timeMatrix((nodeCount + 1) * (nodeCount + 1));
+    auto costMatrix = buildCostMatrix(modRequest, sRoutePath, eRouteType, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog, stats);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    auto modState = loadToModState(modRequest, nodeCount, vehicleCount, timeMatrix, conf);
+    CInsertionEvaluator evaluator(modState, nodeCount, vehicleCount, costMatrix, timeMatrix);
+    size_t maxOptions = modRequest.maxOptions > 0 ? modRequest.maxOptions : QUOTE_DEFAULT_OPTIONS;
+    size_t baseNewDemand = 1 + vehicleCount + modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size();
+
+    // new demand 마다 다른 new demand 없이 현재 route 에 넣는 경우를 평가
+    std::vector<int> pickups;
+    for (size_t i = 0; i < modRequest.newDemands.size(); i++) {
+        pickups.push_back((int) (baseNewDemand + 2 * i));
+    }
+    auto evaluated = evaluator.evaluateBatch(pickups, maxOptions, false);
+
+    std::vector<ModQuote> quotes;
+    for (size_t i = 0; i < modRequest.newDemands.size(); i++) {
+        ModQuote quote;
+        quote.id = modRequest.newDemands[i].id;
+        quote.demand = modRequest.newDemands[i].demand;
+        for (auto& option : evaluated[i]) {
+            ModInsertionOption insertion;
+            insertion.supplyIdx = modRequest.vehicleLocs[option.vehicle].supplyIdx;
+            insertion.pickupIndex = option.pickupPos;
+            insertion.destinationIndex = option.deliveryPos;
+            insertion.costDelta = option.costDelta;
+            insertion.pickupEta = option.pickupArrival;
+            insertion.destinationEta = option.deliveryArrival;
+            insertion.acceptable = option.acceptable;
+            quote.options.push_back(insertion);
+        }
+        quotes.push_back(std::move(quote));
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    if (showLog) {
+        std::cout << logNow() << " quote :";
+        std::cout << "  demand=" << modRequest.newDemands.size();
+        std::cout << "  duration=" << duration << " us" << std::endl;
+    }
+    return quotes;
+}
+
+std::vector<ModRouteEvaluation> runEvaluateRoutes(
+    ModRequest& modRequest,
+    std::string& sRoutePath,
+    RouteType eRouteType,
+    int nRouteTasks,
+    const struct ModRouteConfiguration& conf,
+    bool showLog,
+    ModOptimizeStats* stats)
+{
+    // new demand 가 없으면 모든 node 가 vehicle 에 고정되어서 서로 다른 vehicle 의 stop 사이는 조회하지 않음
+    // 같은 vehicle 의 stop 사이도 route 를 따라가는 arc 만 사용
+    ModRequest routeRequest = modRequest;
+    routeRequest.newDemands.clear();
+    routeRequest.routeArcsOnly = true;
+    size_t vehicleCount = routeRequest.vehicleLocs.size();
+    size_t nodeCount = vehicleCount + routeRequest.onboardDemands.size() + 2 * routeRequest.onboardWaitingDemands.size();
+
+    std::vector<int64_t> distMatrix((nodeCount + 1) * (nodeCount + 1));
+    std::vector<int64_t> timeMatrix((nodeCount + 1) * (nodeCount + 1));
+    auto costMatrix = buildCostMatrix(routeRequest, sRoutePath, eRouteType, nRouteTasks, nodeCount, distMatrix, timeMatrix, showLog, stats);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    auto modState = loadToModState(routeRequest, nodeCount, vehicleCount, timeMatrix, conf);
+    auto mapNodeToModRoute = makeNodeToModRoute(routeRequest, vehicleCount);
+    CInsertionEvaluator evaluator(modState, nodeCount, vehicleCount, costMatrix, timeMatrix);
+
+    std::vector<ModRouteEvaluation> evaluations;
+    for (size_t v = 0; v < vehicleCount; v++) {
+        auto& state = evaluator.routeState(v);
+        if (state.nodes.size() <= 2) {
+            continue;   // assigned 가 없는 vehicle
+        }
+        ModRouteEvaluation evaluation;
+        evaluation.supplyIdx = routeRequest.vehicleLocs[v].supplyIdx;
+        int64_t capacity = modState.vehicleCapacities[v];
+        // 마지막 node 는 ghost depot
+        for (size_t k = 1; k + 1 < state.nodes.size(); k++) {
+            int prev = state.nodes[k - 1];
+            int node = state.nodes[k];
+            size_t arc = prev * (nodeCount + 1) + node;
+            ModStopEvaluation stop;
+            stop.route = mapNodeToModRoute[node];
+            stop.load = state.load[k];
+            if (state.arrival[k] >= INT_MAX) {
+                evaluation.unreachable = true;
+            } else {
+                evaluation.distance += distMatrix[arc];
+                evaluation.time += timeMatrix[arc];
+                stop.arrival = state.arrival[k];
+                stop.departure = state.departure[k];
+                stop.slack = state.slack[k];
+                stop.late = stop.arrival > modState.latestArrival[node];
+                stop.unacceptable = stop.arrival > modState.acceptableArrival[node];
+            }
+            evaluation.overCapacity = evaluation.overCapacity || (capacity > 0 && stop.load > capacity);
+            evaluation.feasible = evaluation.feasible && !stop.late;
+            evaluation.stops.push_back(stop);
+        }
+        // 운행 종료 (ghost depot 도착) 는 vehicle 의 operation_time 종료 전이어야 함
+        int startNode = modState.startDepots[v];
+        int64_t endLatest = std::min(modState.latestArrival[0], modState.latestArrival[startNode]);
+        if (state.arrival.back() < INT_MAX) {
+            evaluation.endTime = state.arrival.back();
+            evaluation.lateEnd = evaluation.endTime > endLatest;
+        }
+        evaluation.feasible = evaluation.feasible && !evaluation.overCapacity && !evaluation.unreachable && !evaluation.lateEnd;
+        evaluations.push_back(std::move(evaluation));
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    if (showLog) {
+        std::cout << logNow() << " evaluate routes :";
+        std::cout << "  route=" << evaluations.size();
+        std::cout << "  duration=" << duration << " us" << std::endl;
+    }
+    return evaluations;
+}
+
 struct ModRouteConfiguration default_mod_configuraiton() 
 {
     struct ModRouteConfiguration configuration;
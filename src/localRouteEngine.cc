@@ -0,0 +1,272 @@
+#include <fstream>
+#include <cmath>
+#include <climits>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <localRouteEngine.h>
+#include <costEstimator.h>
+
+#define LOCAL_GRID_DEGREE   0.01    // snap 용 grid cell 크기 (약 1km)
+#define LOCAL_SNAP_RINGS    20      // grid 에서 찾지 못하면 전체 node 검색
+#define LOCAL_SNAP_SPEED    5.0     // 좌표와 snap 된 node 사이의 이동 속도 (m/s)
+#define EARTH_RADIUS        6371000.0
+
+int64_t CLocalRouteEngine::gridKey(int latIdx, int lngIdx) const
+{
+    return ((int64_t) latIdx << 32) ^ ((int64_t) lngIdx & 0xffffffff);
+}
+
+void CLocalRouteEngine::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Fail to open road graph: " + path);
+    }
+
+    size_t nodeCount = 0;
+    size_t edgeCount = 0;
+    if (!(file >> nodeCount >> edgeCount)) {
+        throw std::runtime_error("Invalid road graph header: " + path);
+    }
+
+    m_lat.resize(nodeCount);
+    m_lng.resize(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+        if (!(file >> m_lat[i] >> m_lng[i])) {
+            throw std::runtime_error("Invalid road graph node: " + path);
+        }
+    }
+
+    std::vector<int> from(edgeCount);
+    std::vector<Edge> edges(edgeCount);
+    for (size_t i = 0; i < edgeCount; i++) {
+        if (!(file >> from[i] >> edges[i].to >> edges[i].dist >> edges[i].time)) {
+            throw std::runtime_error("Invalid road graph edge: " + path);
+        }
+        if (from[i] < 0 || from[i] >= (int) nodeCount || edges[i].to < 0 || edges[i].to >= (int) nodeCount) {
+            throw std::runtime_error("Invalid road graph edge node: " + path);
+        }
+    }
+
+    // CSR 로 변환
+    m_offsets.assign(nodeCount + 1, 0);
+    for (size_t i = 0; i < edgeCount; i++) {
+        m_offsets[from[i] + 1]++;
+    }
+    for (size_t i = 0; i < nodeCount; i++) {
+        m_offsets[i + 1] += m_offsets[i];
+    }
+    m_edges.resize(edgeCount);
+    std::vector<size_t> pos(m_offsets.begin(), m_offsets.end() - 1);
+    for (size_t i = 0; i < edgeCount; i++) {
+        m_edges[pos[from[i]]++] = edges[i];
+    }
+
+    // snap 용 grid
+    std::vector<int64_t> keys(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+        keys[i] = gridKey((int) std::floor(m_lat[i] / LOCAL_GRID_DEGREE), (int) std::floor(m_lng[i] / LOCAL_GRID_DEGREE));
+    }
+    m_gridNodes.resize(nodeCount);
+    std::iota(m_gridNodes.begin(), m_gridNodes.end(), 0);
+    std::sort(m_gridNodes.begin(), m_gridNodes.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+    m_gridKeys.clear();
+    m_gridOffsets.clear();
+    for (size_t i = 0; i < nodeCount; i++) {
+        int64_t key = keys[m_gridNodes[i]];
+        if (m_gridKeys.empty() || m_gridKeys.back() != key) {
+            m_gridKeys.push_back(key);
+            m_gridOffsets.push_back(i);
+        }
+    }
+    m_gridOffsets.push_back(nodeCount);
+}
+
+int CLocalRouteEngine::snap(const Location& loc, double& snapDistance) const
+{
+    int best = -1;
+    snapDistance = 0.0;
+    if (m_lat.empty()) {
+        return best;
+    }
+
+    auto check = [&](int node) {
+        Location nodeLoc(m_lng[node], m_lat[node], -1);
+        double d = haversineDistance(loc, nodeLoc);
+        if (best == -1 || d < snapDistance) {
+            best = node;
+            snapDistance = d;
+        }
+    };
+
+    int latIdx = (int) std::floor(loc.lat / LOCAL_GRID_DEGREE);
+    int lngIdx = (int) std::floor(loc.lng / LOCAL_GRID_DEGREE);
+
+    // 0 ~ r ring 을 합친 사각형 밖에 있는 node 까지의 최소 거리
+    // 위도선까지는 경선을 따라간 거리, 경선은 대원이므로 대원까지의 거리 (경도 방향 cell 은 위도가 높을수록 좁음)
+    auto outsideDistance = [&](int r) {
+        constexpr double toRad = M_PI / 180.0;
+        double latMargin = std::min(loc.lat - (latIdx - r) * LOCAL_GRID_DEGREE, (latIdx + r + 1) * LOCAL_GRID_DEGREE - loc.lat);
+        double lngMargin = std::min(loc.lng - (lngIdx - r) * LOCAL_GRID_DEGREE, (lngIdx + r + 1) * LOCAL_GRID_DEGREE - loc.lng);
+        double latDistance = EARTH_RADIUS * latMargin * toRad;
+        double lngDistance = EARTH_RADIUS * std::asin(std::min(1.0, std::sin(lngMargin * toRad) * std::cos(loc.lat * toRad)));
+        return std::min(latDistance, lngDistance);
+    };
+
+    for (int r = 0; r <= LOCAL_SNAP_RINGS; r++) {
+        for (int dy = -r; dy <= r; dy++) {
+            for (int dx = -r; dx <= r; dx++) {
+                if (std::max(std::abs(dx), std::abs(dy)) != r) {
+                    continue;
+                }
+                auto it = std::lower_bound(m_gridKeys.begin(), m_gridKeys.end(), gridKey(latIdx + dy, lngIdx + dx));
+                if (it == m_gridKeys.end() || *it != gridKey(latIdx + dy, lngIdx + dx)) {
+                    continue;
+                }
+                size_t cell = it - m_gridKeys.begin();
+                for (size_t i = m_gridOffsets[cell]; i < m_gridOffsets[cell + 1]; i++) {
+                    check(m_gridNodes[i]);
+                }
+            }
+        }
+        // 찾은 node 가 확인하지 않은 ring 의 어떤 node 보다 가까워야 가장 가까운 node
+        if (best != -1 && snapDistance <= outsideDistance(r)) {
+            return best;
+        }
+    }
+    // ring 안에서 가장 가까운 node 를 확정하지 못하면 전체 node 검색
+    for (size_t i = 0; i < m_lat.size(); i++) {
+        check((int) i);
+    }
+    return best;
+}
+
+void CLocalRouteEngine::table(
+    const std::vector<Location>& sources,
+    const std::vector<Location>& destinations,
+    size_t threadCount,
+    std::vector<int64_t>& distTable,
+    std::vector<int64_t>& timeTable) const
+{
+    size_t cols = destinations.size();
+    distTable.assign(sources.size() * cols, INT_MAX);
+    timeTable.assign(sources.size() * cols, INT_MAX);
+    if (sources.empty() || cols == 0 || m_lat.empty()) {
+        return;
+    }
+
+    std::vector<int> sourceNode(sources.size());
+    std::vector<double> sourceSnap(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        sourceNode[i] = snap(sources[i], sourceSnap[i]);
+    }
+    std::vector<int> destNode(cols);
+    std::vector<double> destSnap(cols);
+    std::unordered_map<int, int> targetIdx;  // graph node -> target index
+    for (size_t j = 0; j < cols; j++) {
+        destNode[j] = snap(destinations[j], destSnap[j]);
+        targetIdx.emplace(destNode[j], (int) targetIdx.size());
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        size_t n = m_lat.size();
+        std::vector<int64_t> bestTime(n);
+        std::vector<int64_t> bestDist(n);
+        std::vector<uint32_t> reached(n, 0);
+        std::vector<uint32_t> settled(n, 0);
+        std::vector<int64_t> targetTime(targetIdx.size());
+        std::vector<int64_t> targetDist(targetIdx.size());
+        uint32_t stamp = 0;
+
+        using QueueItem = std::pair<int64_t, int>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+        for (size_t i = next++; i < sources.size(); i = next++) {
+            stamp++;
+            std::fill(targetTime.begin(), targetTime.end(), -1);
+            size_t remain = targetIdx.size();
+
+            // time 기준 최단 경로, 그 경로의 distance 를 같이 기록
+            int s = sourceNode[i];
+            bestTime[s] = 0;
+            bestDist[s] = 0;
+            reached[s] = stamp;
+            queue = {};
+            queue.push({0, s});
+            while (!queue.empty() && remain > 0) {
+                auto [t, u] = queue.top();
+                queue.pop();
+                if (settled[u] == stamp || t != bestTime[u]) {
+                    continue;
+                }
+                settled[u] = stamp;
+                auto it = targetIdx.find(u);
+                if (it != targetIdx.end()) {
+                    targetTime[it->second] = bestTime[u];
+                    targetDist[it->second] = bestDist[u];
+                    remain--;
+                }
+                for (size_t e = m_offsets[u]; e < m_offsets[u + 1]; e++) {
+                    auto& edge = m_edges[e];
+                    int64_t nt = t + edge.time;
+                    if (reached[edge.to] != stamp || nt < bestTime[edge.to]) {
+                        reached[edge.to] = stamp;
+                        bestTime[edge.to] = nt;
+                        bestDist[edge.to] = bestDist[u] + edge.dist;
+                        queue.push({nt, edge.to});
+                    }
+                }
+            }
+
+            for (size_t j = 0; j < cols; j++) {
+                size_t idx = i * cols + j;
+                if (destNode[j] == s) {
+                    // 같은 node 로 snap 되면 좌표 사이의 직선 거리 사용
+                    double d = haversineDistance(sources[i], destinations[j]);
+                    distTable[idx] = (int64_t) std::ceil(d);
+                    timeTable[idx] = (int64_t) std::ceil(d / LOCAL_SNAP_SPEED);
+                    continue;
+                }
+                int t = targetIdx.at(destNode[j]);
+                if (targetTime[t] < 0) {
+                    continue;
+                }
+                double snapDistance = sourceSnap[i] + destSnap[j];
+                distTable[idx] = targetDist[t] + (int64_t) std::ceil(snapDistance);
+                timeTable[idx] = targetTime[t] + (int64_t) std::ceil(snapDistance / LOCAL_SNAP_SPEED);
+            }
+        }
+    };
+
+    threadCount = std::max((size_t) 1, std::min(threadCount, sources.size()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<const CLocalRouteEngine> getLocalRouteEngine(const std::string& path)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const CLocalRouteEngine>> engines;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = engines.find(path);
+    if (it != engines.end()) {
+        return it->second;
+    }
+    auto engine = std::make_shared<CLocalRouteEngine>();
+    engine->load(path);
+    engines[path] = engine;
+    return engine;
+}
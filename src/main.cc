@@ -7,7 +7,15 @@
 #include <lnsModRoute.h>
 #include <queryOsrmCost.h>
 #include <queryValhallaCost.h>
+#include <queryLocalCost.h>
 #include <costCache.h>
+#include <routeFetcher.h>
+#include <costEstimator.h>
+#include <queryPlanner.h>
+#include <snapCache.h>
+#include <observedArcs.h>
+#include <solverPortfolio.h>
+#include <vehiclePrefetcher.h>
 #include <requestLogger.h>
 #include <main_utility.h>
 #include <eurekaClient.h>
@@ -68,11 +76,12 @@ std::string escapeJson(const std::string& input) {
 std::string makeResponse(
     const ModRequest& modRequest,
     std::unordered_map<int, ModRoute> mapNodeToModRoute,
-    std::vector<Solution *>& solutions)
+    std::vector<Solution *>& solutions,
+    const ModOptimizeStats& stats)
 {
     size_t vehicleCount = modRequest.vehicleLocs.size();
     std::ostringstream s_response;
-    s_response << "{\"status\":0,\"results\":[";
+    s_response << "{\"status\":0,\"estimated_cells\":" << stats.estimatedCells << ",\"results\":[";
     for (int i = 0; i < solutions.size(); i++) {
         auto solution = solutions[i];
         if (i > 0) {
@@ -86,6 +95,111 @@ std::string makeResponse(
     return s_response.str();
 }
 
+std::string makeQuoteResponse(const std::vector<ModQuote>& quotes, const ModOptimizeStats& stats)
+{
+    std::ostringstream s_response;
+    s_response << "{\"status\":0,\"estimated_cells\":" << stats.estimatedCells << ",\"quotes\":[";
+    for (size_t i = 0; i < quotes.size(); i++) {
+        auto& quote = quotes[i];
+        s_response << (i > 0 ? "," : "") << "{\"id\":\"" << escapeJson(quote.id) << "\",\"demand\":" << quote.demand;
+        s_response << ",\"feasible\":" << (quote.options.empty() ? "false" : "true") << ",\"options\":[";
+        for (size_t j = 0; j < quote.options.size(); j++) {
+            auto& option = quote.options[j];
+            s_response << (j > 0 ? "," : "") << "{\"supply_idx\":\"" << escapeJson(option.supplyIdx) << "\""
+                << ",\"pickup_index\":" << option.pickupIndex
+                << ",\"destination_index\":" << option.destinationIndex
+                << ",\"cost_delta\":" << option.costDelta
+                << ",\"pickup_eta\":" << option.pickupEta
+                << ",\"destination_eta\":" << option.destinationEta
+                << ",\"acceptable\":" << (option.acceptable ? "true" : "false") << "}";
+        }
+        s_response << "]}";
+    }
+    s_response << "]}";
+    return s_response.str();
+}
+
+// what-if 는 후보 trip (new demand) 마다 가장 좋은 insertion 하나만 응답
+std::string makeWhatIfResponse(const std::vector<ModQuote>& quotes, const ModOptimizeStats& stats)
+{
+    std::ostringstream s_response;
+    s_response << "{\"status\":0,\"estimated_cells\":" << stats.estimatedCells << ",\"candidates\":[";
+    for (size_t i = 0; i < quotes.size(); i++) {
+        auto& quote = quotes[i];
+        s_response << (i > 0 ? "," : "") << "{\"id\":\"" << escapeJson(quote.id) << "\",\"demand\":" << quote.demand;
+        if (quote.options.empty()) {
+            s_response << ",\"feasible\":false}";
+            continue;
+        }
+        auto& best = quote.options[0];
+        s_response << ",\"feasible\":true"
+            << ",\"supply_idx\":\"" << escapeJson(best.supplyIdx) << "\""
+            << ",\"cost_delta\":" << best.costDelta
+            << ",\"pickup_eta\":" << best.pickupEta
+            << ",\"destination_eta\":" << best.destinationEta
+            << ",\"acceptable\":" << (best.acceptable ? "true" : "false") << "}";
+    }
+    s_response << "]}";
+    return s_response.str();
+}
+
+std::string makeEvaluationResponse(const std::vector<ModRouteEvaluation>& evaluations, const ModOptimizeStats& stats)
+{
+    std::ostringstream s_response;
+    s_response << "{\"status\":0,\"estimated_cells\":" << stats.estimatedCells << ",\"vehicle_routes\":[";
+    for (size_t i = 0; i < evaluations.size(); i++) {
+        auto& evaluation = evaluations[i];
+        s_response << (i > 0 ? "," : "") << "{\"supply_idx\":\"" << escapeJson(evaluation.supplyIdx) << "\""
+            << ",\"feasible\":" << (evaluation.feasible ? "true" : "false")
+            << ",\"over_capacity\":" << (evaluation.overCapacity ? "true" : "false")
+            << ",\"unreachable\":" << (evaluation.unreachable ? "true" : "false")
+            << ",\"late_end\":" << (evaluation.lateEnd ? "true" : "false")
+            << ",\"end_time\":" << evaluation.endTime
+            << ",\"total_distance\":" << evaluation.distance
+            << ",\"total_time\":" << evaluation.time << ",\"routes\":[";
+        for (size_t j = 0; j < evaluation.stops.size(); j++) {
+            auto& stop = evaluation.stops[j];
+            s_response << (j > 0 ? "," : "") << "{\"id\":\"" << escapeJson(stop.route.id) << "\",\"demand\":" << stop.route.demand
+                << ",\"arrival_time\":" << stop.arrival
+                << ",\"departure_time\":" << stop.departure
+                << ",\"slack\":" << stop.slack
+                << ",\"load\":" << stop.load
+                << ",\"late\":" << (stop.late ? "true" : "false")
+                << ",\"unacceptable\":" << (stop.unacceptable ? "true" : "false") << "}";
+        }
+        s_response << "]}";
+    }
+    s_response << "]}";
+    return s_response.str();
+}
+
+// cost 근사 관련 누적 counter
+std::string makeStatsResponse()
+{
+    auto approx = g_costCache.stationApproxStats();
+    auto snap = g_snapCache.stats();
+    auto observed = g_observedArcs.stats();
+    std::ostringstream s_response;
+    s_response << "{\"status\":0,\"station_approx\":{"
+        << "\"approximated_nodes\":" << approx.approximatedNodes
+        << ",\"approximated_cells\":" << approx.approximatedCells
+        << ",\"verified_cells\":" << approx.verifiedCells
+        << ",\"underestimated_cells\":" << approx.underestimated
+        << ",\"mean_time_error\":" << (approx.verifiedCells > 0 ? approx.timeErrorSum / approx.verifiedCells : 0.0)
+        << ",\"max_time_error\":" << approx.timeErrorMax
+        << "},\"snap\":{"
+        << "\"resolved\":" << snap.resolved
+        << ",\"failed\":" << snap.failed
+        << ",\"hits\":" << snap.hits
+        << ",\"misses\":" << snap.misses
+        << "},\"observed\":{"
+        << "\"pairs\":" << observed.pairs
+        << ",\"recorded\":" << observed.recorded
+        << ",\"applied_cells\":" << observed.applied
+        << "}}";
+    return s_response.str();
+}
+
 std::mutex g_httpLogMutex;
 
 void logHttpRequest(const httplib::Request &req, const httplib::Response &res) {
@@ -135,6 +249,9 @@ int main(int argc, char **argv)
     int nRouteTasks = 4;
     std::string sCacheDir = "";
     std::string sInitCacheKey = "";
+    int nNewDemandCacheTime = NEW_DEMAND_CACHE_MAX_AGE;
+    int nStationApproxAnchors = 0;
+    double dStationApproxRadius = STATION_APPROX_RADIUS;
     std::string sEurekaUrl = "";
     std::string sEurekaHost = "localhost";
     RouteType eRouteType = ROUTE_VALHALLA;
@@ -164,6 +281,8 @@ int main(int argc, char **argv)
                 eRouteType = ROUTE_OSRM;
             } else if (type == "VALHALLA") {
                 eRouteType = ROUTE_VALHALLA;
+            } else if (type == "LOCAL") {
+                eRouteType = ROUTE_LOCAL;
             } else {
                 std::cerr << "Invalid route type: " << type << std::endl;
                 return 1;
@@ -184,6 +303,12 @@ int main(int argc, char **argv)
             conf.nAcceptableBuffer = std::stoi(argv[++i]);
         } else if (arg == "--cache-expiration-time" && i + 1 < argc) {
             conf.nCacheExpirationTime = std::stoi(argv[++i]);
+        } else if (arg == "--new-demand-cache-time" && i + 1 < argc) {
+            nNewDemandCacheTime = std::stoi(argv[++i]);
+        } else if (arg == "--station-approx" && i + 1 < argc) {
+            nStationApproxAnchors = std::stoi(argv[++i]);
+        } else if (arg == "--station-approx-radius" && i + 1 < argc) {
+            dStationApproxRadius = std::stod(argv[++i]);
         } else if (arg == "--delaytime-penalty" && i + 1 < argc) {
             parameter.delaytime_penalty = std::stod(argv[++i]);
         } else if (arg == "--waittime-penalty" && i + 1 < argc) {
@@ -200,6 +325,52 @@ int main(int argc, char **argv)
             sInitCacheKey = argv[++i];
         } else if (arg == "--max-solution-limit" && i + 1 < argc) {
             conf.nSolutionLimit = std::stoi(argv[++i]);
+        } else if (arg == "--route-timeout" && i + 1 < argc) {
+            g_routeFetchPolicy.tileTimeout = std::stoi(argv[++i]);
+        } else if (arg == "--route-retries" && i + 1 < argc) {
+            g_routeFetchPolicy.maxRetries = std::stoi(argv[++i]);
+        } else if (arg == "--route-budget" && i + 1 < argc) {
+            g_routeFetchPolicy.budget = std::stoi(argv[++i]);
+        } else if (arg == "--route-hedge-delay" && i + 1 < argc) {
+            g_routeFetchPolicy.hedgeMinDelay = std::stoi(argv[++i]);
+        } else if (arg == "--no-route-hedge") {
+            g_routeFetchPolicy.hedge = false;
+        } else if (arg == "--no-cost-estimate") {
+            g_costEstimatePolicy.enabled = false;
+        } else if (arg == "--breaker-failures" && i + 1 < argc) {
+            g_costEstimatePolicy.breakerFailures = std::stoi(argv[++i]);
+        } else if (arg == "--breaker-cooldown" && i + 1 < argc) {
+            g_costEstimatePolicy.breakerCooldown = std::stoi(argv[++i]);
+        } else if (arg == "--candidate-vehicles" && i + 1 < argc) {
+            g_queryPlanPolicy.candidateVehicles = std::stoi(argv[++i]);
+        } else if (arg == "--prune-speed" && i + 1 < argc) {
+            g_queryPlanPolicy.pruneSpeed = std::stod(argv[++i]);
+        } else if (arg == "--dedup-radius" && i + 1 < argc) {
+            g_queryPlanPolicy.dedupRadius = std::stod(argv[++i]);
+        } else if (arg == "--row-reuse-radius" && i + 1 < argc) {
+            g_queryPlanPolicy.rowReuseRadius = std::stod(argv[++i]);
+        } else if (arg == "--row-reuse-along" && i + 1 < argc) {
+            g_queryPlanPolicy.rowReuseAlong = std::stod(argv[++i]);
+        } else if (arg == "--row-reuse-heading" && i + 1 < argc) {
+            g_queryPlanPolicy.rowReuseHeading = std::stoi(argv[++i]);
+        } else if (arg == "--row-reuse-age" && i + 1 < argc) {
+            g_queryPlanPolicy.rowReuseMaxAge = std::stoi(argv[++i]);
+        } else if (arg == "--snap-cell" && i + 1 < argc) {
+            g_queryPlanPolicy.snapCell = std::stod(argv[++i]);
+        } else if (arg == "--prefetch-idle" && i + 1 < argc) {
+            g_queryPlanPolicy.prefetchIdle = std::stoi(argv[++i]);
+        } else if (arg == "--observed-min-samples" && i + 1 < argc) {
+            g_queryPlanPolicy.observedMinSamples = std::stoi(argv[++i]);
+        } else if (arg == "--observed-max-age" && i + 1 < argc) {
+            g_queryPlanPolicy.observedMaxAge = std::stoi(argv[++i]);
+        } else if (arg == "--portfolio" && i + 1 < argc) {
+            g_solvePolicy.portfolio = std::stoi(argv[++i]);
+        } else if (arg == "--portfolio-threads" && i + 1 < argc) {
+            g_solvePolicy.portfolioThreads = std::stoi(argv[++i]);
+        } else if (arg == "--parallel-alternatives") {
+            g_solvePolicy.parallelAlternatives = true;
+        } else if (arg == "--exact-max-nodes" && i + 1 < argc) {
+            g_solvePolicy.exactMaxNodes = std::stoi(argv[++i]);
         } else if (arg == "--eureka-app" && i + 1 < argc) {
             appName = argv[++i];
         } else if (arg == "--eureka-url" && i + 1 < argc) {
@@ -211,14 +382,40 @@ int main(int argc, char **argv)
             std::cout << "Options:" << std::endl;
             std::cout << "  --port <port> : Server port (default: 8080)" << std::endl;
             std::cout << "  --host <host> : Server host (default: localhost)" << std::endl;
-            std::cout << "  --route-path <url> : Route service path (default: http://localhost:8002)" << std::endl;
-            std::cout << "  --route-type <type> : Route service type [OSRM|VALHALLA] (default: VALHALLA)" << std::endl;
-            std::cout << "  --route-tasks <count> : Number of route tasks (default: 4)" << std::endl;
+            std::cout << "  --route-path <url>[,<url>...] : Route service path (comma separated for multiple backends), or road graph file for LOCAL (default: http://localhost:8002)" << std::endl;
+            std::cout << "  --route-type <type> : Route service type [OSRM|VALHALLA|LOCAL] (default: VALHALLA)" << std::endl;
+            std::cout << "  --route-tasks <count> : Number of route tasks per backend (default: 4)" << std::endl;
+            std::cout << "  --route-timeout <ms> : Deadline for each routing tile request (default: 3000)" << std::endl;
+            std::cout << "  --route-retries <count> : Retries for failed routing tile requests (default: 2)" << std::endl;
+            std::cout << "  --route-budget <ms> : Overall budget for building the cost matrix, 0 for unlimited (default: 0)" << std::endl;
+            std::cout << "  --route-hedge-delay <ms> : Minimum delay before sending a hedged tile request (default: 50)" << std::endl;
+            std::cout << "  --no-route-hedge : Disable hedged routing tile requests" << std::endl;
+            std::cout << "  --no-cost-estimate : Fail the request instead of estimating costs when routing fails" << std::endl;
+            std::cout << "  --breaker-failures <count> : Consecutive routing failures before using estimates only (default: 3)" << std::endl;
+            std::cout << "  --breaker-cooldown <ms> : Time before retrying routing after the breaker opens (default: 10000)" << std::endl;
+            std::cout << "  --candidate-vehicles <count> : Nearest vehicles queried for each new demand, 0 for all (default: 50)" << std::endl;
+            std::cout << "  --prune-speed <m/s> : Max speed for straight-line pruning of unreachable pickups, 0 to disable (default: 30)" << std::endl;
+            std::cout << "  --dedup-radius <m> : Grid size for querying nearby locations without station once, 0 to disable (default: 5)" << std::endl;
+            std::cout << "  --row-reuse-radius <m> : Reuse the vehicle row when the vehicle moved less than this, 0 to disable (default: 30)" << std::endl;
+            std::cout << "  --row-reuse-along <m> : Reuse the vehicle row when the vehicle moved forward along its heading less than this (default: 150)" << std::endl;
+            std::cout << "  --row-reuse-heading <degree> : Heading tolerance for the along-heading reuse (default: 30)" << std::endl;
+            std::cout << "  --row-reuse-age <seconds> : Max age of a reused vehicle row (default: 60)" << std::endl;
+            std::cout << "  --snap-cell <m> : Distance within which snap-to-road results of locations without station are reused, 0 to disable (default: 5)" << std::endl;
+            std::cout << "  --prefetch-idle <seconds> : Prefetch vehicle rows on position updates until this long after the last optimize, 0 to disable (default: 600)" << std::endl;
+            std::cout << "  --observed-min-samples <count> : Observed route_times samples needed before using them for stop to stop arcs, 0 to disable (default: 3)" << std::endl;
+            std::cout << "  --observed-max-age <seconds> : Max age of observed route_times samples, 0 for unlimited (default: 604800)" << std::endl;
+            std::cout << "  --portfolio <count> : Solvers run concurrently per request with different seeds and parameter presets, 1 to disable (default: 1)" << std::endl;
+            std::cout << "  --portfolio-threads <count> : Worker threads shared by portfolio solvers and insertion evaluation of all requests, 0 for cores - 1 (default: 0)" << std::endl;
+            std::cout << "  --parallel-alternatives : Solve max_solution_number alternatives concurrently with constraints from an insertion pass" << std::endl;
+            std::cout << "  --exact-max-nodes <count> : Solve requests with up to this many nodes by exact search before LNS, 0 to disable (default: 10)" << std::endl;
             std::cout << "  --max-duration <seconds> : Maximum duration for route (default: 7200)" << std::endl;
             std::cout << "  --service-time <seconds> : Service time for each node (default: 10)" << std::endl;
             std::cout << "  --bypass-ratio <ratio> : Bypass ratio percent for each node (default: 100)" << std::endl;
             std::cout << "  --acceptable-buffer <seconds> : Acceptable buffer time for each node (default: 600)" << std::endl;
             std::cout << "  --cache-expiration-time <seconds> : Cache expiration time (default: 3600)" << std::endl;
+            std::cout << "  --new-demand-cache-time <seconds> : Reuse time of new demand costs for repeated quotes, 0 to disable (default: 10)" << std::endl;
+            std::cout << "  --station-approx <count> : Approximate locations without station through this many nearest stations of the station cache, 0 to disable (default: 0)" << std::endl;
+            std::cout << "  --station-approx-radius <m> : Max distance to an anchor station for the approximation (default: 300)" << std::endl;
             std::cout << "  --delaytime-penalty <value> : Delay Time penalty (default: 10.0)" << std::endl;
             std::cout << "  --waittime-penalty <value> : Wait Time penalty (default: 0.0)" << std::endl;
             std::cout << "  --log-request : Log request and response" << std::endl;
@@ -245,9 +442,12 @@ int main(int argc, char **argv)
     svr.set_write_timeout(3600, 0);
 #endif
     g_costCache.setMaxAge(std::chrono::seconds(conf.nCacheExpirationTime));
+    g_costCache.setNewDemandMaxAge(std::chrono::seconds(nNewDemandCacheTime));
+    g_costCache.setStationApproximation(std::max(nStationApproxAnchors, 0), dStationApproxRadius);
     if (!sInitCacheKey.empty()) {
         g_costCache.loadStationCache(sCacheDir, sInitCacheKey);
     }
+    g_vehiclePrefetcher.start(sRoutePath, eRouteType, true);
 
     // HTTP 로깅 설정
     if (bLogHttp) {
@@ -267,8 +467,9 @@ int main(int argc, char **argv)
             ModRequest request = parseRequest(body.data());
 
             std::unordered_map<int, ModRoute> mapNodeToModRoute = makeNodeToModRoute(request, request.vehicleLocs.size());
-            auto solutions = runOptimize(request, sRoutePath, eRouteType, nRouteTasks, mapNodeToModRoute, &parameter, conf, true);
-            auto response = makeResponse(request, mapNodeToModRoute, solutions);
+            ModOptimizeStats stats;
+            auto solutions = runOptimize(request, sRoutePath, eRouteType, nRouteTasks, mapNodeToModRoute, &parameter, conf, true, &stats);
+            auto response = makeResponse(request, mapNodeToModRoute, solutions, stats);
             res.set_content(response.c_str(), "application/json");
         } catch (std::exception& e) {
             res.status = 400;
@@ -276,12 +477,73 @@ int main(int argc, char **argv)
             res.set_content(error, "application/json");
         }
     });
+    svr.Post("/api/v1/quote", [&](const httplib::Request &req, httplib::Response &res) {
+        try {
+            std::vector<char> body(req.body.begin(), req.body.end());
+            body.push_back('\0');
+            ModRequest request = parseRequest(body.data());
+
+            ModOptimizeStats stats;
+            auto quotes = runQuote(request, sRoutePath, eRouteType, nRouteTasks, conf, true, &stats);
+            res.set_content(makeQuoteResponse(quotes, stats), "application/json");
+        } catch (std::exception& e) {
+            res.status = 400;
+            std::string error = "{\"status\":400,\"error\": \"" + escapeJson(e.what()) + "\"}";
+            res.set_content(error, "application/json");
+        }
+    });
+    svr.Post("/api/v1/whatif", [&](const httplib::Request &req, httplib::Response &res) {
+        try {
+            std::vector<char> body(req.body.begin(), req.body.end());
+            body.push_back('\0');
+            ModRequest request = parseRequest(body.data());
+            request.maxOptions = 1;
+
+            ModOptimizeStats stats;
+            auto quotes = runQuote(request, sRoutePath, eRouteType, nRouteTasks, conf, true, &stats);
+            res.set_content(makeWhatIfResponse(quotes, stats), "application/json");
+        } catch (std::exception& e) {
+            res.status = 400;
+            std::string error = "{\"status\":400,\"error\": \"" + escapeJson(e.what()) + "\"}";
+            res.set_content(error, "application/json");
+        }
+    });
+    svr.Post("/api/v1/evaluate", [&](const httplib::Request &req, httplib::Response &res) {
+        try {
+            std::vector<char> body(req.body.begin(), req.body.end());
+            body.push_back('\0');
+            ModRequest request = parseRequest(body.data());
+
+            ModOptimizeStats stats;
+            auto evaluations = runEvaluateRoutes(request, sRoutePath, eRouteType, nRouteTasks, conf, true, &stats);
+            res.set_content(makeEvaluationResponse(evaluations, stats), "application/json");
+        } catch (std::exception& e) {
+            res.status = 400;
+            std::string error = "{\"status\":400,\"error\": \"" + escapeJson(e.what()) + "\"}";
+            res.set_content(error, "application/json");
+        }
+    });
+    svr.Post("/api/v1/vehicles", [&](const httplib::Request &req, httplib::Response &res) {
+        try {
+            std::vector<char> body(req.body.begin(), req.body.end());
+            body.push_back('\0');
+            ModRequest request = parseRequest(body.data());
+            size_t pending = g_vehiclePrefetcher.submit(request.vehicleLocs);
+            res.set_content("{\"status\":0,\"pending\":" + std::to_string(pending) + "}", "application/json");
+        } catch (std::exception& e) {
+            res.status = 400;
+            std::string error = "{\"status\":400,\"error\": \"" + escapeJson(e.what()) + "\"}";
+            res.set_content(error, "application/json");
+        }
+    });
     svr.Get("/api/v1/reset", [&](const httplib::Request &req, httplib::Response &res) {
         try {
             if (eRouteType == ROUTE_OSRM) {
                 queryCostOsrmReset();
             } else if (eRouteType == ROUTE_VALHALLA) {
                 queryCostValhallaReset();
+            } else if (eRouteType == ROUTE_LOCAL) {
+                queryCostLocalReset();
             }
             res.set_content("{\"status\":0}", "application/json");
         } catch (std::exception& e) {
@@ -313,6 +575,9 @@ int main(int argc, char **argv)
             res.set_content(error, "application/json");
         }
     });
+    svr.Get("/api/v1/stats", [&](const httplib::Request &req, httplib::Response &res) {
+        res.set_content(makeStatsResponse(), "application/json");
+    });
     svr.Get("/api/v1/health", [&](const httplib::Request &req, httplib::Response &res) {
         res.set_content("{\"status\":0}", "application/json");
     });
@@ -339,6 +604,7 @@ int main(int argc, char **argv)
         }
     });
     svr.listen(sSvrHost, nSvrPort);
+    g_vehiclePrefetcher.stop();
 
     // 서버 종료 시 Eureka 해제
     if (!sEurekaUrl.empty()) {
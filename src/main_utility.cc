@@ -393,6 +393,10 @@ ModRequest parseRequest(const char *body)
             if (item->value.getTag() == JSON_NUMBER) {
                 request.maxDuration = (int) item->value.toNumber();
             }
+        } else if (strcmp(item->key, "max_options") == 0) {
+            if (item->value.getTag() == JSON_NUMBER) {
+                request.maxOptions = (int) item->value.toNumber();
+            }
         }
     }
 
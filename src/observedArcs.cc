@@ -0,0 +1,304 @@
+#include <climits>
+#include <cmath>
+#include <cctype>
+#include <ctime>
+#include <lnsModRoute.h>
+#include <observedArcs.h>
+#include <queryPlanner.h>
+#include <costCache.h>
+#include <costEstimator.h>
+
+CObservedArcStore g_observedArcs;
+
+void CObservedArcStore::update(Sample& sample, int64_t dist, int64_t time, std::chrono::steady_clock::time_point now)
+{
+    if (sample.samples == 0) {
+        sample.dist = (double) dist;
+        sample.time = (double) time;
+    } else {
+        sample.dist += OBSERVED_ARC_EWMA_ALPHA * (dist - sample.dist);
+        sample.time += OBSERVED_ARC_EWMA_ALPHA * (time - sample.time);
+    }
+    sample.samples++;
+    sample.updated = now;
+}
+
+bool CObservedArcStore::usable(const Sample& sample, size_t minSamples, std::chrono::steady_clock::time_point now)
+{
+    if (sample.samples < minSamples) {
+        return false;
+    }
+    return g_queryPlanPolicy.observedMaxAge <= 0
+        || now - sample.updated < std::chrono::seconds(g_queryPlanPolicy.observedMaxAge);
+}
+
+void CObservedArcStore::record(const std::string& fromKey, const std::string& toKey, int bucket, int64_t dist, int64_t time, const std::string& observation)
+{
+    if (dist < 0 || time < 0 || dist == INT_MAX || time == INT_MAX) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 같은 assigned 를 다시 보낸 요청은 시간이 지나도 같은 관측 (값이 바뀌면 새 관측)
+    auto observed = m_observations.find(observation);
+    if (observed != m_observations.end()) {
+        if (observed->second.dist == dist && observed->second.time == time) {
+            return;
+        }
+        m_observationOrder.splice(m_observationOrder.end(), m_observationOrder, observed->second.order);
+    } else {
+        // 가득 차면 가장 오래 전에 보관한 관측 id 부터 지움
+        if (m_observations.size() >= OBSERVED_ARC_MAX_ENTRIES) {
+            m_observations.erase(m_observationOrder.front());
+            m_observationOrder.pop_front();
+        }
+        m_observationOrder.push_back(observation);
+        observed = m_observations.emplace(observation, Observation{ 0, 0, std::prev(m_observationOrder.end()) }).first;
+    }
+    observed->second.dist = dist;
+    observed->second.time = time;
+
+    auto& row = m_entries[fromKey];
+    auto it = row.find(toKey);
+    if (it == row.end()) {
+        // 가득 차면 가장 오래 전에 갱신한 위치 쌍부터 지움
+        if (m_pairs >= OBSERVED_ARC_MAX_ENTRIES) {
+            auto& oldest = m_pairOrder.front();
+            auto rowIt = m_entries.find(oldest.first);
+            rowIt->second.erase(oldest.second);
+            if (rowIt->second.empty() && rowIt->first != fromKey) {
+                m_entries.erase(rowIt);
+            }
+            m_pairOrder.pop_front();
+            m_pairs--;
+        }
+        m_pairOrder.emplace_back(fromKey, toKey);
+        it = m_entries[fromKey].emplace(toKey, Entry()).first;
+        it->second.order = std::prev(m_pairOrder.end());
+        m_pairs++;
+    } else {
+        m_pairOrder.splice(m_pairOrder.end(), m_pairOrder, it->second.order);
+    }
+    auto& entry = it->second;
+    update(entry.all, dist, time, now);
+    update(entry.buckets[bucket % OBSERVED_ARC_BUCKETS], dist, time, now);
+    m_stats.recorded++;
+}
+
+bool CObservedArcStore::lookup(const std::string& fromKey, const std::string& toKey, int bucket, size_t minSamples, int64_t& dist, int64_t& time)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto rowIt = m_entries.find(fromKey);
+    if (rowIt == m_entries.end()) {
+        return false;
+    }
+    auto it = rowIt->second.find(toKey);
+    if (it == rowIt->second.end()) {
+        return false;
+    }
+    // 시간대 bucket 의 표본이 부족하면 전체 시간대 값
+    const Sample* sample = &it->second.buckets[bucket % OBSERVED_ARC_BUCKETS];
+    if (!usable(*sample, minSamples, now)) {
+        sample = &it->second.all;
+        if (!usable(*sample, minSamples, now)) {
+            return false;
+        }
+    }
+    dist = (int64_t) std::llround(sample->dist);
+    time = (int64_t) std::llround(sample->time);
+    return true;
+}
+
+std::vector<std::string> CObservedArcStore::destinations(const std::string& fromKey)
+{
+    std::vector<std::string> keys;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto rowIt = m_entries.find(fromKey);
+    if (rowIt != m_entries.end()) {
+        keys.reserve(rowIt->second.size());
+        for (auto& [toKey, entry] : rowIt->second) {
+            keys.push_back(toKey);
+        }
+    }
+    return keys;
+}
+
+void CObservedArcStore::addApplied(size_t cells)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.applied += cells;
+}
+
+CObservedArcStore::Stats CObservedArcStore::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.pairs = m_pairs;
+    return stats;
+}
+
+void CObservedArcStore::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_pairOrder.clear();
+    m_observations.clear();
+    m_observationOrder.clear();
+    m_pairs = 0;
+}
+
+int observedArcBucket(const std::optional<std::string>& dateTime)
+{
+    int hour = -1;
+    // "YYYY-MM-DDTHH:MM" 형식
+    if (dateTime.has_value() && dateTime->size() >= 13 && (dateTime->at(10) == 'T' || dateTime->at(10) == ' ')) {
+        const std::string& value = dateTime.value();
+        if (std::isdigit((unsigned char) value[11]) && std::isdigit((unsigned char) value[12])) {
+            hour = (value[11] - '0') * 10 + (value[12] - '0');
+        }
+    }
+    if (hour < 0 || hour >= 24) {
+        auto now_c = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::tm now_tm_local;
+#ifdef _WIN32
+        localtime_s(&now_tm_local, &now_c);
+#else
+        localtime_r(&now_c, &now_tm_local);
+#endif
+        hour = now_tm_local.tm_hour;
+    }
+    return hour / OBSERVED_ARC_BUCKET_HOURS;
+}
+
+// ghost depot 을 제외한 node index 순서의 stop id (demand id 와 pickup(+)/drop off(-), vehicle 은 supply id)
+static std::vector<std::string> collectNodeIds(const ModRequest& modRequest)
+{
+    std::vector<std::string> nodeIds;
+    for (auto& vehicle : modRequest.vehicleLocs) {
+        nodeIds.push_back(vehicle.supplyIdx);
+    }
+    for (auto& onboard : modRequest.onboardDemands) {
+        nodeIds.push_back(onboard.id + "-");
+    }
+    for (auto& waiting : modRequest.onboardWaitingDemands) {
+        nodeIds.push_back(waiting.id + "+");
+        nodeIds.push_back(waiting.id + "-");
+    }
+    for (auto& newDemand : modRequest.newDemands) {
+        nodeIds.push_back(newDemand.id + "+");
+        nodeIds.push_back(newDemand.id + "-");
+    }
+    return nodeIds;
+}
+
+// ghost depot 을 제외한 node index 순서의 stop 위치 (vehicle 은 nullptr)
+static std::vector<const Location*> collectNodeLocations(const ModRequest& modRequest)
+{
+    std::vector<const Location*> nodeLocs(modRequest.vehicleLocs.size(), nullptr);
+    nodeLocs.reserve(modRequest.vehicleLocs.size() + modRequest.onboardDemands.size()
+        + 2 * modRequest.onboardWaitingDemands.size() + 2 * modRequest.newDemands.size());
+    for (auto& onboard : modRequest.onboardDemands) {
+        nodeLocs.push_back(&onboard.destinationLoc);
+    }
+    for (auto& waiting : modRequest.onboardWaitingDemands) {
+        nodeLocs.push_back(&waiting.startLoc);
+        nodeLocs.push_back(&waiting.destinationLoc);
+    }
+    for (auto& newDemand : modRequest.newDemands) {
+        nodeLocs.push_back(&newDemand.startLoc);
+        nodeLocs.push_back(&newDemand.destinationLoc);
+    }
+    return nodeLocs;
+}
+
+void recordObservedArcs(const ModRequest& modRequest, const std::vector<AssignedArc>& arcs)
+{
+    if (arcs.empty()) {
+        return;
+    }
+    auto nodeLocs = collectNodeLocations(modRequest);
+    auto nodeIds = collectNodeIds(modRequest);
+    int bucket = observedArcBucket(modRequest.dateTime);
+    for (auto& arc : arcs) {
+        if (arc.from < 0 || arc.to < 0 || arc.from >= (int) nodeLocs.size() || arc.to >= (int) nodeLocs.size()) {
+            continue;
+        }
+        auto fromLoc = nodeLocs[arc.from];
+        auto toLoc = nodeLocs[arc.to];
+        if (fromLoc == nullptr || toLoc == nullptr || arc.time < 0 || arc.dist < 0) {
+            continue;
+        }
+        std::string fromKey = makeLocationKey(*fromLoc);
+        std::string toKey = makeLocationKey(*toLoc);
+        if (fromKey == toKey) {
+            continue;
+        }
+        // 관측 id: 같은 vehicle 이 같은 demand stop 사이를 이동한 관측
+        std::string vehicleId = arc.vehicle >= 0 && arc.vehicle < (int) modRequest.vehicleLocs.size() ? nodeIds[arc.vehicle] : "";
+        std::string observation = vehicleId + "|" + nodeIds[arc.from] + "|" + nodeIds[arc.to];
+        g_observedArcs.record(fromKey, toKey, bucket, arc.dist, arc.time, observation);
+        // routing engine 이 응답하지 않을 때의 추정에도 실제 값을 반영
+        g_costEstimator.observe(*fromLoc, *toLoc, arc.dist, arc.time);
+    }
+}
+
+std::vector<AssignedArc> collectObservedArcs(const ModRequest& modRequest, size_t nodeCount)
+{
+    std::vector<AssignedArc> arcs;
+    if (g_queryPlanPolicy.observedMinSamples <= 0) {
+        return arcs;
+    }
+    auto nodeLocs = collectNodeLocations(modRequest);
+    if (nodeLocs.size() > nodeCount) {
+        return arcs;
+    }
+    // 같은 위치의 stop 은 같은 관측값을 사용
+    std::unordered_map<std::string, std::vector<int>> keyNodes;
+    for (size_t i = modRequest.vehicleLocs.size(); i < nodeLocs.size(); i++) {
+        keyNodes[makeLocationKey(*nodeLocs[i])].push_back((int) i);
+    }
+    int bucket = observedArcBucket(modRequest.dateTime);
+    for (auto& [fromKey, fromNodes] : keyNodes) {
+        for (auto& toKey : g_observedArcs.destinations(fromKey)) {
+            auto toIt = keyNodes.find(toKey);
+            if (toIt == keyNodes.end()) {
+                continue;
+            }
+            int64_t dist, time;
+            if (!g_observedArcs.lookup(fromKey, toKey, bucket, g_queryPlanPolicy.observedMinSamples, dist, time)) {
+                continue;
+            }
+            for (int from : fromNodes) {
+                for (int to : toIt->second) {
+                    arcs.push_back({ from, to, time, dist });
+                }
+            }
+        }
+    }
+    return arcs;
+}
+
+size_t applyObservedArcs(
+    const ModRequest& modRequest,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    size_t applied = 0;
+    for (auto& arc : collectObservedArcs(modRequest, nodeCount)) {
+        size_t idx = (arc.from + baseVehicle) * (nodeCount + 1) + (arc.to + baseVehicle);
+        // 시간 제약, 고정 배차로 사용할 수 없는 arc 는 그대로 둠
+        if (timeMatrix[idx] == INT_MAX || distMatrix[idx] == INT_MAX) {
+            continue;
+        }
+        distMatrix[idx] = arc.dist;
+        timeMatrix[idx] = arc.time;
+        applied++;
+    }
+    if (applied > 0) {
+        g_observedArcs.addApplied(applied);
+    }
+    return applied;
+}
@@ -194,6 +194,7 @@ PYBIND11_MODULE(mod_route, m) {
     py::enum_<RouteType>(m, "RouteType")
         .value("OSRM", RouteType::ROUTE_OSRM)
         .value("VALHALLA", RouteType::ROUTE_VALHALLA)
+        .value("LOCAL", RouteType::ROUTE_LOCAL)
         .export_values();
     py::class_<ModRoute>(m, "ModRoute")
         .def(py::init<>())
@@ -244,14 +245,16 @@ PYBIND11_MODULE(mod_route, m) {
         .def_readwrite("unacceptables", &ModDispatchSolution::unacceptables)
         .def_readwrite("total_distance", &ModDispatchSolution::total_distance)
         .def_readwrite("total_time", &ModDispatchSolution::total_time)
+        .def_readwrite("estimated_cells", &ModDispatchSolution::estimated_cells)
         .def(py::pickle(
             /* __getstate__ (객체를 직렬화할 때 호출) */
             [](const ModDispatchSolution &mds) {
-                return py::make_tuple(mds.vehicle_routes, mds.missing, mds.unacceptables, mds.total_distance, mds.total_time);
+                return py::make_tuple(mds.vehicle_routes, mds.missing, mds.unacceptables, mds.total_distance, mds.total_time, mds.estimated_cells);
             },
             /* __setstate__ (pickup 된 state로부터 객체를 복원할 때 호출) */
             [](py::tuple t) {
-                if (t.size() != 5) {
+                // estimated_cells 가 없는 이전 state (5 개) 도 복원
+                if (t.size() != 5 && t.size() != 6) {
                     throw std::runtime_error("Invalid state for ModDispatchSolution");
                 }
                 ModDispatchSolution _mds;
@@ -260,10 +263,34 @@ PYBIND11_MODULE(mod_route, m) {
                 _mds.unacceptables = t[2].cast<std::vector<ModRoute>>();
                 _mds.total_distance = t[3].cast<int64_t>();
                 _mds.total_time = t[4].cast<int64_t>();
+                if (t.size() > 5) {
+                    _mds.estimated_cells = t[5].cast<size_t>();
+                }
                 return _mds;
             }
         ));
         
+    py::class_<ModStopEvaluation>(m, "ModStopEvaluation")
+        .def(py::init<>())
+        .def_readwrite("route", &ModStopEvaluation::route)
+        .def_readwrite("arrival_time", &ModStopEvaluation::arrival)
+        .def_readwrite("departure_time", &ModStopEvaluation::departure)
+        .def_readwrite("slack", &ModStopEvaluation::slack)
+        .def_readwrite("load", &ModStopEvaluation::load)
+        .def_readwrite("late", &ModStopEvaluation::late)
+        .def_readwrite("unacceptable", &ModStopEvaluation::unacceptable);
+    py::class_<ModRouteEvaluation>(m, "ModRouteEvaluation")
+        .def(py::init<>())
+        .def_readwrite("supply_idx", &ModRouteEvaluation::supplyIdx)
+        .def_readwrite("stops", &ModRouteEvaluation::stops)
+        .def_readwrite("total_distance", &ModRouteEvaluation::distance)
+        .def_readwrite("total_time", &ModRouteEvaluation::time)
+        .def_readwrite("over_capacity", &ModRouteEvaluation::overCapacity)
+        .def_readwrite("unreachable", &ModRouteEvaluation::unreachable)
+        .def_readwrite("late_end", &ModRouteEvaluation::lateEnd)
+        .def_readwrite("end_time", &ModRouteEvaluation::endTime)
+        .def_readwrite("feasible", &ModRouteEvaluation::feasible);
+
     py::class_<ModRouteConfiguration>(m, "ModRouteConfiguration")
         .def(py::init<>())
         .def_readwrite("max_duration", &ModRouteConfiguration::nMaxDuration)
@@ -364,5 +391,7 @@ PYBIND11_MODULE(mod_route, m) {
     m.def("default_mod_configuraiton", &default_mod_configuraiton, "return default MOD route configuration");
     m.def("default_algorithm_parameters", &default_algorithm_parameters, "return default optimization algorithm parameters");
     m.def("run_optimize", &run_optimize, "run MOD route optimization", py::arg("mod_request"), py::arg("route_path"), py::arg("route_type"), py::arg("route_tasks") = 4, py::arg("cache_path"), py::arg("ap"), py::arg("conf"));
+    m.def("evaluate_routes", &evaluate_routes, "evaluate assigned routes without optimization", py::arg("mod_request"), py::arg("route_path"), py::arg("route_type"), py::arg("route_tasks") = 4, py::arg("cache_path"), py::arg("conf"));
     m.def("clear_cache", &clear_cache, "clear cache");
+    m.def("update_vehicles", &update_vehicles, "prefetch vehicle rows for position updates", py::arg("vehicles"), py::arg("route_path"), py::arg("route_type"));
 }
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <lnsModRoute.h>
+#include <localRouteEngine.h>
+#include <queryLocalCost.h>
+#include <snapCache.h>
+#include <observedArcs.h>
+
+extern std::string logNow();
+
+int queryCostLocal(
+    const ModRequest& modRequest,
+    const std::string& graphPath,
+    const int nRouteTasks,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix,
+    bool showLog)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<Location> locs(nodeCount);
+    for (int i = 0; i < modRequest.vehicleLocs.size(); i++) {
+        locs[i] = modRequest.vehicleLocs[i].location;
+    }
+    size_t baseIdx = modRequest.vehicleLocs.size();
+    for (int i = 0; i < modRequest.onboardDemands.size(); i++) {
+        locs[baseIdx + i] = modRequest.onboardDemands[i].destinationLoc;
+    }
+    baseIdx += modRequest.onboardDemands.size();
+    for (int i = 0; i < modRequest.onboardWaitingDemands.size(); i++) {
+        auto& waitingDemand = modRequest.onboardWaitingDemands[i];
+        locs[baseIdx + i * 2] = waitingDemand.startLoc;
+        locs[baseIdx + i * 2 + 1] = waitingDemand.destinationLoc;
+    }
+    baseIdx += 2 * modRequest.onboardWaitingDemands.size();
+    for (int i = 0; i < modRequest.newDemands.size(); i++) {
+        auto& newDemand = modRequest.newDemands[i];
+        locs[baseIdx + i * 2] = newDemand.startLoc;
+        locs[baseIdx + i * 2 + 1] = newDemand.destinationLoc;
+    }
+
+    // network 조회가 없으므로 cache 를 거치지 않고 전체 matrix 를 계산
+    auto engine = getLocalRouteEngine(graphPath);
+    std::vector<int64_t> distTable;
+    std::vector<int64_t> timeTable;
+    engine->table(locs, locs, nRouteTasks, distTable, timeTable);
+
+    size_t baseVehicle = 1; // 0 = ghost depot
+    for (size_t i = 0; i < nodeCount; i++) {
+        size_t rowIdx = (i + baseVehicle) * (nodeCount + 1) + baseVehicle;
+        std::copy(distTable.begin() + i * nodeCount, distTable.begin() + (i + 1) * nodeCount, distMatrix.begin() + rowIdx);
+        std::copy(timeTable.begin() + i * nodeCount, timeTable.begin() + (i + 1) * nodeCount, timeMatrix.begin() + rowIdx);
+    }
+
+    if (showLog) {
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << logNow() << " queryCostLocal[" << nodeCount << "] " << duration << " ms" << std::endl;
+    }
+
+    return 0;
+}
+
+int queryCostLocalReset()
+{
+    g_snapCache.clear();
+    g_observedArcs.clear();
+    return 0;
+}
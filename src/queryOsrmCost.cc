@@ -1,4 +1,5 @@
 #include <sstream>
+#include <iostream>
 #include <vector>
 #include <list>
 #include <deque>
@@ -9,14 +10,19 @@
 #include <chrono>
 #include <ctime>
 #include <cmath>
+#include <climits>
 #include <cassert>
-#include <cpp-httplib/httplib.h>
-#include <gason/gason.h>
+#include <unordered_map>
 #include <lnsModRoute.h>
 #include <costCache.h>
+#include <costParser.h>
+#include <requestBuilder.h>
+#include <routeFetcher.h>
+#include <queryPlanner.h>
+#include <costEstimator.h>
+#include <snapCache.h>
+#include <observedArcs.h>
 
-#define OSRM_RES_DISTANCE   "distances"
-#define OSRM_RES_DURATION   "durations"
 #define OSRM_MAX_LOCATIONS  100
 
 // #define CHECK_COST_CACHE
@@ -31,95 +37,24 @@ public:
     std::vector<int> m_destinations;
     std::string m_query;
 
-    CTaskOsrm(const std::vector<int>& sources, const std::vector<int>& destinations, const std::string& query)
-        : m_sources(sources), m_destinations(destinations), m_query(query) {}
+    CTaskOsrm(const std::vector<int>& sources, const std::vector<int>& destinations, std::string query)
+        : m_sources(sources), m_destinations(destinations), m_query(std::move(query)) {}
 };
 
-std::string makeOsrmSelectedIndexParams(const char *name, const std::vector<int>& selected)
+void appendOsrmSelectedIndexParams(CBufferWriter& writer, const char *name, const std::vector<int>& selected)
 {
     if (selected.size() == 0) {
-        return "";
+        return;
     }
 
-    std::ostringstream oss;
-    oss << "&" << name << "=" << selected[0];
+    writer.append('&').append(name).append('=').appendInt(selected[0]);
     for (int i = 1; i < selected.size(); i++) {
-        oss << ";" << selected[i];
-    }
-    return oss.str();
-}
-
-std::shared_ptr<CTaskOsrm> queryCostOsrmQuery(
-    const std::string& routePath,
-    const std::string& query,
-    const std::vector<int>& sources,
-    const std::vector<int>& destinations)
-{
-    httplib::Client httpClient(routePath.c_str());
-    auto res = httpClient.Get(query.c_str());
-    if (!res) {
-        auto err = res.error();
-        throw std::runtime_error("Fail to connect to OSRM");
-    } else if (res->status != 200) {
-        throw std::runtime_error("Fail to get cost from OSRM");
-    }
-
-    return std::make_shared<CTaskOsrm>(sources, destinations, res->body.c_str());
-}
-
-void parseOsrmResponse(
-    const std::string& q_response,
-    const size_t baseVehicle,
-    const size_t nodeCount,
-    const std::vector<int>& sources,
-    const std::vector<int>& destinations,
-    std::vector<int64_t>& distMatrix,
-    std::vector<int64_t>& timeMatrix)
-{
-    char *endptr;
-    JsonValue value;
-    JsonAllocator allocator;
-    int status = jsonParse((char*) q_response.c_str(), &endptr, &value, allocator);
-    if (status != JSON_OK) {
-        throw std::runtime_error("Fail to parse OSRM response");
-    }
-    if (value.getTag() != JSON_OBJECT || !value.toNode()) {
-        throw std::runtime_error("Invalid OSRM response format");
-    }
-    for (auto item : value) {
-        if (strcmp(item->key, OSRM_RES_DISTANCE) == 0) {
-            if (item->value.getTag() == JSON_ARRAY && item->value.toNode()) {
-                size_t rowIdx = 0;
-                for (auto row : item->value) {
-                    if (row->value.getTag() == JSON_ARRAY && row->value.toNode()) {
-                        size_t baseIdx = (sources[rowIdx] + baseVehicle) * (nodeCount + 1) + baseVehicle;
-                        size_t colIdx = 0;
-                        for (auto col : row->value) {
-                            distMatrix[baseIdx + destinations[colIdx++]] = col->value.getTag() == JSON_NULL ? INT_MAX : static_cast<int64_t>(std::ceil(col->value.toNumber()));
-                        }
-                        rowIdx++;
-                    }
-                }
-            }
-        } else if (strcmp(item->key, OSRM_RES_DURATION) == 0) {                    
-            if (item->value.getTag() == JSON_ARRAY && item->value.toNode()) {
-                size_t rowIdx = 0;
-                for (auto row : item->value) {
-                    if (row->value.getTag() == JSON_ARRAY && row->value.toNode()) {
-                        size_t baseIdx = (sources[rowIdx] + baseVehicle) * (nodeCount + 1) + baseVehicle;
-                        size_t colIdx = 0;
-                        for (auto col : row->value) {
-                            timeMatrix[baseIdx + destinations[colIdx++]] = col->value.getTag() == JSON_NULL ? INT_MAX : static_cast<int64_t>(std::ceil(col->value.toNumber()));
-                        }
-                        rowIdx++;
-                    }
-                }
-            }
-        }
+        writer.append(';').appendInt(selected[i]);
     }
 }
 
-void queryCostOsrmTask(
+size_t queryCostOsrmTask(
+    const std::vector<Location>& locs,
     const std::string& routePath,
     const size_t routeTasks,
     const size_t baseVehicle,
@@ -133,40 +68,46 @@ void queryCostOsrmTask(
         if (showLog) {
             std::cout << logNow() << " queryCostOsrmTask empty task" << std::endl;
         }
-        return;
+        return 0;
     }
 
     size_t taskCount = tasks.size();
     auto start = std::chrono::high_resolution_clock::now();
 
-    std::list<std::future<std::shared_ptr<CTaskOsrm>>> futures;
-
-    size_t runSize = std::min(routeTasks, taskCount);
-    for (size_t i = 0; i < runSize; i++) {
-        auto task = tasks.front();
-        futures.push_back(std::async(std::launch::async,
-            queryCostOsrmQuery,
-            routePath, task->m_query, task->m_sources, task->m_destinations));
-        tasks.pop_front();
-    }
-
-    while (!futures.empty()) {
-        for (auto it = futures.begin(); it != futures.end(); ) {
-            auto status = it->wait_for(std::chrono::milliseconds(1));
-            if (status == std::future_status::ready) {
-                if (!tasks.empty()) {
-                    auto task = tasks.front();
-                    futures.push_back(std::async(std::launch::async,
-                        queryCostOsrmQuery,
-                        routePath, task->m_query, task->m_sources, task->m_destinations));
-                    tasks.pop_front();
-                }
-                auto result = it->get();
-                parseOsrmResponse(result->m_query, baseVehicle, nodeCount, result->m_sources, result->m_destinations, distMatrix, timeMatrix);
-                it = futures.erase(it); // 완료된 future는 삭제
-            } else {
-                ++it;
-            }
+    std::vector<std::shared_ptr<CTaskOsrm>> taskList(tasks.begin(), tasks.end());
+    tasks.clear();
+    std::vector<std::shared_ptr<RouteFetchRequest>> requests;
+    requests.reserve(taskList.size());
+    for (auto& task : taskList) {
+        requests.push_back(std::make_shared<RouteFetchRequest>(std::move(task->m_query), ""));
+    }
+
+    // 모든 backend 가 계속 실패하면 circuit breaker 가 열려서 바로 추정값을 사용 (성공/실패는 backend 별로 기록)
+    std::vector<size_t> failed;
+    if (!g_costEstimatePolicy.enabled || isRoutingAvailable(routePath)) {
+        failed = fetchRouteTiles("OSRM", routePath, routeTasks, requests,
+            [&](size_t tileIdx, std::string& body) {
+                auto& task = taskList[tileIdx];
+                parseOsrmTable(body, baseVehicle, nodeCount, task->m_sources, task->m_destinations, distMatrix, timeMatrix);
+                observeCostTile(locs, baseVehicle, nodeCount, task->m_sources, task->m_destinations, distMatrix, timeMatrix);
+            }, showLog);
+    } else {
+        for (size_t i = 0; i < taskList.size(); i++) {
+            failed.push_back(i);
+        }
+    }
+
+    size_t estimated = 0;
+    if (!failed.empty()) {
+        if (!g_costEstimatePolicy.enabled) {
+            throw std::runtime_error("Fail to get cost from OSRM");
+        }
+        for (auto tileIdx : failed) {
+            auto& task = taskList[tileIdx];
+            estimated += estimateCostTile(locs, baseVehicle, nodeCount, task->m_sources, task->m_destinations, distMatrix, timeMatrix);
+        }
+        if (showLog) {
+            std::cout << logNow() << " queryCostOsrmTask estimated " << failed.size() << " tiles, " << estimated << " cells" << std::endl;
         }
     }
 
@@ -175,10 +116,52 @@ void queryCostOsrmTask(
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
         std::cout << logNow() << " queryCostOsrmTask[" << taskCount << "] " << duration << " ms" << std::endl;
     }
+
+    return estimated;
+}
+
+std::string makeOsrmTileQuery(
+    const CLocationFragments& fragments,
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations)
+{
+    // tile 에 포함된 좌표만 URL에 넣고 sources/destinations 는 tile 내의 local index로 변환
+    // source 와 destination 이 같은 node 이면 좌표는 한번만 넣음
+    std::unordered_map<int, int> localIdx;
+    std::vector<int> coords;
+    std::vector<int> localSources(sources.size());
+    std::vector<int> localDestinations(destinations.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        auto it = localIdx.emplace(sources[i], (int) coords.size());
+        if (it.second) {
+            coords.push_back(sources[i]);
+        }
+        localSources[i] = it.first->second;
+    }
+    for (size_t i = 0; i < destinations.size(); i++) {
+        auto it = localIdx.emplace(destinations[i], (int) coords.size());
+        if (it.second) {
+            coords.push_back(destinations[i]);
+        }
+        localDestinations[i] = it.first->second;
+    }
+
+    CBufferWriter writer(64 + coords.size() * (fragments.maxLength() + 1) + (sources.size() + destinations.size()) * 4);
+    writer.append("/table/v1/driving/");
+    for (size_t i = 0; i < coords.size(); i++) {
+        if (i != 0) {
+            writer.append(';');
+        }
+        writer.append(fragments[coords[i]]);
+    }
+    writer.append("?annotations=distance,duration");
+    appendOsrmSelectedIndexParams(writer, "sources", localSources);
+    appendOsrmSelectedIndexParams(writer, "destinations", localDestinations);
+    return writer.release();
 }
 
 void makeTaskOsrmIndex(
-    const std::string& url,
+    const CLocationFragments& fragments,
     const std::vector<int>& sources,
     const size_t sourceCount,
     const std::vector<int>& destinations,
@@ -191,17 +174,15 @@ void makeTaskOsrmIndex(
 
     for (size_t s = 0; s < sourceCount; s += OSRM_MAX_LOCATIONS) {
         std::vector<int> sub_sources(sources.begin() + s, sources.begin() + std::min(sourceCount, s + OSRM_MAX_LOCATIONS));
-        std::string q_source = makeOsrmSelectedIndexParams("sources", sub_sources);
         for (size_t d = 0; d < destinationCount; d += OSRM_MAX_LOCATIONS) {
             std::vector<int> sub_destinations(destinations.begin() + d, destinations.begin() + std::min(destinationCount, d + OSRM_MAX_LOCATIONS));
-            std::string q_dest = makeOsrmSelectedIndexParams("destinations", sub_destinations);
-            std::string query = url + q_source + q_dest;
-            tasks.emplace_back(std::make_shared<CTaskOsrm>(sub_sources, sub_destinations, query));
+            std::string query = makeOsrmTileQuery(fragments, sub_sources, sub_destinations);
+            tasks.emplace_back(std::make_shared<CTaskOsrm>(sub_sources, sub_destinations, std::move(query)));
         }
     }
 }
 
-void queryCostOsrmAll(
+size_t queryCostOsrmAll(
     const ModRequest& modRequest,
     const std::string& routePath,
     const size_t routeTasks,
@@ -210,71 +191,80 @@ void queryCostOsrmAll(
     std::vector<int64_t>& timeMatrix,
     bool showLog)
 {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(8);
-    oss << "/table/v1/driving/";
+    std::vector<Location> locs(nodeCount);
+    size_t baseIdx = 0;
     for (int i = 0; i < modRequest.vehicleLocs.size(); i++) {
-        auto& vehicleLocs = modRequest.vehicleLocs[i];
-        oss << ((i == 0) ? "" : ";") << vehicleLocs.location.lng << "," << vehicleLocs.location.lat;
+        locs[i] = modRequest.vehicleLocs[i].location;
     }
-    for (auto& onboardDemand : modRequest.onboardDemands) {
-        oss << ";" << onboardDemand.destinationLoc.lng << "," << onboardDemand.destinationLoc.lat;
+    baseIdx = modRequest.vehicleLocs.size();
+    for (int i = 0; i < modRequest.onboardDemands.size(); i++) {
+        locs[baseIdx + i] = modRequest.onboardDemands[i].destinationLoc;
     }
-    for (auto& waitingDemand : modRequest.onboardWaitingDemands) {
-        oss << ";" << waitingDemand.startLoc.lng << "," << waitingDemand.startLoc.lat;
-        oss << ";" << waitingDemand.destinationLoc.lng << "," << waitingDemand.destinationLoc.lat;
+    baseIdx += modRequest.onboardDemands.size();
+    for (int i = 0; i < modRequest.onboardWaitingDemands.size(); i++) {
+        auto& waitingDemand = modRequest.onboardWaitingDemands[i];
+        locs[baseIdx + i * 2] = waitingDemand.startLoc;
+        locs[baseIdx + i * 2 + 1] = waitingDemand.destinationLoc;
     }
-    for (auto& newDemand : modRequest.newDemands) {
-        oss << ";" << newDemand.startLoc.lng << "," << newDemand.startLoc.lat;
-        oss << ";" << newDemand.destinationLoc.lng << "," << newDemand.destinationLoc.lat;
+    baseIdx += 2 * modRequest.onboardWaitingDemands.size();
+    for (int i = 0; i < modRequest.newDemands.size(); i++) {
+        auto& newDemand = modRequest.newDemands[i];
+        locs[baseIdx + i * 2] = newDemand.startLoc;
+        locs[baseIdx + i * 2 + 1] = newDemand.destinationLoc;
     }
-    oss << "?annotations=distance,duration";
 
     std::vector<int> index(nodeCount);
     for (int i = 0; i < nodeCount; i++) {
         index[i] = i;
     }
 
+    CLocationFragments fragments(locs, CLocationFragments::OSRM_COORDINATE);
+
     std::deque<std::shared_ptr<CTaskOsrm>> tasks;
-    std::string url = oss.str();
     for (size_t s = 0; s < nodeCount; s += OSRM_MAX_LOCATIONS) {
         std::vector<int> sources(index.begin() + s, index.begin() + std::min(nodeCount, s + OSRM_MAX_LOCATIONS));
         for (size_t d = 0; d < nodeCount; d += OSRM_MAX_LOCATIONS) {
             std::vector<int> destinations(index.begin() + d, index.begin() + std::min(nodeCount, d + OSRM_MAX_LOCATIONS));
-            makeTaskOsrmIndex(url, sources, sources.size(), destinations, destinations.size(), tasks);
+            makeTaskOsrmIndex(fragments, sources, sources.size(), destinations, destinations.size(), tasks);
         }
     }
 
-    queryCostOsrmTask(routePath, routeTasks, 1, nodeCount, tasks, distMatrix, timeMatrix, showLog);
+    return queryCostOsrmTask(locs, routePath, routeTasks, 1, nodeCount, tasks, distMatrix, timeMatrix, showLog);
 }
 
 void functionOsrmCostFromVehicle(
     const ModRequest& modRequest,
-    const std::string& url,
     const std::vector<Location>& locs,
+    const CLocationFragments& fragments,
     size_t nodeCount,
     const StationToIdxMap& stationToIdx,
     const std::unordered_map<std::string, int>& demandIdToIdx,
     const std::unordered_map<std::string, int>& supplyIdToIdx,
+    const std::unordered_set<int64_t>& knownArcs,
+    const std::vector<std::vector<int>>& newDemandCandidates,
+    const CArcPruner& pruner,
+    VehicleRowPlan& rowPlan,
     std::deque<std::shared_ptr<CTaskOsrm>>& tasks)
 {
-    std::vector<int> sources(nodeCount);
-    std::vector<int> destinations(nodeCount);
 #ifdef CHECK_COST_VEHICLE_ONLY_ASSIGNED
-    std::set<int> newDemandsDestinations;
+    std::vector<int> newDemandStarts(modRequest.newDemands.size());
     size_t baseIdx = modRequest.vehicleLocs.size() + modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size();
     for (size_t i = 0; i < modRequest.newDemands.size(); i++) {
         auto& newDemandStartLoc = modRequest.newDemands[i].startLoc;
         assert(modRequest.newDemands[i].startLoc.station_id == locs[baseIdx + i * 2].station_id);
+        newDemandStarts[i] = baseIdx + i * 2; // start loc
         if (!newDemandStartLoc.station_id.empty()) {
             auto it = stationToIdx.find(makeStationKey(newDemandStartLoc.station_id, -1));
             if (it != stationToIdx.end()) {
-                newDemandsDestinations.insert(it->second);
-            } else {
-                newDemandsDestinations.insert(baseIdx + i * 2); // start loc
+                newDemandStarts[i] = it->second;
             }
-        } else {
-            newDemandsDestinations.insert(baseIdx + i * 2); // start loc
+        }
+    }
+    // new demand 는 가까운 후보 vehicle 에서만 조회 (나머지는 조회 후 INT_MAX 로 채움)
+    std::vector<std::set<int>> newDemandsDestinations(modRequest.vehicleLocs.size());
+    for (size_t i = 0; i < newDemandCandidates.size(); i++) {
+        for (int vehicle : newDemandCandidates[i]) {
+            newDemandsDestinations[vehicle].insert(newDemandStarts[i]);
         }
     }
     std::set<std::string> notAssignedVehicles;
@@ -289,51 +279,68 @@ void functionOsrmCostFromVehicle(
             notAssignedVehicles.erase(it);
         }
     }
-    if (!notAssignedVehicles.empty()) {
-        // not assigned vehicle -> new_demand 조회
-        size_t sourceCount = 0;
-        for (std::string supplyIdx: notAssignedVehicles) {
-            auto it = supplyIdToIdx.find(supplyIdx);
-            if (it != supplyIdToIdx.end()) {
-                sources[sourceCount++] = it->second;
-            }
+    // vehicle 마다 조회할 destination 을 모은 뒤, destination 이 많이 겹치는 vehicle 들을 한 tile 로 묶어서 조회
+    std::vector<VehicleRow> rows;
+    // not assigned vehicle -> new_demand 조회
+    for (std::string supplyIdx: notAssignedVehicles) {
+        auto it = supplyIdToIdx.find(supplyIdx);
+        if (it != supplyIdToIdx.end()) {
+            auto& destinations = newDemandsDestinations[it->second];
+            rows.push_back({ it->second, std::vector<int>(destinations.begin(), destinations.end()) });
         }
-        size_t destCount = newDemandsDestinations.size();
-        std::copy(newDemandsDestinations.begin(), newDemandsDestinations.end(), destinations.begin());
-
-        makeTaskOsrmIndex(url, sources, sourceCount, destinations, destCount, tasks);
     }
 
     // TODO: waitingDemand, onboardDemand에는 assigned 되어 있다고 하지만 assigned에 없는 경우는 나중에 처리
     // for each assigned vehicle -> new_demand + assigned demand
-    for (auto assigned : modRequest.assigned) {
+    for (auto& assigned : modRequest.assigned) {
         auto it = supplyIdToIdx.find(assigned.supplyIdx);
         if (it != supplyIdToIdx.end()) {
-            std::set<int> assignedDestinations(newDemandsDestinations);
-            sources[0] = it->second; // vehicle location
+            std::set<int> assignedDestinations(newDemandsDestinations[it->second]);
             for (auto& routeOrder : assigned.routeOrder) {
                 auto demandIt = demandIdToIdx.find(routeOrder.first);
                 if (demandIt == demandIdToIdx.end()) {
                     continue;
                 }
                 auto& loc = locs[demandIt->second];
+                int destIdx = demandIt->second;
                 if (!loc.station_id.empty()) {
-                    auto it = stationToIdx.find(makeStationKey(loc.station_id, -1));
-                    if (it != stationToIdx.end()) {
-                        assignedDestinations.insert(it->second);
-                    } else {
-                        assignedDestinations.insert(demandIt->second);
+                    auto stationIt = stationToIdx.find(makeStationKey(loc.station_id, -1));
+                    if (stationIt != stationToIdx.end()) {
+                        destIdx = stationIt->second;
                     }
-                } else {
-                    assignedDestinations.insert(demandIt->second);
                 }
+                // 첫 stop 처럼 route_times/route_distances 로 알고 있는 arc 는 조회하지 않음 (이미 matrix 에 채워져 있음)
+                if (destIdx == demandIt->second && knownArcs.count(arcKey(it->second, destIdx, nodeCount)) > 0) {
+                    continue;
+                }
+                assignedDestinations.insert(destIdx);
             }
-            size_t destCount = assignedDestinations.size();
-            std::copy(assignedDestinations.begin(), assignedDestinations.end(), destinations.begin());
-            makeTaskOsrmIndex(url, sources, 1, destinations, destCount, tasks);
+            rows.push_back({ it->second, std::vector<int>(assignedDestinations.begin(), assignedDestinations.end()) });
         }
     }
+
+    // 직선 거리로도 시간 안에 갈 수 없는 new demand 는 조회하지 않음
+    for (auto& row : rows) {
+        pruner.filter(row.source, row.destinations);
+    }
+    // 거의 움직이지 않은 vehicle 은 이전에 조회한 row 를 재사용
+    rowPlan.reused = g_vehicleRowCache.reuse(modRequest, locs, rows, rowPlan.fills);
+    rowPlan.rows = rows;
+    // 같은 위치의 vehicle (차고지 등) 은 한 vehicle 에서만 조회하고, 조회 후 나머지 vehicle 로 복사
+    if (g_queryPlanPolicy.dedupRadius > 0) {
+        std::vector<std::pair<std::string, int>> vehicleKeys(modRequest.vehicleLocs.size());
+        for (size_t i = 0; i < modRequest.vehicleLocs.size(); i++) {
+            vehicleKeys[i] = makeStationKey(coordinateStationId(locs[i], g_queryPlanPolicy.dedupRadius), -1);
+        }
+        rows = mergeColocatedRows(std::move(rows), vehicleKeys, rowPlan.copies);
+    }
+    for (auto& group : groupVehicleRows(std::move(rows), OSRM_MAX_LOCATIONS)) {
+        makeTaskOsrmIndex(fragments, group.sources, group.sources.size(), group.destinations, group.destinations.size(), tasks);
+    }
 #else
+    std::vector<int> sources(nodeCount);
+    std::vector<int> destinations(nodeCount);
+
     // vehicle -> start_loc 조회
     for (size_t i = 0; i < modRequest.vehicleLocs.size(); i++) {
         sources[i] = i;
@@ -343,16 +350,18 @@ void functionOsrmCostFromVehicle(
         destinations[destCount++] = it->second;
     }
 
-    makeTaskOsrmIndex(url, sources, modRequest.vehicleLocs.size(), destinations, destCount, tasks);
+    makeTaskOsrmIndex(fragments, sources, modRequest.vehicleLocs.size(), destinations, destCount, tasks);
 #endif
 }
 
 void functionOsrmCostToNewChanged(
     const ModRequest& modRequest,
-    const std::string& url,
+    const CLocationFragments& fragments,
     size_t nodeCount,
     const StationToIdxMap& stationToIdx,
     const std::vector<int>& changed,
+    const std::vector<int>& nodeVehicles,
+    const CArcPruner& pruner,
     std::deque<std::shared_ptr<CTaskOsrm>>& tasks)
 {
     if (changed.empty()) {
@@ -421,19 +430,29 @@ void functionOsrmCostToNewChanged(
             insertLocationIdx(destLoc, destSet, 2 * (v - waitingSizeInChange) + newBase + 1);
         }
     }
+#ifdef CHECK_COST_FIXED_ASSIGNMENT
+    // 서로 다른 vehicle 에 고정된 node 사이의 arc 는 제외하고 조회
+    std::vector<int> sourceList(sourceSet.begin(), sourceSet.end());
+    std::vector<int> destList(destSet.begin(), destSet.end());
+    for (auto& group : planReachableTiles(sourceList, destList, nodeVehicles, OSRM_MAX_LOCATIONS, &pruner)) {
+        makeTaskOsrmIndex(fragments, group.sources, group.sources.size(), group.destinations, group.destinations.size(), tasks);
+    }
+#else
     std::copy(sourceSet.begin(), sourceSet.end(), sources.begin());
     std::copy(destSet.begin(), destSet.end(), destinations.begin());
-    makeTaskOsrmIndex(url, sources, sourceSet.size(), destinations, destSet.size(), tasks);
+    makeTaskOsrmIndex(fragments, sources, sourceSet.size(), destinations, destSet.size(), tasks);
+#endif
 }
 
 void functionOsrmCostFromNewChanged(
     const ModRequest& modRequest,
-    const std::string& url,
-    const std::vector<Location>& locs,
+    const CLocationFragments& fragments,
     size_t nodeCount,
     const StationToIdxMap& stationToIdx,
     const std::vector<int>& changed,
     const std::vector<int>& notChanged,
+    const std::vector<int>& nodeVehicles,
+    const CArcPruner& pruner,
     std::deque<std::shared_ptr<CTaskOsrm>>& tasks)
 {
     if (changed.empty() || notChanged.empty()) {
@@ -505,9 +524,18 @@ void functionOsrmCostFromNewChanged(
         }
     }
 
+#ifdef CHECK_COST_FIXED_ASSIGNMENT
+    // 서로 다른 vehicle 에 고정된 node 사이의 arc 는 제외하고 조회
+    std::vector<int> sourceList(sourceSet.begin(), sourceSet.end());
+    std::vector<int> destList(destSet.begin(), destSet.end());
+    for (auto& group : planReachableTiles(sourceList, destList, nodeVehicles, OSRM_MAX_LOCATIONS, &pruner)) {
+        makeTaskOsrmIndex(fragments, group.sources, group.sources.size(), group.destinations, group.destinations.size(), tasks);
+    }
+#else
     std::copy(sourceSet.begin(), sourceSet.end(), sources.begin());
     std::copy(destSet.begin(), destSet.end(), destinations.begin());
-    makeTaskOsrmIndex(url, sources, sourceSet.size(), destinations, destSet.size(), tasks);
+    makeTaskOsrmIndex(fragments, sources, sourceSet.size(), destinations, destSet.size(), tasks);
+#endif
 }
 
 int queryCostOsrmNotInCache(
@@ -516,6 +544,7 @@ int queryCostOsrmNotInCache(
     const size_t routeTasks,
     size_t nodeCount,
     const std::vector<int>& changed,
+    const std::vector<AssignedArc>& observedArcs,
     std::vector<int64_t>& distMatrix,
     std::vector<int64_t>& timeMatrix,
     bool showLog)
@@ -524,20 +553,15 @@ int queryCostOsrmNotInCache(
     std::unordered_map<std::string, int> demandIdToIdx;
     std::unordered_map<std::string, int> supplyIdToIdx;
     std::vector<Location> locs(nodeCount);
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(8);
-    oss << "/table/v1/driving/";
     for (int i = 0; i < modRequest.vehicleLocs.size(); i++) {
         auto& vehicleLocs = modRequest.vehicleLocs[i];
         locs[i] = vehicleLocs.location;
         supplyIdToIdx[vehicleLocs.supplyIdx] = i;
-        oss << ((i == 0) ? "" : ";") << vehicleLocs.location.lng << "," << vehicleLocs.location.lat;
     }
     size_t baseIdx = modRequest.vehicleLocs.size();
     for (int i = 0; i < modRequest.onboardDemands.size(); i++) {
         auto& onboardDemand = modRequest.onboardDemands[i];
         locs[baseIdx + i] = onboardDemand.destinationLoc;
-        oss << ";" << onboardDemand.destinationLoc.lng << "," << onboardDemand.destinationLoc.lat;
         pushStationToIdx(stationToIdx, onboardDemand.destinationLoc.station_id, -1, baseIdx + i);
         demandIdToIdx[onboardDemand.id] = baseIdx + i;
     }
@@ -546,8 +570,6 @@ int queryCostOsrmNotInCache(
         auto& waitingDemand = modRequest.onboardWaitingDemands[i];
         locs[baseIdx + i * 2] = waitingDemand.startLoc;
         locs[baseIdx + i * 2 + 1] = waitingDemand.destinationLoc;
-        oss << ";" << waitingDemand.startLoc.lng << "," << waitingDemand.startLoc.lat;
-        oss << ";" << waitingDemand.destinationLoc.lng << "," << waitingDemand.destinationLoc.lat;
         pushStationToIdx(stationToIdx, waitingDemand.startLoc.station_id, -1, baseIdx + i * 2);
         pushStationToIdx(stationToIdx, waitingDemand.destinationLoc.station_id, -1, baseIdx + i * 2 + 1);
         demandIdToIdx[waitingDemand.id] = baseIdx + i * 2;
@@ -557,14 +579,10 @@ int queryCostOsrmNotInCache(
         auto& newDemand = modRequest.newDemands[i];
         locs[baseIdx + i * 2] = newDemand.startLoc;
         locs[baseIdx + i * 2 + 1] = newDemand.destinationLoc;
-        oss << ";" << newDemand.startLoc.lng << "," << newDemand.startLoc.lat;
-        oss << ";" << newDemand.destinationLoc.lng << "," << newDemand.destinationLoc.lat;
         pushStationToIdx(stationToIdx, newDemand.startLoc.station_id, -1, baseIdx + i * 2);
         pushStationToIdx(stationToIdx, newDemand.destinationLoc.station_id, -1, baseIdx + i * 2 + 1);
         demandIdToIdx[newDemand.id] = baseIdx + i * 2;
     }
-    oss << "?annotations=distance,duration";
-    std::string url = oss.str();
 
     // changed가 아닌 not changed 목록을 찾기 위한 작업
     // changed인덱스는 onboard + waiting 내에서의 index 이것을 query cost 할 때의 index로 변환하는 것이 중요
@@ -582,26 +600,104 @@ int queryCostOsrmNotInCache(
 
     size_t baseVehicle = 1; // 0 = ghost depot
 
+    CLocationFragments fragments(locs, CLocationFragments::OSRM_COORDINATE);
+
     std::deque<std::shared_ptr<CTaskOsrm>> tasks;
-    functionOsrmCostFromVehicle(modRequest, url, locs, nodeCount, stationToIdx, demandIdToIdx, supplyIdToIdx, tasks);
-    functionOsrmCostToNewChanged(modRequest, url, nodeCount, stationToIdx, changed, tasks);
-    functionOsrmCostFromNewChanged(modRequest, url, locs, nodeCount, stationToIdx, changed, notChanged, tasks);
+    // route_times/route_distances 로 알고 있는 arc 와 관측값이 충분한 stop -> stop arc 는 미리 채우고 조회에서 제외
+    // (이번 요청의 route_times 가 관측값보다 우선)
+    auto assignedArcs = collectAssignedArcs(modRequest);
+    applyAssignedArcs(observedArcs, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    applyAssignedArcs(assignedArcs, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    auto knownArcs = knownArcKeys(assignedArcs, nodeCount);
+    auto observedKeys = knownArcKeys(observedArcs, nodeCount);
+    knownArcs.insert(observedKeys.begin(), observedKeys.end());
+    auto newDemandCandidates = findCandidateVehicles(modRequest);
+    // station 대표 node (조회는 대표 node 기준으로 함)
+    std::vector<int> representative(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+        representative[i] = i;
+        auto& loc = locs[i];
+        if (i >= modRequest.vehicleLocs.size() && !loc.station_id.empty()) {
+            auto it = stationToIdx.find(makeStationKey(loc.station_id, -1));
+            if (it != stationToIdx.end()) {
+                representative[i] = it->second;
+            }
+        }
+    }
+    CArcPruner pruner(modRequest, representative, g_queryPlanPolicy.pruneSpeed);
+    pruner.setKnownArcs(knownArcs);
+    VehicleRowPlan rowPlan;
+    functionOsrmCostFromVehicle(modRequest, locs, fragments, nodeCount, stationToIdx, demandIdToIdx, supplyIdToIdx, knownArcs, newDemandCandidates, pruner, rowPlan, tasks);
+    // station 대표 node 기준의 고정 vehicle (fixedAssignment)
+    auto nodeVehicles = fixedNodeVehicles(modRequest, nodeCount);
+    auto representativeVehicles = mergeNodeVehicles(nodeVehicles, representative);
+    functionOsrmCostToNewChanged(modRequest, fragments, nodeCount, stationToIdx, changed, representativeVehicles, pruner, tasks);
+    functionOsrmCostFromNewChanged(modRequest, fragments, nodeCount, stationToIdx, changed, notChanged, representativeVehicles, pruner, tasks);
 
-    queryCostOsrmTask(routePath, routeTasks, baseVehicle, nodeCount, tasks, distMatrix, timeMatrix, showLog);
+    size_t estimated = queryCostOsrmTask(locs, routePath, routeTasks, baseVehicle, nodeCount, tasks, distMatrix, timeMatrix, showLog);
 
+    applyRowCopies(rowPlan.copies, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    applyRowFills(rowPlan.fills, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    if (estimated == 0) {
+        // 추정값을 사용한 경우는 보관하지 않음
+        g_vehicleRowCache.store(modRequest, locs, rowPlan.rows, rowPlan.reused, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    }
     updateFromVehicleCostMatrixWithStationCache(modRequest, nodeCount, stationToIdx, distMatrix, timeMatrix);
     updateChangedCostMatrixWithStationCache(modRequest, nodeCount, changed, notChanged, stationToIdx, distMatrix, timeMatrix);
+#ifdef CHECK_COST_FIXED_ASSIGNMENT
+    // 조회하지 않은 arc 는 사용할 수 없는 arc 로 채움
+    fillUnreachableArcs(nodeVehicles, baseVehicle, nodeCount, distMatrix, timeMatrix);
+#endif
+#ifdef CHECK_COST_VEHICLE_ONLY_ASSIGNED
+    fillNonCandidateArcs(modRequest, newDemandCandidates, baseVehicle, nodeCount, distMatrix, timeMatrix);
+#endif
+    pruner.fillInfeasible(baseVehicle, nodeCount, distMatrix, timeMatrix);
 
-    return 0;
+    return (int) estimated;
 }
 
 
 int queryCostOsrmReset()
 {
     g_costCache.clear();
+    g_vehicleRowCache.clear();
+    g_snapCache.clear();
+    g_observedArcs.clear();
+    resetCircuitBreakers();
     return 0;
 }
 
+size_t prefetchVehicleRowsOsrm(
+    const ModRequest& telemetry,
+    const std::string& routePath,
+    const size_t routeTasks,
+    bool showLog)
+{
+    auto prefetch = g_vehicleRowCache.prepare(telemetry);
+    if (prefetch.rows.empty()) {
+        return 0;
+    }
+
+    size_t baseVehicle = 1;
+    size_t nodeCount = prefetch.locs.size();
+    CLocationFragments fragments(prefetch.locs, CLocationFragments::OSRM_COORDINATE);
+    std::deque<std::shared_ptr<CTaskOsrm>> tasks;
+    for (auto& group : groupVehicleRows(prefetch.rows, OSRM_MAX_LOCATIONS)) {
+        makeTaskOsrmIndex(fragments, group.sources, group.sources.size(), group.destinations, group.destinations.size(), tasks);
+    }
+
+    // 조회하지 않은 cell 은 row cache 에 보관하지 않도록 INT_MAX 로 시작
+    std::vector<int64_t> distMatrix((nodeCount + 1) * (nodeCount + 1), INT_MAX);
+    std::vector<int64_t> timeMatrix((nodeCount + 1) * (nodeCount + 1), INT_MAX);
+    size_t estimated = queryCostOsrmTask(prefetch.locs, routePath, routeTasks, baseVehicle, nodeCount, tasks, distMatrix, timeMatrix, showLog);
+    if (estimated > 0) {
+        // 추정값을 사용한 경우는 보관하지 않음
+        return 0;
+    }
+    g_vehicleRowCache.storePrefetched(prefetch, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    return prefetch.rows.size();
+}
+
 #ifdef CHECK_COST_CACHE
 void testCostOsrmCache(
     const ModRequest& modRequest,
@@ -729,15 +825,32 @@ int queryCostOsrm(
     //     return queryCostOsrmAll(modRequest, routePath, nodeCount, distMatrix, timeMatrixm, showLog);
     // }
 
+    // station_id 가 없는 좌표는 도로 위의 위치로 snap 해서 위치 key 로 사용
+    snapRequestLocations(modRequest, ROUTE_OSRM, routePath, nRouteTasks, showLog);
+
     std::vector<int> changed;
+    int estimated = 0;
     if (g_costCache.checkChangedItem(modRequest, changed)) {
-        queryCostOsrmNotInCache(modRequest, routePath, nRouteTasks, nodeCount, changed, distMatrix, timeMatrix, showLog);
+        // 관측값의 위치 key 는 가상 station 을 붙이기 전의 위치로 찾음
+        auto observedArcs = collectObservedArcs(modRequest, nodeCount);
+        if (g_queryPlanPolicy.dedupRadius > 0) {
+            // station 이 없는 위치는 좌표로 만든 가상 station 으로 묶어서 조회 (조회용 복사본에만 붙임)
+            ModRequest queryRequest = modRequest;
+            assignCoordinateStations(queryRequest, g_queryPlanPolicy.dedupRadius);
+            estimated = queryCostOsrmNotInCache(queryRequest, routePath, nRouteTasks, nodeCount, changed, observedArcs, distMatrix, timeMatrix, showLog);
+        } else {
+            estimated = queryCostOsrmNotInCache(modRequest, routePath, nRouteTasks, nodeCount, changed, observedArcs, distMatrix, timeMatrix, showLog);
+        }
     }
     g_costCache.updateCacheAndCost(modRequest, nodeCount, changed, distMatrix, timeMatrix);
+    if (estimated > 0) {
+        // 추정값은 다음 요청에서 다시 조회하도록 캐시에 남기지 않음
+        g_costCache.discardChanged(modRequest, changed);
+    }
 
 #ifdef CHECK_COST_CACHE
     testCostOsrmCache(modRequest, routePath, nodeCount, distMatrix, timeMatrix);
 #endif
 
-    return 0;
+    return estimated;
 }
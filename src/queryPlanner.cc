@@ -0,0 +1,988 @@
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <lnsModRoute.h>
+#include <queryPlanner.h>
+#include <costEstimator.h>
+#include <costCache.h>
+#include <snapCache.h>
+
+QueryPlanPolicy g_queryPlanPolicy;
+
+// 정렬된 두 목록의 합집합 크기
+static size_t unionSize(const std::vector<int>& a, const std::vector<int>& b)
+{
+    size_t count = 0;
+    auto i = a.begin();
+    auto j = b.begin();
+    while (i != a.end() && j != b.end()) {
+        if (*i < *j) {
+            i++;
+        } else if (*j < *i) {
+            j++;
+        } else {
+            i++;
+            j++;
+        }
+        count++;
+    }
+    return count + (a.end() - i) + (b.end() - j);
+}
+
+std::vector<VehicleRowGroup> groupVehicleRows(
+    std::vector<VehicleRow> rows,
+    size_t maxSources,
+    double maxExtraRatio)
+{
+    // destination 이 많은 row 부터 넣어야 뒤의 row 들이 기존 group 에 포함되기 쉬움
+    std::stable_sort(rows.begin(), rows.end(), [](const VehicleRow& a, const VehicleRow& b) {
+        return a.destinations.size() > b.destinations.size();
+    });
+
+    std::vector<VehicleRowGroup> groups;
+    for (auto& row : rows) {
+        if (row.destinations.empty()) {
+            continue;
+        }
+
+        VehicleRowGroup *best = nullptr;
+        size_t bestExtra = 0;
+        for (auto& group : groups) {
+            if (group.sources.size() >= maxSources) {
+                continue;
+            }
+            size_t cells = (group.sources.size() + 1) * unionSize(group.destinations, row.destinations);
+            size_t needed = group.neededCells + row.destinations.size();
+            if (cells > needed * (1.0 + maxExtraRatio)) {
+                continue;
+            }
+            if (best == nullptr || cells - needed < bestExtra) {
+                best = &group;
+                bestExtra = cells - needed;
+            }
+        }
+
+        if (best == nullptr) {
+            groups.emplace_back();
+            best = &groups.back();
+        }
+        std::vector<int> merged;
+        merged.reserve(best->destinations.size() + row.destinations.size());
+        std::set_union(best->destinations.begin(), best->destinations.end(),
+            row.destinations.begin(), row.destinations.end(), std::back_inserter(merged));
+        best->destinations.swap(merged);
+        best->sources.push_back(row.source);
+        best->neededCells += row.destinations.size();
+    }
+    return groups;
+}
+
+// requireTimes 이면 route_times, route_distances 가 있는 vehicle 의 arc 만, 아니면 값을 모르는 arc 는 -1
+static std::vector<AssignedArc> collectRouteOrderArcs(const ModRequest& modRequest, bool requireTimes)
+{
+    std::vector<AssignedArc> arcs;
+    std::unordered_map<std::string, int> supplyIdToIdx;
+    std::unordered_map<std::string, int> demandIdToIdx;
+    size_t baseIdx = 0;
+    for (int i = 0; i < modRequest.vehicleLocs.size(); i++) {
+        supplyIdToIdx[modRequest.vehicleLocs[i].supplyIdx] = i;
+    }
+    baseIdx = modRequest.vehicleLocs.size();
+    for (int i = 0; i < modRequest.onboardDemands.size(); i++) {
+        // 여기에서 minus 1을 하는 이유는,
+        // 이후에 routeOrder 에서 pickup, drop off 를 구분할 때
+        // drop off 의 경우 ++ 해서 toIdx를 증가시키기 때문
+        // routeOrder 에서는 해당 demand가 onboard인지 waiting인지 구분할 수 없기 때문임
+        demandIdToIdx[modRequest.onboardDemands[i].id] = baseIdx + i - 1;
+    }
+    baseIdx += modRequest.onboardDemands.size();
+    for (int i = 0; i < modRequest.onboardWaitingDemands.size(); i++) {
+        demandIdToIdx[modRequest.onboardWaitingDemands[i].id] = baseIdx + i * 2;
+    }
+    baseIdx += 2 * modRequest.onboardWaitingDemands.size();
+    for (int i = 0; i < modRequest.newDemands.size(); i++) {
+        demandIdToIdx[modRequest.newDemands[i].id] = baseIdx + i * 2;
+    }
+    for (const auto& vehicleAssigned : modRequest.assigned) {
+        if (vehicleAssigned.routeOrder.empty()) {
+            continue;
+        }
+        bool known = vehicleAssigned.routeOrder.size() == vehicleAssigned.routeTimes.size() &&
+            vehicleAssigned.routeOrder.size() == vehicleAssigned.routeDistances.size();
+        if (requireTimes && !known) {
+            continue; // routeOrder, routeTimes, routeDistances 크기가 일치하지 않는 경우
+        }
+        auto supplyIt = supplyIdToIdx.find(vehicleAssigned.supplyIdx);
+        if (supplyIt == supplyIdToIdx.end()) {
+            continue; // 해당 공급 차량이 없는 경우
+        }
+        int fromIdx = supplyIt->second;
+        for (int i = 0; i < vehicleAssigned.routeOrder.size(); i++) {
+            auto& routeOrder = vehicleAssigned.routeOrder[i];
+            auto demandIt = demandIdToIdx.find(routeOrder.first);
+            if (demandIt == demandIdToIdx.end()) {
+                break; // 해당 demand가 없는 경우 이후 loop 중단
+            }
+            int toIdx = demandIt->second;
+            if (routeOrder.second < 0) {
+                // drop off 인 경우이기 때문에 toIdx 증가
+                toIdx++;
+            }
+            if (known) {
+                arcs.push_back({ fromIdx, toIdx, vehicleAssigned.routeTimes[i], vehicleAssigned.routeDistances[i], supplyIt->second });
+            } else {
+                arcs.push_back({ fromIdx, toIdx, -1, -1, supplyIt->second });
+            }
+            fromIdx = toIdx;
+        }
+    }
+    return arcs;
+}
+
+std::vector<AssignedArc> collectAssignedArcs(const ModRequest& modRequest)
+{
+    if (modRequest.assigned.empty()) {
+        return {};
+    } else if (modRequest.assigned[0].routeTimes.empty()) {
+        // assigned 가 있지만 routeTimes 가 비어있는 경우
+        return {};
+    }
+    return collectRouteOrderArcs(modRequest, true);
+}
+
+std::vector<AssignedArc> collectRouteArcs(const ModRequest& modRequest)
+{
+    return collectRouteOrderArcs(modRequest, false);
+}
+
+void applyAssignedArcs(
+    const std::vector<AssignedArc>& arcs,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    for (auto& arc : arcs) {
+        size_t cacheIdx = (arc.from + baseVehicle) * (nodeCount + 1) + (arc.to + baseVehicle);
+        if (arc.time >= 0) {
+            timeMatrix[cacheIdx] = arc.time;
+        }
+        if (arc.dist >= 0) {
+            distMatrix[cacheIdx] = arc.dist;
+        }
+    }
+}
+
+std::unordered_set<int64_t> knownArcKeys(const std::vector<AssignedArc>& arcs, size_t nodeCount)
+{
+    std::unordered_set<int64_t> keys;
+    for (auto& arc : arcs) {
+        if (arc.time >= 0 && arc.dist >= 0) {
+            keys.insert(arcKey(arc.from, arc.to, nodeCount));
+        }
+    }
+    return keys;
+}
+
+std::vector<int> fixedNodeVehicles(const ModRequest& modRequest, size_t nodeCount)
+{
+    std::vector<int> nodeVehicles(nodeCount, -1);
+    std::unordered_map<std::string, int> supplyIdToIdx;
+    for (int i = 0; i < modRequest.vehicleLocs.size(); i++) {
+        supplyIdToIdx[modRequest.vehicleLocs[i].supplyIdx] = i;
+        nodeVehicles[i] = i;
+    }
+    auto findVehicle = [&](const std::string& supplyIdx) {
+        auto it = supplyIdToIdx.find(supplyIdx);
+        return it != supplyIdToIdx.end() ? it->second : -1;
+    };
+    size_t baseIdx = modRequest.vehicleLocs.size();
+    for (int i = 0; i < modRequest.onboardDemands.size(); i++) {
+        nodeVehicles[baseIdx + i] = findVehicle(modRequest.onboardDemands[i].supplyIdx);
+    }
+    baseIdx += modRequest.onboardDemands.size();
+    for (int i = 0; i < modRequest.onboardWaitingDemands.size(); i++) {
+        int vehicle = findVehicle(modRequest.onboardWaitingDemands[i].supplyIdx);
+        nodeVehicles[baseIdx + i * 2] = vehicle;
+        nodeVehicles[baseIdx + i * 2 + 1] = vehicle;
+    }
+    return nodeVehicles;
+}
+
+std::vector<int> mergeNodeVehicles(const std::vector<int>& nodeVehicles, const std::vector<int>& representative)
+{
+    const int unset = -2;
+    std::vector<int> merged(nodeVehicles.size(), unset);
+    for (size_t i = 0; i < nodeVehicles.size(); i++) {
+        int& vehicle = merged[representative[i]];
+        if (vehicle == unset) {
+            vehicle = nodeVehicles[i];
+        } else if (vehicle != nodeVehicles[i]) {
+            vehicle = -1;
+        }
+    }
+    for (auto& vehicle : merged) {
+        if (vehicle == unset) {
+            vehicle = -1;
+        }
+    }
+    return merged;
+}
+
+std::vector<VehicleRowGroup> planReachableTiles(
+    const std::vector<int>& sources,
+    const std::vector<int>& destinations,
+    const std::vector<int>& nodeVehicles,
+    size_t maxSources,
+    const CArcPruner *pruner)
+{
+    std::vector<int> sortedDestinations(destinations);
+    std::sort(sortedDestinations.begin(), sortedDestinations.end());
+    sortedDestinations.erase(std::unique(sortedDestinations.begin(), sortedDestinations.end()), sortedDestinations.end());
+
+    std::vector<VehicleRow> rows;
+    rows.reserve(sources.size());
+    for (int source : sources) {
+        VehicleRow row{ source, {} };
+        for (int destination : sortedDestinations) {
+            if (isArcReachable(nodeVehicles, source, destination)) {
+                row.destinations.push_back(destination);
+            }
+        }
+        if (pruner != nullptr) {
+            pruner->filter(source, row.destinations);
+        }
+        rows.push_back(std::move(row));
+    }
+    return groupVehicleRows(std::move(rows), maxSources);
+}
+
+void fillUnreachableArcs(
+    const std::vector<int>& nodeVehicles,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    std::vector<int> fixedNodes;
+    for (size_t i = 0; i < nodeVehicles.size(); i++) {
+        if (nodeVehicles[i] >= 0 && nodeVehicles[i] != (int) i) {
+            fixedNodes.push_back(i);
+        }
+    }
+    for (size_t from = 0; from < nodeVehicles.size(); from++) {
+        if (nodeVehicles[from] < 0) {
+            continue;
+        }
+        size_t rowIdx = (from + baseVehicle) * (nodeCount + 1) + baseVehicle;
+        for (int to : fixedNodes) {
+            if (nodeVehicles[to] != nodeVehicles[from]) {
+                distMatrix[rowIdx + to] = INT_MAX;
+                timeMatrix[rowIdx + to] = INT_MAX;
+            }
+        }
+    }
+}
+
+CCandidateVehicleIndex::CCandidateVehicleIndex(const ModRequest& modRequest)
+    : m_modRequest(modRequest)
+{
+    auto& vehicles = modRequest.vehicleLocs;
+    std::unordered_map<std::string, int> supplyIdToIdx;
+    m_spareCapacity.resize(vehicles.size());
+    for (int i = 0; i < vehicles.size(); i++) {
+        supplyIdToIdx[vehicles[i].supplyIdx] = i;
+        m_spareCapacity[i] = vehicles[i].capacity;
+    }
+    for (auto& onboardDemand : modRequest.onboardDemands) {
+        auto it = supplyIdToIdx.find(onboardDemand.supplyIdx);
+        if (it != supplyIdToIdx.end()) {
+            m_spareCapacity[it->second] -= onboardDemand.demand;
+        }
+    }
+
+    std::vector<int64_t> keys(vehicles.size());
+    int minLat = INT_MAX, maxLat = INT_MIN, minLng = INT_MAX, maxLng = INT_MIN;
+    for (size_t i = 0; i < vehicles.size(); i++) {
+        int latIdx = (int) std::floor(vehicles[i].location.lat / m_cellDegree);
+        int lngIdx = (int) std::floor(vehicles[i].location.lng / m_cellDegree);
+        keys[i] = gridKey(latIdx, lngIdx);
+        minLat = std::min(minLat, latIdx);
+        maxLat = std::max(maxLat, latIdx);
+        minLng = std::min(minLng, lngIdx);
+        maxLng = std::max(maxLng, lngIdx);
+    }
+    m_gridVehicles.resize(vehicles.size());
+    for (size_t i = 0; i < vehicles.size(); i++) {
+        m_gridVehicles[i] = i;
+    }
+    std::sort(m_gridVehicles.begin(), m_gridVehicles.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+    for (size_t i = 0; i < m_gridVehicles.size(); i++) {
+        int64_t key = keys[m_gridVehicles[i]];
+        if (m_gridKeys.empty() || m_gridKeys.back() != key) {
+            m_gridKeys.push_back(key);
+            m_gridOffsets.push_back(i);
+        }
+    }
+    m_gridOffsets.push_back(m_gridVehicles.size());
+    m_minLat = minLat;
+    m_maxLat = maxLat;
+    m_minLng = minLng;
+    m_maxLng = maxLng;
+}
+
+int64_t CCandidateVehicleIndex::gridKey(int latIdx, int lngIdx) const
+{
+    return ((int64_t) latIdx << 32) ^ ((int64_t) lngIdx & 0xffffffff);
+}
+
+bool CCandidateVehicleIndex::isCompatible(int vehicle, const NewDemand& newDemand) const
+{
+    auto& vehicleLoc = m_modRequest.vehicleLocs[vehicle];
+    // capacity 가 없으면 (0) 확인하지 않음
+    if (vehicleLoc.capacity > 0 && m_spareCapacity[vehicle] < newDemand.demand) {
+        return false;
+    }
+    // 운행 종료 후에 탈 수 있거나, 운행 시작 전에 태워야 하는 경우
+    if (vehicleLoc.operationTime[1] > 0 && newDemand.etaToStart[0] > vehicleLoc.operationTime[1]) {
+        return false;
+    }
+    if (vehicleLoc.operationTime[0] > 0 && newDemand.etaToStart[1] > 0 && vehicleLoc.operationTime[0] > newDemand.etaToStart[1]) {
+        return false;
+    }
+    return true;
+}
+
+std::vector<int> CCandidateVehicleIndex::nearest(const NewDemand& newDemand, size_t k) const
+{
+    std::vector<int> result;
+    auto& vehicles = m_modRequest.vehicleLocs;
+    if (k == 0 || k >= vehicles.size()) {
+        for (int i = 0; i < vehicles.size(); i++) {
+            if (isCompatible(i, newDemand)) {
+                result.push_back(i);
+            }
+        }
+        return result;
+    }
+
+    auto& loc = newDemand.startLoc;
+    int latIdx = (int) std::floor(loc.lat / m_cellDegree);
+    int lngIdx = (int) std::floor(loc.lng / m_cellDegree);
+    int maxRing = std::max({ std::abs(latIdx - m_minLat), std::abs(latIdx - m_maxLat), std::abs(lngIdx - m_minLng), std::abs(lngIdx - m_maxLng) });
+    // ring 하나의 최소 폭 (경도 방향이 더 좁음)
+    double cellMeters = m_cellDegree * 111320.0 * std::max(0.1, std::cos(loc.lat * M_PI / 180.0));
+
+    std::vector<std::pair<double, int>> found;
+    for (int r = 0; r <= maxRing; r++) {
+        for (int dy = -r; dy <= r; dy++) {
+            for (int dx = -r; dx <= r; dx++) {
+                if (std::max(std::abs(dx), std::abs(dy)) != r) {
+                    continue;
+                }
+                int64_t key = gridKey(latIdx + dy, lngIdx + dx);
+                auto it = std::lower_bound(m_gridKeys.begin(), m_gridKeys.end(), key);
+                if (it == m_gridKeys.end() || *it != key) {
+                    continue;
+                }
+                size_t cell = it - m_gridKeys.begin();
+                for (size_t i = m_gridOffsets[cell]; i < m_gridOffsets[cell + 1]; i++) {
+                    int vehicle = m_gridVehicles[i];
+                    if (isCompatible(vehicle, newDemand)) {
+                        found.push_back({ haversineDistance(loc, vehicles[vehicle].location), vehicle });
+                    }
+                }
+            }
+        }
+        // 다음 ring 의 vehicle 은 적어도 r 개 cell 만큼 떨어져 있음
+        if (found.size() >= k) {
+            std::nth_element(found.begin(), found.begin() + (k - 1), found.end());
+            if (found[k - 1].first <= r * cellMeters) {
+                break;
+            }
+        }
+    }
+
+    if (found.size() > k) {
+        std::nth_element(found.begin(), found.begin() + (k - 1), found.end());
+        found.resize(k);
+    }
+    for (auto& item : found) {
+        result.push_back(item.second);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<std::vector<int>> findCandidateVehicles(const ModRequest& modRequest)
+{
+    std::vector<std::vector<int>> candidates(modRequest.newDemands.size());
+    if (g_queryPlanPolicy.candidateVehicles <= 0 || g_queryPlanPolicy.candidateVehicles >= modRequest.vehicleLocs.size()) {
+        // 모든 vehicle 에서 조회
+        std::vector<int> all(modRequest.vehicleLocs.size());
+        for (size_t i = 0; i < all.size(); i++) {
+            all[i] = i;
+        }
+        std::fill(candidates.begin(), candidates.end(), all);
+        return candidates;
+    }
+
+    CCandidateVehicleIndex index(modRequest);
+    for (size_t i = 0; i < modRequest.newDemands.size(); i++) {
+        candidates[i] = index.nearest(modRequest.newDemands[i], g_queryPlanPolicy.candidateVehicles);
+    }
+    return candidates;
+}
+
+void fillNonCandidateArcs(
+    const ModRequest& modRequest,
+    const std::vector<std::vector<int>>& candidates,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    size_t vehicleCount = modRequest.vehicleLocs.size();
+    size_t newBase = vehicleCount + modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size();
+    std::vector<char> isCandidate(vehicleCount);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (candidates[i].size() == vehicleCount) {
+            continue;
+        }
+        std::fill(isCandidate.begin(), isCandidate.end(), 0);
+        for (int vehicle : candidates[i]) {
+            isCandidate[vehicle] = 1;
+        }
+        size_t startNode = newBase + 2 * i + baseVehicle;
+        for (size_t v = 0; v < vehicleCount; v++) {
+            if (!isCandidate[v]) {
+                size_t cellIdx = (v + baseVehicle) * (nodeCount + 1) + startNode;
+                distMatrix[cellIdx] = INT_MAX;
+                timeMatrix[cellIdx] = INT_MAX;
+            }
+        }
+    }
+}
+
+#define COORDINATE_STATION_PREFIX   "~"
+#define METERS_PER_DEGREE           111320.0
+
+std::string coordinateStationId(const Location& loc, double radius)
+{
+    double cellDegree = radius / METERS_PER_DEGREE;
+    int64_t latIdx = (int64_t) std::floor(loc.lat / cellDegree);
+    int64_t lngIdx = (int64_t) std::floor(loc.lng / cellDegree);
+    return COORDINATE_STATION_PREFIX + std::to_string(latIdx) + ":" + std::to_string(lngIdx);
+}
+
+size_t assignCoordinateStations(ModRequest& modRequest, double radius)
+{
+    size_t assigned = 0;
+    auto assign = [&](Location& loc) {
+        if (loc.station_id.empty()) {
+            // snap 한 좌표는 도로 위의 위치로 묶음
+            std::string snapped = g_snapCache.lookup(loc);
+            loc.station_id = snapped.empty() ? coordinateStationId(loc, radius) : COORDINATE_STATION_PREFIX + snapped;
+            assigned++;
+        }
+    };
+    for (auto& onboard : modRequest.onboardDemands) {
+        assign(onboard.destinationLoc);
+    }
+    for (auto& waiting : modRequest.onboardWaitingDemands) {
+        assign(waiting.startLoc);
+        assign(waiting.destinationLoc);
+    }
+    for (auto& newDemand : modRequest.newDemands) {
+        assign(newDemand.startLoc);
+        assign(newDemand.destinationLoc);
+    }
+    return assigned;
+}
+
+std::vector<VehicleRow> mergeColocatedRows(
+    std::vector<VehicleRow> rows,
+    const std::vector<std::pair<std::string, int>>& sourceKeys,
+    std::vector<RowCopy>& copies)
+{
+    std::sort(rows.begin(), rows.end(), [](const VehicleRow& a, const VehicleRow& b) { return a.source < b.source; });
+    std::map<std::pair<std::string, int>, size_t> keyToRow;
+    std::vector<VehicleRow> merged;
+    for (auto& row : rows) {
+        if (row.destinations.empty()) {
+            continue;
+        }
+        auto& key = sourceKeys[row.source];
+        auto it = keyToRow.find(key);
+        if (it == keyToRow.end()) {
+            keyToRow[key] = merged.size();
+            merged.push_back(std::move(row));
+            continue;
+        }
+        auto& target = merged[it->second];
+        std::vector<int> destinations;
+        std::set_union(target.destinations.begin(), target.destinations.end(),
+            row.destinations.begin(), row.destinations.end(), std::back_inserter(destinations));
+        target.destinations = std::move(destinations);
+        copies.push_back({ target.source, row.source, std::move(row.destinations) });
+    }
+    return merged;
+}
+
+void applyRowCopies(
+    const std::vector<RowCopy>& copies,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    for (auto& copy : copies) {
+        size_t fromRow = (copy.from + baseVehicle) * (nodeCount + 1) + baseVehicle;
+        size_t toRow = (copy.to + baseVehicle) * (nodeCount + 1) + baseVehicle;
+        for (int destination : copy.destinations) {
+            distMatrix[toRow + destination] = distMatrix[fromRow + destination];
+            timeMatrix[toRow + destination] = timeMatrix[fromRow + destination];
+        }
+    }
+}
+
+#define EARTH_RADIUS    6371000.0
+
+CArcPruner::CArcPruner(const ModRequest& modRequest, const std::vector<int>& representative, double maxSpeed)
+    : m_maxSpeed(maxSpeed)
+{
+    size_t nodeCount = representative.size();
+    m_x.resize(nodeCount);
+    m_y.resize(nodeCount);
+    m_z.resize(nodeCount);
+    m_earliest.assign(nodeCount, 0.0);
+    m_latest.assign(nodeCount, -1.0);
+    m_shared.assign(nodeCount, 0);
+
+    std::vector<int> members(nodeCount, 0);
+    for (size_t i = 0; i < nodeCount; i++) {
+        members[representative[i]]++;
+    }
+    for (size_t i = 0; i < nodeCount; i++) {
+        m_shared[i] = members[i] > 1;
+    }
+
+    auto setNode = [&](size_t idx, const Location& loc, int earliest) {
+        double lat = loc.lat * M_PI / 180.0;
+        double lng = loc.lng * M_PI / 180.0;
+        m_x[idx] = std::cos(lat) * std::cos(lng);
+        m_y[idx] = std::cos(lat) * std::sin(lng);
+        m_z[idx] = std::sin(lat);
+        m_earliest[idx] = std::max(0, earliest);
+    };
+
+    size_t idx = 0;
+    for (auto& vehicle : modRequest.vehicleLocs) {
+        setNode(idx++, vehicle.location, vehicle.operationTime[0]);
+    }
+    for (auto& onboard : modRequest.onboardDemands) {
+        setNode(idx++, onboard.destinationLoc, onboard.etaToDestination[0]);
+    }
+    for (auto& waiting : modRequest.onboardWaitingDemands) {
+        setNode(idx++, waiting.startLoc, waiting.etaToStart[0]);
+        setNode(idx++, waiting.destinationLoc, waiting.etaToDestination[0]);
+    }
+    if (modRequest.routeArcsOnly) {
+        m_routeNext.assign(nodeCount, -1);
+        for (auto& arc : collectRouteArcs(modRequest)) {
+            if (arc.from < (int) nodeCount && arc.to < (int) nodeCount) {
+                m_routeNext[arc.from] = arc.to;
+            }
+        }
+    }
+    if (modRequest.independentNewDemands && !modRequest.newDemands.empty()) {
+        m_candidates.assign(nodeCount, -1);
+    }
+    for (size_t i = 0; i < modRequest.newDemands.size(); i++) {
+        auto& newDemand = modRequest.newDemands[i];
+        if (newDemand.etaToStart[1] > 0) {
+            m_latest[idx] = newDemand.etaToStart[1];
+        }
+        if (independent()) {
+            m_candidates[idx] = (int) i;
+            m_candidates[idx + 1] = (int) i;
+        }
+        setNode(idx++, newDemand.startLoc, newDemand.etaToStart[0]);
+        setNode(idx++, newDemand.destinationLoc, newDemand.etaToStart[0]);
+    }
+}
+
+bool CArcPruner::isPruned(int from, int to) const
+{
+    if (from == to || m_shared[from] || m_shared[to]) {
+        return false;
+    }
+    if (routeOnly() && m_routeNext[from] != to) {
+        return true;
+    }
+    if (independent() && m_candidates[from] >= 0 && m_candidates[to] >= 0 && m_candidates[from] != m_candidates[to]) {
+        return true;
+    }
+    if (!enabled() || m_latest[to] < 0) {
+        return false;
+    }
+    double reach = std::max(0.0, m_latest[to] - m_earliest[from]) * m_maxSpeed;
+    double dx = m_x[from] - m_x[to];
+    double dy = m_y[from] - m_y[to];
+    double dz = m_z[from] - m_z[to];
+    return EARTH_RADIUS * std::sqrt(dx * dx + dy * dy + dz * dz) > reach;
+}
+
+size_t CArcPruner::filter(int from, std::vector<int>& destinations) const
+{
+    if (!enabled() && !independent() && !routeOnly() && m_known.empty()) {
+        return 0;
+    }
+    size_t nodeCount = m_x.size();
+    size_t before = destinations.size();
+    destinations.erase(std::remove_if(destinations.begin(), destinations.end(), [&](int to) {
+        if (from != to && !m_shared[from] && !m_shared[to] && m_known.count(arcKey(from, to, nodeCount)) > 0) {
+            return true;
+        }
+        return isPruned(from, to);
+    }), destinations.end());
+    return before - destinations.size();
+}
+
+size_t CArcPruner::fillInfeasible(size_t baseVehicle, size_t nodeCount, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix) const
+{
+    size_t n = m_x.size();
+    size_t filled = 0;
+    if (routeOnly()) {
+        // route 의 다음 stop 이 아닌 arc
+        for (size_t from = 0; from < n; from++) {
+            size_t rowIdx = (from + baseVehicle) * (nodeCount + 1) + baseVehicle;
+            for (size_t to = 0; to < n; to++) {
+                if (to != from && (int) to != m_routeNext[from]) {
+                    distMatrix[rowIdx + to] = INT_MAX;
+                    timeMatrix[rowIdx + to] = INT_MAX;
+                    filled++;
+                }
+            }
+        }
+    }
+    if (independent()) {
+        // 서로 다른 new demand 사이의 arc (조회하지 않았거나 station 으로 같이 조회한 값)
+        for (size_t from = 0; from < n; from++) {
+            if (m_candidates[from] < 0) {
+                continue;
+            }
+            size_t rowIdx = (from + baseVehicle) * (nodeCount + 1) + baseVehicle;
+            for (size_t to = 0; to < n; to++) {
+                if (m_candidates[to] >= 0 && m_candidates[to] != m_candidates[from]) {
+                    distMatrix[rowIdx + to] = INT_MAX;
+                    timeMatrix[rowIdx + to] = INT_MAX;
+                    filled++;
+                }
+            }
+        }
+    }
+    if (!enabled()) {
+        return filled;
+    }
+    double scale = m_maxSpeed / EARTH_RADIUS;
+    const double *x = m_x.data();
+    const double *y = m_y.data();
+    const double *z = m_z.data();
+    const double *latest = m_latest.data();
+    std::vector<char> infeasible(n);
+    for (size_t from = 0; from < n; from++) {
+        double fx = x[from], fy = y[from], fz = z[from];
+        double earliest = m_earliest[from];
+        // 분기 없는 loop 로 vectorize 되도록 함 (단위 구 위의 chord 길이의 제곱으로 비교)
+        for (size_t to = 0; to < n; to++) {
+            double dx = fx - x[to];
+            double dy = fy - y[to];
+            double dz = fz - z[to];
+            double reach = std::max(0.0, latest[to] - earliest) * scale;
+            infeasible[to] = (latest[to] >= 0) & (dx * dx + dy * dy + dz * dz > reach * reach);
+        }
+        infeasible[from] = 0;
+        size_t rowIdx = (from + baseVehicle) * (nodeCount + 1) + baseVehicle;
+        for (size_t to = 0; to < n; to++) {
+            if (infeasible[to]) {
+                distMatrix[rowIdx + to] = INT_MAX;
+                timeMatrix[rowIdx + to] = INT_MAX;
+                filled++;
+            }
+        }
+    }
+    return filled;
+}
+
+CVehicleRowCache g_vehicleRowCache;
+
+// from 에서 to 로의 방위각 (degree, 북쪽 0 시계 방향)
+static double bearing(double fromLat, double fromLng, const Location& to)
+{
+    double lat1 = fromLat * M_PI / 180.0;
+    double lat2 = to.lat * M_PI / 180.0;
+    double dLng = (to.lng - fromLng) * M_PI / 180.0;
+    double y = std::sin(dLng) * std::cos(lat2);
+    double x = std::cos(lat1) * std::sin(lat2) - std::sin(lat1) * std::cos(lat2) * std::cos(dLng);
+    return std::fmod(std::atan2(y, x) * 180.0 / M_PI + 360.0, 360.0);
+}
+
+static double angleDiff(double a, double b)
+{
+    double diff = std::fabs(std::fmod(a - b + 360.0, 360.0));
+    return diff > 180.0 ? 360.0 - diff : diff;
+}
+
+double CVehicleRowCache::reuseDistance(const Entry& entry, const Location& loc, std::chrono::steady_clock::time_point now, bool* along) const
+{
+    auto& policy = g_queryPlanPolicy;
+    if (along) {
+        *along = false;
+    }
+    if (now - entry.updated > std::chrono::seconds(policy.rowReuseMaxAge)) {
+        return -1;
+    }
+    double moved = haversineDistance(Location(entry.lng, entry.lat, -1), loc);
+    if (moved <= policy.rowReuseRadius) {
+        return moved;
+    }
+    if (policy.rowReuseAlong <= 0 || moved > policy.rowReuseAlong || entry.direction < 0 || loc.direction < 0) {
+        return -1;
+    }
+    if (angleDiff(entry.direction, loc.direction) > policy.rowReuseHeading
+        || angleDiff(bearing(entry.lat, entry.lng, loc), entry.direction) > policy.rowReuseHeading) {
+        return -1;
+    }
+    if (along) {
+        *along = true;
+    }
+    return moved;
+}
+
+std::vector<char> CVehicleRowCache::reuse(
+    const ModRequest& modRequest,
+    const std::vector<Location>& locs,
+    std::vector<VehicleRow>& rows,
+    std::vector<RowFill>& fills)
+{
+    std::vector<char> reused(modRequest.vehicleLocs.size(), 0);
+    if (g_queryPlanPolicy.rowReuseRadius <= 0) {
+        return reused;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    for (auto& row : rows) {
+        auto it = m_entries.find(modRequest.vehicleLocs[row.source].supplyIdx);
+        if (it == m_entries.end()) {
+            continue;
+        }
+        bool along = false;
+        auto& loc = locs[row.source];
+        double moved = reuseDistance(it->second, loc, now, &along);
+        if (moved < 0) {
+            continue;
+        }
+        reused[row.source] = 1;
+        // heading 방향으로 움직인 경우는 보정하지 않음 (지나친 destination 은 다시 조회)
+        int64_t addDist = along ? 0 : (int64_t) std::ceil(moved);
+        int64_t addTime = along ? 0 : (int64_t) std::ceil(moved / VEHICLE_ROW_ADJUST_SPEED);
+        auto& cells = it->second.cells;
+        std::vector<int> destinations;
+        for (int destination : row.destinations) {
+            auto cell = cells.find(makeLocationKey(locs[destination]));
+            if (cell == cells.end()) {
+                destinations.push_back(destination);
+                continue;
+            }
+            if (along && (cell->second.first <= moved + VEHICLE_ROW_PASSED_MARGIN
+                || angleDiff(bearing(loc.lat, loc.lng, locs[destination]), loc.direction) > 90.0)) {
+                destinations.push_back(destination);
+                continue;
+            }
+            fills.push_back({ row.source, destination, cell->second.first + addDist, cell->second.second + addTime });
+        }
+        row.destinations = std::move(destinations);
+    }
+    return reused;
+}
+
+void CVehicleRowCache::store(
+    const ModRequest& modRequest,
+    const std::vector<Location>& locs,
+    const std::vector<VehicleRow>& rows,
+    const std::vector<char>& reused,
+    size_t baseVehicle,
+    size_t nodeCount,
+    const std::vector<int64_t>& distMatrix,
+    const std::vector<int64_t>& timeMatrix)
+{
+    if (g_queryPlanPolicy.rowReuseRadius <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    auto maxAge = std::chrono::seconds(std::max(g_queryPlanPolicy.rowReuseMaxAge, g_queryPlanPolicy.prefetchIdle));
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+        if (now - it->second.updated > maxAge) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto& row : rows) {
+        if (reused[row.source]) {
+            auto it = m_entries.find(modRequest.vehicleLocs[row.source].supplyIdx);
+            if (it != m_entries.end()) {
+                mergeRow(it->second, locs, row, baseVehicle, nodeCount, distMatrix, timeMatrix);
+                it->second.requested = now;
+            }
+            continue;
+        }
+        auto& entry = replaceRow(modRequest.vehicleLocs[row.source].supplyIdx, locs, row, baseVehicle, nodeCount, distMatrix, timeMatrix, now);
+        entry.requested = now;
+        entry.stops.clear();
+        for (int destination : row.destinations) {
+            entry.stops.push_back(locs[destination]);
+        }
+    }
+}
+
+CVehicleRowCache::Entry& CVehicleRowCache::replaceRow(
+    const std::string& supplyIdx,
+    const std::vector<Location>& locs,
+    const VehicleRow& row,
+    size_t baseVehicle,
+    size_t nodeCount,
+    const std::vector<int64_t>& distMatrix,
+    const std::vector<int64_t>& timeMatrix,
+    std::chrono::steady_clock::time_point now)
+{
+    auto& loc = locs[row.source];
+    auto& entry = m_entries[supplyIdx];
+    entry.lat = loc.lat;
+    entry.lng = loc.lng;
+    entry.direction = loc.direction;
+    entry.updated = now;
+    entry.cells.clear();
+    size_t rowIdx = (row.source + baseVehicle) * (nodeCount + 1) + baseVehicle;
+    for (int destination : row.destinations) {
+        // 조회하지 못한 값 (INT_MAX) 은 보관하지 않음
+        if (distMatrix[rowIdx + destination] == INT_MAX || timeMatrix[rowIdx + destination] == INT_MAX) {
+            continue;
+        }
+        entry.cells[makeLocationKey(locs[destination])] = { distMatrix[rowIdx + destination], timeMatrix[rowIdx + destination] };
+    }
+    return entry;
+}
+
+void CVehicleRowCache::mergeRow(
+    Entry& entry,
+    const std::vector<Location>& locs,
+    const VehicleRow& row,
+    size_t baseVehicle,
+    size_t nodeCount,
+    const std::vector<int64_t>& distMatrix,
+    const std::vector<int64_t>& timeMatrix)
+{
+    size_t rowIdx = (row.source + baseVehicle) * (nodeCount + 1) + baseVehicle;
+    for (int destination : row.destinations) {
+        if (distMatrix[rowIdx + destination] == INT_MAX || timeMatrix[rowIdx + destination] == INT_MAX) {
+            continue;
+        }
+        auto key = makeLocationKey(locs[destination]);
+        if (entry.cells.count(key) == 0) {
+            entry.stops.push_back(locs[destination]);
+        }
+        entry.cells[key] = { distMatrix[rowIdx + destination], timeMatrix[rowIdx + destination] };
+    }
+}
+
+VehiclePrefetch CVehicleRowCache::prepare(const ModRequest& telemetry)
+{
+    VehiclePrefetch prefetch;
+    auto& policy = g_queryPlanPolicy;
+    if (policy.rowReuseRadius <= 0 || policy.prefetchIdle <= 0) {
+        return prefetch;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    std::vector<const Entry *> entries;
+    for (auto& vehicle : telemetry.vehicleLocs) {
+        auto it = m_entries.find(vehicle.supplyIdx);
+        if (it == m_entries.end() || it->second.stops.empty()
+            || now - it->second.requested > std::chrono::seconds(policy.prefetchIdle)) {
+            continue;
+        }
+        // 다음 요청에서 그대로 재사용할 수 있으면 조회하지 않음
+        if (reuseDistance(it->second, vehicle.location, now) >= 0) {
+            continue;
+        }
+        prefetch.supplyIdxs.push_back(vehicle.supplyIdx);
+        prefetch.locs.push_back(vehicle.location);
+        entries.push_back(&it->second);
+    }
+
+    // 여러 vehicle 의 같은 stop 은 한번만 넣음
+    std::unordered_map<std::string, int> stopIdx;
+    for (size_t i = 0; i < entries.size(); i++) {
+        VehicleRow row{ (int) i, {} };
+        for (auto& stop : entries[i]->stops) {
+            auto it = stopIdx.emplace(makeLocationKey(stop), (int) prefetch.locs.size());
+            if (it.second) {
+                prefetch.locs.push_back(stop);
+            }
+            row.destinations.push_back(it.first->second);
+        }
+        std::sort(row.destinations.begin(), row.destinations.end());
+        row.destinations.erase(std::unique(row.destinations.begin(), row.destinations.end()), row.destinations.end());
+        prefetch.rows.push_back(std::move(row));
+    }
+    return prefetch;
+}
+
+void CVehicleRowCache::storePrefetched(
+    const VehiclePrefetch& prefetch,
+    size_t baseVehicle,
+    size_t nodeCount,
+    const std::vector<int64_t>& distMatrix,
+    const std::vector<int64_t>& timeMatrix)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    for (auto& row : prefetch.rows) {
+        auto& supplyIdx = prefetch.supplyIdxs[row.source];
+        // 조회하는 동안 cache 를 비운 경우
+        if (m_entries.count(supplyIdx) == 0) {
+            continue;
+        }
+        replaceRow(supplyIdx, prefetch.locs, row, baseVehicle, nodeCount, distMatrix, timeMatrix, now);
+    }
+}
+
+void CVehicleRowCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+void applyRowFills(
+    const std::vector<RowFill>& fills,
+    size_t baseVehicle,
+    size_t nodeCount,
+    std::vector<int64_t>& distMatrix,
+    std::vector<int64_t>& timeMatrix)
+{
+    for (auto& fill : fills) {
+        size_t idx = (fill.vehicle + baseVehicle) * (nodeCount + 1) + (fill.destination + baseVehicle);
+        distMatrix[idx] = fill.dist;
+        timeMatrix[idx] = fill.time;
+    }
+}
@@ -1,4 +1,5 @@
 #include <sstream>
+#include <iostream>
 #include <vector>
 #include <list>
 #include <deque>
@@ -9,12 +10,18 @@
 #include <chrono>
 #include <cassert>
 #include <cmath>
+#include <climits>
 #include <ctime>
 #include <iomanip>
-#include <cpp-httplib/httplib.h>
-#include <gason/gason.h>
 #include <lnsModRoute.h>
 #include <costCache.h>
+#include <costParser.h>
+#include <requestBuilder.h>
+#include <routeFetcher.h>
+#include <queryPlanner.h>
+#include <costEstimator.h>
+#include <snapCache.h>
+#include <observedArcs.h>
 
 #define VALHALLA_MAX_LOCATIONS 50
 
@@ -31,106 +38,24 @@ public:
     std::vector<int> m_destinations;
     std::string m_body;
 
-    CTaskValhalla(const std::vector<int>& sources, const std::vector<int>& destinations, const std::string& body)
-        : m_sources(sources), m_destinations(destinations), m_body(body) {}
+    CTaskValhalla(const std::vector<int>& sources, const std::vector<int>& destinations, std::string body)
+        : m_sources(sources), m_destinations(destinations), m_body(std::move(body)) {}
 };
 
-std::string makeValhallaIndexLocs(const char *name, const std::vector<Location>& locs, const std::vector<int>& selected)
+void appendValhallaIndexLocs(CBufferWriter& writer, const char *name, const CLocationFragments& fragments, const std::vector<int>& selected)
 {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(8) << "\"" << name << "\":[";
-    if (selected.size() != 0) {
-        oss << "{\"lat\":" << locs[selected[0]].lat << ",\"lon\":" << locs[selected[0]].lng;
-        if (locs[selected[0]].direction != -1) oss << ",\"heading\":" << locs[selected[0]].direction;
-        oss << "}";
-        for (int i = 1; i < selected.size(); i++) {
-            oss << ",{\"lat\":" << locs[selected[i]].lat << ",\"lon\":" << locs[selected[i]].lng;
-            if (locs[selected[i]].direction != -1) oss << ",\"heading\":" << locs[selected[i]].direction;
-            oss << "}";
-        }
-    }
-    oss << "]";
-    return oss.str();
-}
-
-std::shared_ptr<CTaskValhalla> queryCostValhallaBody(
-    const std::string& routePath,
-    const std::string& q_body,
-    const std::vector<int>& sources,
-    const std::vector<int>& destinations)
-{
-    httplib::Client httpClient(routePath.c_str());
-    std::string url = "/sources_to_targets";
-
-    auto res = httpClient.Post(url.c_str(), q_body.c_str(), "application/json");
-    if (!res) {
-        auto err = res.error();
-        throw std::runtime_error("Fail to connect to Valhalla");
-    } else if(res->status != 200) {
-        throw std::runtime_error("Fail to get cost from Valhalla");
-    }
-
-    return std::make_shared<CTaskValhalla>(sources, destinations, res->body.c_str());
-}
-
-void parseVallhallaRespose(
-    const std::string& q_response,
-    const size_t baseVehicle,
-    const size_t nodeCount,
-    const std::vector<int>& sources,
-    const std::vector<int>& destinations,
-    std::vector<int64_t>& distMatrix,
-    std::vector<int64_t>& timeMatrix)
-{
-    char *endptr;
-    JsonValue value;
-    JsonAllocator allocator;
-    int status = jsonParse((char*) q_response.c_str(), &endptr, &value, allocator);
-    if (status != JSON_OK) {
-        throw std::runtime_error("Fail to parse Valhalla response");
-    }
-    if (value.getTag() != JSON_OBJECT || !value.toNode()) {
-        throw std::runtime_error("Invalid Valhalla response format");
-    }
-
-    for (auto item : value) {
-        if (strcmp(item->key, "sources_to_targets") == 0) {
-            if (item->value.getTag() == JSON_ARRAY && item->value.toNode()) {
-                for (auto row : item->value) {
-                    if (row->value.getTag() == JSON_ARRAY && row->value.toNode()) {
-                        for (auto col : row->value) {
-                            if (col->value.getTag() != JSON_OBJECT || !col->value.toNode()) {
-                                throw std::runtime_error("Invalid Valhalla response format");
-                            }
-                            int64_t distance_value = 0;
-                            int64_t time_value = 0;
-                            int to_index = -1;
-                            int from_index = -1; 
-                            for (auto cost : col->value) {
-                                if (strcmp(cost->key, "distance") == 0) {
-                                    distance_value = cost->value.getTag() == JSON_NULL ? INT_MAX : static_cast<int64_t>(std::ceil(cost->value.toNumber() * 1000.0));
-                                } else if (strcmp(cost->key, "time") == 0) {
-                                    time_value = cost->value.getTag() == JSON_NULL ? INT_MAX : static_cast<int64_t>(std::ceil(cost->value.toNumber()));
-                                } else if (strcmp(cost->key, "to_index") == 0) {
-                                    to_index = (int) cost->value.toNumber();
-                                } else if (strcmp(cost->key, "from_index") == 0) {
-                                    from_index = (int) cost->value.toNumber();
-                                }
-                            }
-                            if (to_index != -1 && from_index != -1) {
-                                int idx = (sources[from_index] + baseVehicle) * (nodeCount + 1) + (destinations[to_index] + baseVehicle);
-                                distMatrix[idx] = distance_value;
-                                timeMatrix[idx] = time_value;
-                            }
-                        }
-                    }
-                }
-            }
+    writer.append('"').append(name).append("\":[");
+    for (size_t i = 0; i < selected.size(); i++) {
+        if (i != 0) {
+            writer.append(',');
         }
+        writer.append(fragments[selected[i]]);
     }
+    writer.append(']');
 }
 
-void queryCostValhallaTask(
+size_t queryCostValhallaTask(
+    const std::vector<Location>& locs,
     const std::string& routePath,
     const size_t routeTasks,
     const size_t baseVehicle,
@@ -144,40 +69,46 @@ void queryCostValhallaTask(
         if (showLog) {
             std::cout << logNow() << " queryCostValhallaTask empty task" << std::endl;
         }
-        return;
+        return 0;
     }
 
     size_t taskCount = tasks.size();
     auto start = std::chrono::high_resolution_clock::now();
 
-    std::list<std::future<std::shared_ptr<CTaskValhalla>>> futures;
-
-    size_t runSize = std::min(routeTasks, taskCount);
-    for (size_t i = 0; i < runSize; i++) {
-        auto task = tasks.front();
-        futures.push_back(std::async(std::launch::async,
-            queryCostValhallaBody,
-            routePath, task->m_body, task->m_sources, task->m_destinations));
-        tasks.pop_front();
-    }
-
-    while (!futures.empty()) {
-        for (auto it = futures.begin(); it != futures.end(); ) {
-            auto status = it->wait_for(std::chrono::milliseconds(1));
-            if (status == std::future_status::ready) {
-                if (!tasks.empty()) {
-                    auto task = tasks.front();
-                    futures.push_back(std::async(std::launch::async,
-                        queryCostValhallaBody,
-                        routePath, task->m_body, task->m_sources, task->m_destinations));
-                    tasks.pop_front();
-                }
-                auto result = it->get();
-                parseVallhallaRespose(result->m_body, baseVehicle, nodeCount, result->m_sources, result->m_destinations, distMatrix, timeMatrix);
-                it = futures.erase(it); // 완료된 future는 삭제
-            } else {
-                ++it;
-            }
+    std::vector<std::shared_ptr<CTaskValhalla>> taskList(tasks.begin(), tasks.end());
+    tasks.clear();
+    std::vector<std::shared_ptr<RouteFetchRequest>> requests;
+    requests.reserve(taskList.size());
+    for (auto& task : taskList) {
+        requests.push_back(std::make_shared<RouteFetchRequest>("/sources_to_targets", std::move(task->m_body)));
+    }
+
+    // 모든 backend 가 계속 실패하면 circuit breaker 가 열려서 바로 추정값을 사용 (성공/실패는 backend 별로 기록)
+    std::vector<size_t> failed;
+    if (!g_costEstimatePolicy.enabled || isRoutingAvailable(routePath)) {
+        failed = fetchRouteTiles("Valhalla", routePath, routeTasks, requests,
+            [&](size_t tileIdx, std::string& body) {
+                auto& task = taskList[tileIdx];
+                parseValhallaMatrix(body, baseVehicle, nodeCount, task->m_sources, task->m_destinations, distMatrix, timeMatrix);
+                observeCostTile(locs, baseVehicle, nodeCount, task->m_sources, task->m_destinations, distMatrix, timeMatrix);
+            }, showLog);
+    } else {
+        for (size_t i = 0; i < taskList.size(); i++) {
+            failed.push_back(i);
+        }
+    }
+
+    size_t estimated = 0;
+    if (!failed.empty()) {
+        if (!g_costEstimatePolicy.enabled) {
+            throw std::runtime_error("Fail to get cost from Valhalla");
+        }
+        for (auto tileIdx : failed) {
+            auto& task = taskList[tileIdx];
+            estimated += estimateCostTile(locs, baseVehicle, nodeCount, task->m_sources, task->m_destinations, distMatrix, timeMatrix);
+        }
+        if (showLog) {
+            std::cout << logNow() << " queryCostValhallaTask estimated " << failed.size() << " tiles, " << estimated << " cells" << std::endl;
         }
     }
 
@@ -186,10 +117,12 @@ void queryCostValhallaTask(
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
         std::cout << logNow() << " queryCostValhallaTask[" << taskCount << "] " << duration << " ms" << std::endl;
     }
+
+    return estimated;
 }
 
 void makeTaskValhallaIndex(
-    const std::vector<Location> locs,
+    const CLocationFragments& fragments,
     const std::vector<int>& sources,
     const size_t sourceCount,
     const std::vector<int>& destinations,
@@ -205,14 +138,21 @@ void makeTaskValhallaIndex(
     std::cout << logNow() << " makeTaskValhallaIndex sourceCount: " << sourceCount << ", destinationCount: " << destinationCount << std::endl;
 #endif
 
+    // source 부분은 destination tile 마다 같으므로 한번만 만들고 body 앞부분으로 재사용
+    size_t tileReserve = 128 + reqDateTime.size() + 2 * VALHALLA_MAX_LOCATIONS * (fragments.maxLength() + 1);
     for (size_t s = 0; s < sourceCount; s += VALHALLA_MAX_LOCATIONS) {
         std::vector<int> sub_sources(sources.begin() + s, sources.begin() + std::min(s + VALHALLA_MAX_LOCATIONS, sourceCount));
-        std::string q_source = makeValhallaIndexLocs("sources", locs, sub_sources);
+        CBufferWriter sourceWriter(16 + VALHALLA_MAX_LOCATIONS * (fragments.maxLength() + 1));
+        sourceWriter.append('{');
+        appendValhallaIndexLocs(sourceWriter, "sources", fragments, sub_sources);
+        sourceWriter.append(',');
         for (size_t d = 0; d < destinationCount; d += VALHALLA_MAX_LOCATIONS) {
             std::vector<int> sub_destinations(destinations.begin() + d, destinations.begin() + std::min(d + VALHALLA_MAX_LOCATIONS, destinationCount));
-            std::string q_dest = makeValhallaIndexLocs("targets", locs, sub_destinations);
-            std::string q_body = "{" + q_source + "," + q_dest + ",\"costing\":\"auto\",\"date_time\":{\"type\":1,\"value\":\"" + reqDateTime + "\"}}";
-            tasks.emplace_back(std::make_shared<CTaskValhalla>(sub_sources, sub_destinations, q_body));
+            CBufferWriter writer(tileReserve);
+            writer.append(sourceWriter.view());
+            appendValhallaIndexLocs(writer, "targets", fragments, sub_destinations);
+            writer.append(",\"costing\":\"auto\",\"date_time\":{\"type\":1,\"value\":\"").append(reqDateTime).append("\"}}");
+            tasks.emplace_back(std::make_shared<CTaskValhalla>(sub_sources, sub_destinations, writer.release()));
         }
     }
 }
@@ -235,7 +175,7 @@ std::string getReqDateTime(const std::optional<std::string>& dateTime)
     return oss.str();
 }
 
-void queryCostValhallaAll(
+size_t queryCostValhallaAll(
     const ModRequest& modRequest,
     const std::string& routePath,
     const size_t routeTasks,
@@ -275,45 +215,54 @@ void queryCostValhallaAll(
 
     std::string reqDateTime = getReqDateTime(modRequest.dateTime);
 
+    CLocationFragments fragments(locs, CLocationFragments::VALHALLA_LOCATION);
+
     std::deque<std::shared_ptr<CTaskValhalla>> tasks;
     for (size_t s = 0; s < nodeCount; s += VALHALLA_MAX_LOCATIONS) {
         std::vector<int> sources(index.begin() + s, index.begin() + std::min(nodeCount, s + VALHALLA_MAX_LOCATIONS));
         for (size_t d = 0; d < nodeCount; d += VALHALLA_MAX_LOCATIONS) {
             std::vector<int> destinations(index.begin() + d, index.begin() + std::min(nodeCount, d + VALHALLA_MAX_LOCATIONS));
-            makeTaskValhallaIndex(locs, sources, sources.size(), destinations, destinations.size(), reqDateTime, tasks);
+            makeTaskValhallaIndex(fragments, sources, sources.size(), destinations, destinations.size(), reqDateTime, tasks);
         }
     }
 
-    queryCostValhallaTask(routePath, routeTasks, 1, nodeCount, tasks, distMatrix, timeMatrix, showLog);
+    return queryCostValhallaTask(locs, routePath, routeTasks, 1, nodeCount, tasks, distMatrix, timeMatrix, showLog);
 }
 
 void functionValhallaCostFromVehicle(
     const ModRequest& modRequest,
     const std::vector<Location>& locs,
+    const CLocationFragments& fragments,
     size_t nodeCount,
     const StationToIdxMap& stationToIdx,
     const std::unordered_map<std::string, int>& demandIdToIdx,
     const std::unordered_map<std::string, int>& supplyIdToIdx,
+    const std::unordered_set<int64_t>& knownArcs,
+    const std::vector<std::vector<int>>& newDemandCandidates,
+    const CArcPruner& pruner,
+    VehicleRowPlan& rowPlan,
     const std::string& reqDateTime,
     std::deque<std::shared_ptr<CTaskValhalla>>& tasks)
 {
-    std::vector<int> sources(nodeCount);
-    std::vector<int> destinations(nodeCount);
 #ifdef CHECK_COST_VEHICLE_ONLY_ASSIGNED
-    std::set<int> newDemandsDestinations;
+    std::vector<int> newDemandStarts(modRequest.newDemands.size());
     size_t baseIdx = modRequest.vehicleLocs.size() + modRequest.onboardDemands.size() + 2 * modRequest.onboardWaitingDemands.size();
     for (size_t i = 0; i < modRequest.newDemands.size(); i++) {
         auto& newDemandStartLoc = modRequest.newDemands[i].startLoc;
         assert(modRequest.newDemands[i].startLoc.station_id == locs[baseIdx + i * 2].station_id);
+        newDemandStarts[i] = baseIdx + i * 2; // start loc
         if (!newDemandStartLoc.station_id.empty()) {
             auto it = stationToIdx.find(makeStationKey(newDemandStartLoc.station_id, newDemandStartLoc.direction));
             if (it != stationToIdx.end()) {
-                newDemandsDestinations.insert(it->second);
-            } else {
-                newDemandsDestinations.insert(baseIdx + i * 2); // start loc
+                newDemandStarts[i] = it->second;
             }
-        } else {
-            newDemandsDestinations.insert(baseIdx + i * 2); // start loc
+        }
+    }
+    // new demand 는 가까운 후보 vehicle 에서만 조회 (나머지는 조회 후 INT_MAX 로 채움)
+    std::vector<std::set<int>> newDemandsDestinations(modRequest.vehicleLocs.size());
+    for (size_t i = 0; i < newDemandCandidates.size(); i++) {
+        for (int vehicle : newDemandCandidates[i]) {
+            newDemandsDestinations[vehicle].insert(newDemandStarts[i]);
         }
     }
     std::set<std::string> notAssignedVehicles;
@@ -328,51 +277,68 @@ void functionValhallaCostFromVehicle(
             notAssignedVehicles.erase(it);
         }
     }
-    if (!notAssignedVehicles.empty()) {
-        // not assigned vehicle -> new_demand 조회
-        size_t sourceCount = 0;
-        for (std::string supplyIdx: notAssignedVehicles) {
-            auto it = supplyIdToIdx.find(supplyIdx);
-            if (it != supplyIdToIdx.end()) {
-                sources[sourceCount++] = it->second;
-            }
+    // vehicle 마다 조회할 destination 을 모은 뒤, destination 이 많이 겹치는 vehicle 들을 한 tile 로 묶어서 조회
+    std::vector<VehicleRow> rows;
+    // not assigned vehicle -> new_demand 조회
+    for (std::string supplyIdx: notAssignedVehicles) {
+        auto it = supplyIdToIdx.find(supplyIdx);
+        if (it != supplyIdToIdx.end()) {
+            auto& destinations = newDemandsDestinations[it->second];
+            rows.push_back({ it->second, std::vector<int>(destinations.begin(), destinations.end()) });
         }
-        size_t destCount = newDemandsDestinations.size();
-        std::copy(newDemandsDestinations.begin(), newDemandsDestinations.end(), destinations.begin());
-
-        makeTaskValhallaIndex(locs, sources, sourceCount, destinations, destCount, reqDateTime, tasks);
     }
 
     // TODO: waitingDemand, onboardDemand에는 assigned 되어 있다고 하지만 assigned에 없는 경우는 나중에 처리
     // for each assigned vehicle -> new_demand + assigned demand
-    for (auto assigned : modRequest.assigned) {
+    for (auto& assigned : modRequest.assigned) {
         auto it = supplyIdToIdx.find(assigned.supplyIdx);
         if (it != supplyIdToIdx.end()) {
-            std::set<int> assignedDestinations(newDemandsDestinations);
-            sources[0] = it->second; // vehicle location
+            std::set<int> assignedDestinations(newDemandsDestinations[it->second]);
             for (auto& routeOrder : assigned.routeOrder) {
                 auto demandIt = demandIdToIdx.find(routeOrder.first);
                 if (demandIt == demandIdToIdx.end()) {
                     continue;
                 }
                 auto& loc = locs[demandIt->second];
+                int destIdx = demandIt->second;
                 if (!loc.station_id.empty()) {
-                    auto it = stationToIdx.find(makeStationKey(loc.station_id, loc.direction));
-                    if (it != stationToIdx.end()) {
-                        assignedDestinations.insert(it->second);
-                    } else {
-                        assignedDestinations.insert(demandIt->second);
+                    auto stationIt = stationToIdx.find(makeStationKey(loc.station_id, loc.direction));
+                    if (stationIt != stationToIdx.end()) {
+                        destIdx = stationIt->second;
                     }
-                } else {
-                    assignedDestinations.insert(demandIt->second);
                 }
+                // 첫 stop 처럼 route_times/route_distances 로 알고 있는 arc 는 조회하지 않음 (이미 matrix 에 채워져 있음)
+                if (destIdx == demandIt->second && knownArcs.count(arcKey(it->second, destIdx, nodeCount)) > 0) {
+                    continue;
+                }
+                assignedDestinations.insert(destIdx);
             }
-            size_t destCount = assignedDestinations.size();
-            std::copy(assignedDestinations.begin(), assignedDestinations.end(), destinations.begin());
-            makeTaskValhallaIndex(locs, sources, 1, destinations, destCount, reqDateTime, tasks);
+            rows.push_back({ it->second, std::vector<int>(assignedDestinations.begin(), assignedDestinations.end()) });
+        }
+    }
+
+    // 직선 거리로도 시간 안에 갈 수 없는 new demand 는 조회하지 않음
+    for (auto& row : rows) {
+        pruner.filter(row.source, row.destinations);
+    }
+    // 거의 움직이지 않은 vehicle 은 이전에 조회한 row 를 재사용
+    rowPlan.reused = g_vehicleRowCache.reuse(modRequest, locs, rows, rowPlan.fills);
+    rowPlan.rows = rows;
+    // 같은 위치의 vehicle (차고지 등) 은 한 vehicle 에서만 조회하고, 조회 후 나머지 vehicle 로 복사
+    if (g_queryPlanPolicy.dedupRadius > 0) {
+        std::vector<std::pair<std::string, int>> vehicleKeys(modRequest.vehicleLocs.size());
+        for (size_t i = 0; i < modRequest.vehicleLocs.size(); i++) {
+            vehicleKeys[i] = makeStationKey(coordinateStationId(locs[i], g_queryPlanPolicy.dedupRadius), locs[i].direction);
         }
+        rows = mergeColocatedRows(std::move(rows), vehicleKeys, rowPlan.copies);
+    }
+    for (auto& group : groupVehicleRows(std::move(rows), VALHALLA_MAX_LOCATIONS)) {
+        makeTaskValhallaIndex(fragments, group.sources, group.sources.size(), group.destinations, group.destinations.size(), reqDateTime, tasks);
     }
 #else
+    std::vector<int> sources(nodeCount);
+    std::vector<int> destinations(nodeCount);
+
     // TODO: vehicle 에서 모든 request에 대해서 직접 조회할 필요는 없음
     // assigned 되어 있지 않은 request에 대해서는 조회하고 assigned 되어 있는 것은 해당 vehicle에서만 조회하면 됨
     // 그런데 지금 cost 조회할 때 assigned 되어 있는 request만 조회하는 방법이 마땅치 않아서 다 조회하고 있음
@@ -386,16 +352,19 @@ void functionValhallaCostFromVehicle(
         destinations[destCount++] = it->second;
     }
 
-    makeTaskValhallaIndex(locs, sources, modRequest.vehicleLocs.size(), destinations, destCount, reqDateTime, tasks);
+    makeTaskValhallaIndex(fragments, sources, modRequest.vehicleLocs.size(), destinations, destCount, reqDateTime, tasks);
 #endif
 }
 
 void functionValhallaCostToNewChanged(
     const ModRequest& modRequest,
     const std::vector<Location>& locs,
+    const CLocationFragments& fragments,
     size_t nodeCount,
     const StationToIdxMap& stationToIdx,
     const std::vector<int>& changed,
+    const std::vector<int>& nodeVehicles,
+    const CArcPruner& pruner,
     const std::string& reqDateTime,
     std::deque<std::shared_ptr<CTaskValhalla>>& tasks)
 {
@@ -475,18 +444,30 @@ void functionValhallaCostToNewChanged(
             insertLocationIdx(destLoc, destSet, 2 * (v - waitingSizeInChange) + 1 + newBase);
         }
     }
+#ifdef CHECK_COST_FIXED_ASSIGNMENT
+    // 서로 다른 vehicle 에 고정된 node 사이의 arc 는 제외하고 조회
+    std::vector<int> sourceList(sourceSet.begin(), sourceSet.end());
+    std::vector<int> destList(destSet.begin(), destSet.end());
+    for (auto& group : planReachableTiles(sourceList, destList, nodeVehicles, VALHALLA_MAX_LOCATIONS, &pruner)) {
+        makeTaskValhallaIndex(fragments, group.sources, group.sources.size(), group.destinations, group.destinations.size(), reqDateTime, tasks);
+    }
+#else
     std::copy(sourceSet.begin(), sourceSet.end(), sources.begin());
     std::copy(destSet.begin(), destSet.end(), destinations.begin());
-    makeTaskValhallaIndex(locs, sources, sourceSet.size(), destinations, destSet.size(), reqDateTime, tasks);
+    makeTaskValhallaIndex(fragments, sources, sourceSet.size(), destinations, destSet.size(), reqDateTime, tasks);
+#endif
 }
 
 void functionValhallaCostFromNewChanged(
     const ModRequest& modRequest,
     const std::vector<Location>& locs,
+    const CLocationFragments& fragments,
     size_t nodeCount,
     const StationToIdxMap& stationToIdx,
     const std::vector<int>& changed,
     const std::vector<int>& notChanged,
+    const std::vector<int>& nodeVehicles,
+    const CArcPruner& pruner,
     const std::string& reqDateTime,
     std::deque<std::shared_ptr<CTaskValhalla>>& tasks)
 {
@@ -569,9 +550,18 @@ void functionValhallaCostFromNewChanged(
         }
     }
 
+#ifdef CHECK_COST_FIXED_ASSIGNMENT
+    // 서로 다른 vehicle 에 고정된 node 사이의 arc 는 제외하고 조회
+    std::vector<int> sourceList(sourceSet.begin(), sourceSet.end());
+    std::vector<int> destList(destSet.begin(), destSet.end());
+    for (auto& group : planReachableTiles(sourceList, destList, nodeVehicles, VALHALLA_MAX_LOCATIONS, &pruner)) {
+        makeTaskValhallaIndex(fragments, group.sources, group.sources.size(), group.destinations, group.destinations.size(), reqDateTime, tasks);
+    }
+#else
     std::copy(sourceSet.begin(), sourceSet.end(), sources.begin());
     std::copy(destSet.begin(), destSet.end(), destinations.begin());
-    makeTaskValhallaIndex(locs, sources, sourceSet.size(), destinations, destSet.size(), reqDateTime, tasks);
+    makeTaskValhallaIndex(fragments, sources, sourceSet.size(), destinations, destSet.size(), reqDateTime, tasks);
+#endif
 }
 
 
@@ -581,6 +571,7 @@ int queryCostValhallaNotInCache(
     const size_t routeTasks,
     size_t nodeCount,
     const std::vector<int>& changed,
+    const std::vector<AssignedArc>& observedArcs,
     std::vector<int64_t>& distMatrix,
     std::vector<int64_t>& timeMatrix,
     bool showLog)
@@ -638,25 +629,104 @@ int queryCostValhallaNotInCache(
     size_t baseVehicle = 1; // 0 = ghost depot 
     std::string reqDateTime = getReqDateTime(modRequest.dateTime);
 
+    CLocationFragments fragments(locs, CLocationFragments::VALHALLA_LOCATION);
+
     std::deque<std::shared_ptr<CTaskValhalla>> tasks;
-    functionValhallaCostFromVehicle(modRequest, locs, nodeCount, stationToIdx, demandIdToIdx, supplyIdToIdx, reqDateTime, tasks);
-    functionValhallaCostToNewChanged(modRequest, locs, nodeCount, stationToIdx, changed, reqDateTime, tasks);
-    functionValhallaCostFromNewChanged(modRequest, locs, nodeCount, stationToIdx, changed, notChanged, reqDateTime, tasks);
+    // route_times/route_distances 로 알고 있는 arc 와 관측값이 충분한 stop -> stop arc 는 미리 채우고 조회에서 제외
+    // (이번 요청의 route_times 가 관측값보다 우선)
+    auto assignedArcs = collectAssignedArcs(modRequest);
+    applyAssignedArcs(observedArcs, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    applyAssignedArcs(assignedArcs, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    auto knownArcs = knownArcKeys(assignedArcs, nodeCount);
+    auto observedKeys = knownArcKeys(observedArcs, nodeCount);
+    knownArcs.insert(observedKeys.begin(), observedKeys.end());
+    auto newDemandCandidates = findCandidateVehicles(modRequest);
+    // station 대표 node (조회는 대표 node 기준으로 함)
+    std::vector<int> representative(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+        representative[i] = i;
+        auto& loc = locs[i];
+        if (i >= modRequest.vehicleLocs.size() && !loc.station_id.empty()) {
+            auto it = stationToIdx.find(makeStationKey(loc.station_id, loc.direction));
+            if (it != stationToIdx.end()) {
+                representative[i] = it->second;
+            }
+        }
+    }
+    CArcPruner pruner(modRequest, representative, g_queryPlanPolicy.pruneSpeed);
+    pruner.setKnownArcs(knownArcs);
+    VehicleRowPlan rowPlan;
+    functionValhallaCostFromVehicle(modRequest, locs, fragments, nodeCount, stationToIdx, demandIdToIdx, supplyIdToIdx, knownArcs, newDemandCandidates, pruner, rowPlan, reqDateTime, tasks);
+    // station 대표 node 기준의 고정 vehicle (fixedAssignment)
+    auto nodeVehicles = fixedNodeVehicles(modRequest, nodeCount);
+    auto representativeVehicles = mergeNodeVehicles(nodeVehicles, representative);
+    functionValhallaCostToNewChanged(modRequest, locs, fragments, nodeCount, stationToIdx, changed, representativeVehicles, pruner, reqDateTime, tasks);
+    functionValhallaCostFromNewChanged(modRequest, locs, fragments, nodeCount, stationToIdx, changed, notChanged, representativeVehicles, pruner, reqDateTime, tasks);
 
-    queryCostValhallaTask(routePath, routeTasks, baseVehicle, nodeCount, tasks, distMatrix, timeMatrix, showLog);
+    size_t estimated = queryCostValhallaTask(locs, routePath, routeTasks, baseVehicle, nodeCount, tasks, distMatrix, timeMatrix, showLog);
 
+    applyRowCopies(rowPlan.copies, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    applyRowFills(rowPlan.fills, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    if (estimated == 0) {
+        // 추정값을 사용한 경우는 보관하지 않음
+        g_vehicleRowCache.store(modRequest, locs, rowPlan.rows, rowPlan.reused, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    }
     updateFromVehicleCostMatrixWithStationCache(modRequest, nodeCount, stationToIdx, distMatrix, timeMatrix);
     updateChangedCostMatrixWithStationCache(modRequest, nodeCount, changed, notChanged, stationToIdx, distMatrix, timeMatrix);
+#ifdef CHECK_COST_FIXED_ASSIGNMENT
+    // 조회하지 않은 arc 는 사용할 수 없는 arc 로 채움
+    fillUnreachableArcs(nodeVehicles, baseVehicle, nodeCount, distMatrix, timeMatrix);
+#endif
+#ifdef CHECK_COST_VEHICLE_ONLY_ASSIGNED
+    fillNonCandidateArcs(modRequest, newDemandCandidates, baseVehicle, nodeCount, distMatrix, timeMatrix);
+#endif
+    pruner.fillInfeasible(baseVehicle, nodeCount, distMatrix, timeMatrix);
 
-    return 0;
+    return (int) estimated;
 }
 
 int queryCostValhallaReset()
 {
     g_costCache.clear();
+    g_vehicleRowCache.clear();
+    g_snapCache.clear();
+    g_observedArcs.clear();
+    resetCircuitBreakers();
     return 0;
 }
 
+size_t prefetchVehicleRowsValhalla(
+    const ModRequest& telemetry,
+    const std::string& routePath,
+    const size_t routeTasks,
+    bool showLog)
+{
+    auto prefetch = g_vehicleRowCache.prepare(telemetry);
+    if (prefetch.rows.empty()) {
+        return 0;
+    }
+
+    size_t baseVehicle = 1;
+    size_t nodeCount = prefetch.locs.size();
+    std::string reqDateTime = getReqDateTime(telemetry.dateTime);
+    CLocationFragments fragments(prefetch.locs, CLocationFragments::VALHALLA_LOCATION);
+    std::deque<std::shared_ptr<CTaskValhalla>> tasks;
+    for (auto& group : groupVehicleRows(prefetch.rows, VALHALLA_MAX_LOCATIONS)) {
+        makeTaskValhallaIndex(fragments, group.sources, group.sources.size(), group.destinations, group.destinations.size(), reqDateTime, tasks);
+    }
+
+    // 조회하지 않은 cell 은 row cache 에 보관하지 않도록 INT_MAX 로 시작
+    std::vector<int64_t> distMatrix((nodeCount + 1) * (nodeCount + 1), INT_MAX);
+    std::vector<int64_t> timeMatrix((nodeCount + 1) * (nodeCount + 1), INT_MAX);
+    size_t estimated = queryCostValhallaTask(prefetch.locs, routePath, routeTasks, baseVehicle, nodeCount, tasks, distMatrix, timeMatrix, showLog);
+    if (estimated > 0) {
+        // 추정값을 사용한 경우는 보관하지 않음
+        return 0;
+    }
+    g_vehicleRowCache.storePrefetched(prefetch, baseVehicle, nodeCount, distMatrix, timeMatrix);
+    return prefetch.rows.size();
+}
+
 #ifdef CHECK_VALHALLA_COST_CACHE
 void testCostValhallaCache(
     const ModRequest& modRequest,
@@ -784,15 +854,32 @@ int queryCostValhalla(
     //     return queryCostValhallaAll(modRequest, routePath, nodeCount, distMatrix, timeMatrix, showLog);
     // }
 
+    // station_id 가 없는 좌표는 도로 위의 위치로 snap 해서 위치 key 로 사용
+    snapRequestLocations(modRequest, ROUTE_VALHALLA, routePath, nRouteTasks, showLog);
+
     std::vector<int> changed;
+    int estimated = 0;
     if (g_costCache.checkChangedItem(modRequest, changed)) {
-        queryCostValhallaNotInCache(modRequest, routePath, nRouteTasks, nodeCount, changed, distMatrix, timeMatrix, showLog);
+        // 관측값의 위치 key 는 가상 station 을 붙이기 전의 위치로 찾음
+        auto observedArcs = collectObservedArcs(modRequest, nodeCount);
+        if (g_queryPlanPolicy.dedupRadius > 0) {
+            // station 이 없는 위치는 좌표로 만든 가상 station 으로 묶어서 조회 (조회용 복사본에만 붙임)
+            ModRequest queryRequest = modRequest;
+            assignCoordinateStations(queryRequest, g_queryPlanPolicy.dedupRadius);
+            estimated = queryCostValhallaNotInCache(queryRequest, routePath, nRouteTasks, nodeCount, changed, observedArcs, distMatrix, timeMatrix, showLog);
+        } else {
+            estimated = queryCostValhallaNotInCache(modRequest, routePath, nRouteTasks, nodeCount, changed, observedArcs, distMatrix, timeMatrix, showLog);
+        }
     }
     g_costCache.updateCacheAndCost(modRequest, nodeCount, changed, distMatrix, timeMatrix);
+    if (estimated > 0) {
+        // 추정값은 다음 요청에서 다시 조회하도록 캐시에 남기지 않음
+        g_costCache.discardChanged(modRequest, changed);
+    }
 
 #ifdef CHECK_VALHALLA_COST_CACHE
     testCostValhallaCache(modRequest, routePath, nodeCount, distMatrix, timeMatrix);
 #endif
 
-    return 0;
+    return estimated;
 }
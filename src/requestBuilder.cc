@@ -0,0 +1,44 @@
+#include <algorithm>
+#include <charconv>
+#include <requestBuilder.h>
+
+CBufferWriter& CBufferWriter::appendInt(int64_t value)
+{
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    m_buf.append(buf, result.ptr - buf);
+    return *this;
+}
+
+CBufferWriter& CBufferWriter::appendFixed(double value, int precision)
+{
+    char buf[64];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, precision);
+    if (result.ec != std::errc()) {
+        // 좌표 범위에서는 발생하지 않음. 범위를 벗어난 값은 정수부만 기록
+        return appendInt(static_cast<int64_t>(value));
+    }
+    m_buf.append(buf, result.ptr - buf);
+    return *this;
+}
+
+CLocationFragments::CLocationFragments(const std::vector<Location>& locs, Format format)
+{
+    CBufferWriter writer(locs.size() * (format == OSRM_COORDINATE ? 26 : 56));
+    m_offsets.reserve(locs.size() + 1);
+    m_offsets.push_back(0);
+    for (auto& loc : locs) {
+        if (format == OSRM_COORDINATE) {
+            writer.appendFixed(loc.lng).append(',').appendFixed(loc.lat);
+        } else {
+            writer.append("{\"lat\":").appendFixed(loc.lat).append(",\"lon\":").appendFixed(loc.lng);
+            if (loc.direction != -1) {
+                writer.append(",\"heading\":").appendInt(loc.direction);
+            }
+            writer.append('}');
+        }
+        m_maxLength = std::max(m_maxLength, writer.size() - m_offsets.back());
+        m_offsets.push_back((uint32_t) writer.size());
+    }
+    m_buf = writer.release();
+}
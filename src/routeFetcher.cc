@@ -0,0 +1,565 @@
+#include <iostream>
+#include <list>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <cpp-httplib/httplib.h>
+#include <routeFetcher.h>
+#include <costEstimator.h>
+
+RouteFetchPolicy g_routeFetchPolicy;
+
+extern std::string logNow();
+
+void CLatencyTracker::record(int64_t latency)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_samples.push_back(latency);
+    if (m_samples.size() > MAX_SAMPLES) {
+        m_samples.pop_front();
+    }
+}
+
+int64_t CLatencyTracker::percentile(double p)
+{
+    std::vector<int64_t> samples;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_samples.size() < MIN_SAMPLES) {
+            return -1;
+        }
+        samples.assign(m_samples.begin(), m_samples.end());
+    }
+    size_t k = std::min(samples.size() - 1, (size_t) (p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+#define BACKEND_EJECT_FAILURES  3       // 연속 실패가 이 횟수가 되면 backend 를 제외
+#define BACKEND_EJECT_TIME      5000    // 처음 제외하는 시간 (ms), 다시 제외될 때마다 2배
+#define BACKEND_EJECT_MAX_TIME  60000
+
+bool CRouteBackend::isEjected(std::chrono::steady_clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return now < m_ejectedUntil;
+}
+
+void CRouteBackend::recordSuccess()
+{
+    getCircuitBreaker(m_url).recordSuccess();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failures = 0;
+    m_ejections = 0;
+}
+
+void CRouteBackend::releaseProbe()
+{
+    getCircuitBreaker(m_url).releaseProbe();
+}
+
+void CRouteBackend::recordFailure()
+{
+    getCircuitBreaker(m_url).recordFailure();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (++m_failures < BACKEND_EJECT_FAILURES) {
+        return;
+    }
+    int64_t ejectTime = std::min((int64_t) BACKEND_EJECT_TIME << std::min(m_ejections, 10), (int64_t) BACKEND_EJECT_MAX_TIME);
+    m_ejectedUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(ejectTime);
+    m_ejections++;
+    // 제외가 끝나면 한번의 실패로 다시 제외
+    m_failures = BACKEND_EJECT_FAILURES - 1;
+}
+
+std::vector<std::shared_ptr<CRouteBackend>> getRouteBackends(const std::string& routePath)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::vector<std::shared_ptr<CRouteBackend>>> backends;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = backends.find(routePath);
+    if (it != backends.end()) {
+        return it->second;
+    }
+
+    std::vector<std::shared_ptr<CRouteBackend>> list;
+    size_t begin = 0;
+    while (begin <= routePath.size()) {
+        size_t end = routePath.find(',', begin);
+        if (end == std::string::npos) {
+            end = routePath.size();
+        }
+        std::string url = routePath.substr(begin, end - begin);
+        url.erase(0, url.find_first_not_of(" \t"));
+        url.erase(url.find_last_not_of(" \t") + 1);
+        if (!url.empty()) {
+            list.push_back(std::make_shared<CRouteBackend>(std::move(url)));
+        }
+        begin = end + 1;
+    }
+    if (list.empty()) {
+        throw std::runtime_error("Invalid route path: " + routePath);
+    }
+    backends[routePath] = list;
+    return list;
+}
+
+bool isRoutingAvailable(const std::string& routePath)
+{
+    // probe 는 실제로 tile 을 보낼 때 (pickBackend) 잡음
+    for (auto& backend : getRouteBackends(routePath)) {
+        if (getCircuitBreaker(backend->url()).state() != CCircuitBreaker::OPEN) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+요청을 보낼 backend 선택 (처리 중인 요청이 가장 적은 backend)
+- limit 가 0 보다 크면 처리 중인 요청이 limit 미만인 backend 만 사용
+- exclude 는 가능하면 피함 (hedge, 재시도는 다른 backend 로)
+- 제외(eject)된 backend 는 모든 backend 가 제외된 경우에만 사용
+- 추정값을 사용할 수 있으면 circuit breaker 가 허용하지 않는 backend (open, probe 중인 half open) 는 사용하지 않음
+  선택한 backend 의 breaker 가 half open 이면 이 요청이 probe 가 됨
+*/
+static std::shared_ptr<CRouteBackend> pickBackend(
+    const std::vector<std::shared_ptr<CRouteBackend>>& backends,
+    size_t limit,
+    const CRouteBackend *exclude,
+    std::chrono::steady_clock::time_point now)
+{
+    bool allEjected = true;
+    for (auto& backend : backends) {
+        if (!backend->isEjected(now)) {
+            allEjected = false;
+            break;
+        }
+    }
+
+    std::vector<const CRouteBackend*> refused;
+    while (true) {
+        std::shared_ptr<CRouteBackend> best;
+        std::shared_ptr<CRouteBackend> excluded;
+        for (auto& backend : backends) {
+            if (!allEjected && backend->isEjected(now)) {
+                continue;
+            }
+            if (limit > 0 && (size_t) backend->outstanding() >= limit) {
+                continue;
+            }
+            if (std::find(refused.begin(), refused.end(), backend.get()) != refused.end()) {
+                continue;
+            }
+            if (backend.get() == exclude) {
+                excluded = backend;
+                continue;
+            }
+            if (!best || backend->outstanding() < best->outstanding()) {
+                best = backend;
+            }
+        }
+        if (!best) {
+            best = excluded;
+        }
+        if (!best || !g_costEstimatePolicy.enabled || getCircuitBreaker(best->url()).allowRequest()) {
+            return best;
+        }
+        refused.push_back(best.get());
+    }
+}
+
+static bool hasClosedBreaker(const std::vector<std::shared_ptr<CRouteBackend>>& backends)
+{
+    for (auto& backend : backends) {
+        if (getCircuitBreaker(backend->url()).state() == CCircuitBreaker::CLOSED) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+attempt 가 끝났음을 fetchRouteTiles 에 알림
+routePath 마다 하나를 공유하므로 다른 요청의 attempt 가 끝나서 backend 에 자리가 난 경우에도 깨어남
+*/
+class CFetchSignal {
+public:
+    uint64_t version() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_version;
+    }
+
+    void notify() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_version++;
+        }
+        m_cv.notify_all();
+    }
+
+    // version 이 seen 에서 바뀌거나 wake 가 될 때까지 대기
+    void waitUntil(uint64_t seen, std::chrono::steady_clock::time_point wake) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (wake == std::chrono::steady_clock::time_point::max()) {
+            m_cv.wait(lock, [&]() { return m_version != seen; });
+        } else {
+            m_cv.wait_until(lock, wake, [&]() { return m_version != seen; });
+        }
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    uint64_t m_version = 0;
+};
+
+static std::shared_ptr<CFetchSignal> getFetchSignal(const std::string& routePath)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<CFetchSignal>> signals;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& signal = signals[routePath];
+    if (!signal) {
+        signal = std::make_shared<CFetchSignal>();
+    }
+    return signal;
+}
+
+/*
+tile 요청 한번(attempt)의 상태
+요청은 detach 된 thread 에서 실행되므로 fetchRouteTiles 가 먼저 끝나도(hedge 에서 진 요청, budget 초과)
+thread 가 끝날 때까지 shared_ptr 로 상태를 유지한다
+*/
+class CFetchAttempt {
+public:
+    size_t m_tileIdx;
+    bool m_hedge;
+    std::shared_ptr<CRouteBackend> m_backend;
+    std::chrono::steady_clock::time_point m_start;
+    std::shared_ptr<RouteFetchRequest> m_request;
+    std::shared_ptr<CFetchSignal> m_signal;
+
+    std::atomic<bool> m_finished{false};
+    bool m_ok = false;
+    bool m_retryable = false;
+    std::string m_body;
+
+    CFetchAttempt(size_t tileIdx, bool hedge, std::shared_ptr<CRouteBackend> backend, std::shared_ptr<RouteFetchRequest> request, std::shared_ptr<CFetchSignal> signal)
+        : m_tileIdx(tileIdx), m_hedge(hedge), m_backend(std::move(backend)), m_start(std::chrono::steady_clock::now()),
+          m_request(std::move(request)), m_signal(std::move(signal)) {
+        m_backend->acquire();
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+        if (m_client) {
+            m_client->stop();
+        }
+    }
+
+    static void run(std::shared_ptr<CFetchAttempt> attempt, int timeout) {
+        httplib::Client client(attempt->m_backend->url().c_str());
+        auto duration = std::chrono::milliseconds(timeout);
+        client.set_connection_timeout(duration);
+        client.set_read_timeout(duration);
+        client.set_write_timeout(duration);
+        {
+            std::lock_guard<std::mutex> lock(attempt->m_mutex);
+            if (attempt->m_cancelled) {
+                attempt->finish();
+                return;
+            }
+            attempt->m_client = &client;
+        }
+
+        auto& request = *attempt->m_request;
+        auto res = request.body.empty()
+            ? client.Get(request.path.c_str())
+            : client.Post(request.path.c_str(), request.body, "application/json");
+
+        {
+            std::lock_guard<std::mutex> lock(attempt->m_mutex);
+            attempt->m_client = nullptr;
+        }
+        if (!res) {
+            attempt->m_retryable = true;
+        } else if (res->status == 200) {
+            attempt->m_ok = true;
+            attempt->m_body = std::move(res->body);
+        } else {
+            // 요청 자체가 잘못된 경우(4xx)는 재시도해도 같은 결과
+            attempt->m_retryable = res->status >= 500 || res->status == 429;
+        }
+        attempt->finish();
+    }
+
+private:
+    // backend 의 처리 중인 요청 수는 thread 가 실제로 끝날 때 감소 (취소된 요청도 backend 에서는 처리 중일 수 있음)
+    void finish() {
+        m_backend->release();
+        m_finished = true;
+        m_signal->notify();
+    }
+
+    std::mutex m_mutex;
+    httplib::Client *m_client = nullptr;
+    bool m_cancelled = false;
+};
+
+struct FetchTileState {
+    int attempts = 0;
+    int inflight = 0;
+    bool hedged = false;
+    bool done = false;
+    const CRouteBackend *lastBackend = nullptr;     // 마지막으로 실패한 backend
+    std::chrono::steady_clock::time_point retryAt;
+};
+
+static int64_t elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+}
+
+static int64_t retryDelay(int attempts, int backoff)
+{
+    thread_local std::mt19937 rng(std::random_device{}());
+    std::uniform_real_distribution<double> jitter(0.5, 1.5);
+    int64_t base = (int64_t) backoff << std::min(attempts - 1, 10);
+    return (int64_t) (base * jitter(rng));
+}
+
+std::vector<size_t> fetchRouteTiles(
+    const char *engineName,
+    const std::string& routePath,
+    const size_t routeTasks,
+    const std::vector<std::shared_ptr<RouteFetchRequest>>& requests,
+    const RouteFetchHandler& onResponse,
+    bool showLog)
+{
+    const RouteFetchPolicy policy = g_routeFetchPolicy;
+    auto backends = getRouteBackends(routePath);
+    auto signal = getFetchSignal(routePath);
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(policy.budget);
+
+    std::vector<FetchTileState> tiles(requests.size());
+    std::deque<size_t> pending;
+    for (size_t i = 0; i < requests.size(); i++) {
+        pending.push_back(i);
+    }
+    std::list<size_t> retrying;
+    std::list<std::shared_ptr<CFetchAttempt>> inflight;
+    std::vector<size_t> failed;
+    size_t resolved = 0;
+    size_t retryCount = 0;
+    size_t hedgeCount = 0;
+
+    auto launch = [&](size_t tileIdx, bool hedge, std::shared_ptr<CRouteBackend> backend) {
+        auto attempt = std::make_shared<CFetchAttempt>(tileIdx, hedge, std::move(backend), requests[tileIdx], signal);
+        std::thread(CFetchAttempt::run, attempt, policy.tileTimeout).detach();
+        inflight.push_back(attempt);
+        tiles[tileIdx].inflight++;
+        if (hedge) {
+            tiles[tileIdx].hedged = true;
+            hedgeCount++;
+        } else {
+            tiles[tileIdx].attempts++;
+        }
+    };
+
+    auto cancelAll = [&]() {
+        for (auto& attempt : inflight) {
+            attempt->cancel();
+            attempt->m_backend->releaseProbe();
+        }
+        inflight.clear();
+    };
+
+    try {
+        while (resolved < requests.size()) {
+            // 이 시점 이후에 끝난 attempt 는 아래의 대기를 깨움
+            uint64_t seen = signal->version();
+            auto now = std::chrono::steady_clock::now();
+            if (policy.budget > 0 && now >= deadline) {
+                // budget 안에 응답하지 않은 backend 는 한번씩 실패로 기록 (circuit breaker)
+                std::vector<CRouteBackend*> slow;
+                for (auto& attempt : inflight) {
+                    if (std::find(slow.begin(), slow.end(), attempt->m_backend.get()) == slow.end()) {
+                        slow.push_back(attempt->m_backend.get());
+                    }
+                }
+                for (auto backend : slow) {
+                    getCircuitBreaker(backend->url()).recordFailure();
+                }
+                for (size_t i = 0; i < tiles.size(); i++) {
+                    if (!tiles[i].done) {
+                        tiles[i].done = true;
+                        failed.push_back(i);
+                    }
+                }
+                if (showLog) {
+                    std::cout << logNow() << " fetchRouteTiles[" << engineName << "] budget " << policy.budget << " ms exceeded, "
+                        << failed.size() << " tiles failed" << std::endl;
+                }
+                break;
+            }
+
+            // 끝났거나 deadline 을 넘긴 요청의 결과를 먼저 반영 (실패한 backend 에 새 tile 을 보내기 전에 기록)
+            for (auto it = inflight.begin(); it != inflight.end(); ) {
+                auto attempt = *it;
+                auto& tile = tiles[attempt->m_tileIdx];
+                int64_t elapsed = elapsedMs(attempt->m_start, now);
+                bool finished = attempt->m_finished;
+                if (!finished && elapsed < policy.tileTimeout) {
+                    ++it;
+                    continue;
+                }
+
+                it = inflight.erase(it);
+                tile.inflight--;
+                if (!finished) {
+                    // deadline 초과
+                    attempt->cancel();
+                }
+
+                // 취소되지 않은 요청의 결과로 backend 상태 갱신
+                // 4xx (요청의 문제) 와 이미 끝난 tile 의 요청은 결과 없이 probe 만 반납
+                if (finished && attempt->m_ok) {
+                    attempt->m_backend->recordSuccess();
+                } else if (!finished || attempt->m_retryable) {
+                    if (!tile.done) {
+                        attempt->m_backend->recordFailure();
+                    } else {
+                        attempt->m_backend->releaseProbe();
+                    }
+                    tile.lastBackend = attempt->m_backend.get();
+                } else {
+                    attempt->m_backend->releaseProbe();
+                }
+                if (tile.done) {
+                    continue;
+                }
+
+                if (finished && attempt->m_ok) {
+                    tile.done = true;
+                    resolved++;
+                    attempt->m_backend->latency().record(elapsed);
+                    for (auto& other : inflight) {
+                        if (other->m_tileIdx == attempt->m_tileIdx) {
+                            other->cancel();
+                        }
+                    }
+                    onResponse(attempt->m_tileIdx, attempt->m_body);
+                } else if (tile.inflight > 0) {
+                    // 같은 tile 의 다른 요청(hedge)이 아직 진행 중
+                } else if ((!finished || attempt->m_retryable) && tile.attempts <= policy.maxRetries) {
+                    tile.retryAt = now + std::chrono::milliseconds(retryDelay(tile.attempts, policy.retryBackoff));
+                    retrying.push_back(attempt->m_tileIdx);
+                    retryCount++;
+                } else {
+                    tile.done = true;
+                    resolved++;
+                    failed.push_back(attempt->m_tileIdx);
+                }
+            }
+            if (resolved == requests.size()) {
+                break;
+            }
+
+            // 재시도 대기 시간이 지난 tile 을 먼저 보내고, 남은 자리에 새 tile 을 보냄
+            // backend 마다 routeTasks 개 까지 보내므로 backend 를 늘리면 동시 요청 수도 늘어남
+            bool blocked = false;
+            for (auto it = retrying.begin(); it != retrying.end(); ) {
+                if (tiles[*it].retryAt > now) {
+                    ++it;
+                    continue;
+                }
+                auto backend = pickBackend(backends, routeTasks, tiles[*it].lastBackend, now);
+                if (!backend) {
+                    blocked = true;
+                    break;
+                }
+                launch(*it, false, std::move(backend));
+                it = retrying.erase(it);
+            }
+            while (!pending.empty()) {
+                auto backend = pickBackend(backends, routeTasks, nullptr, now);
+                if (!backend) {
+                    blocked = true;
+                    break;
+                }
+                launch(pending.front(), false, std::move(backend));
+                pending.pop_front();
+            }
+
+            // 보낼 backend 가 없는데 기다릴 요청도 없으면 circuit breaker 가 막은 것 (open, 다른 요청이 probe 중)
+            // 남은 tile 은 실패로 돌려서 추정값을 사용
+            if (blocked && inflight.empty() && g_costEstimatePolicy.enabled && !hasClosedBreaker(backends)) {
+                for (size_t i = 0; i < tiles.size(); i++) {
+                    if (!tiles[i].done) {
+                        tiles[i].done = true;
+                        failed.push_back(i);
+                    }
+                }
+                if (showLog) {
+                    std::cout << logNow() << " fetchRouteTiles[" << engineName << "] circuit breaker open, "
+                        << failed.size() << " tiles failed" << std::endl;
+                }
+                break;
+            }
+
+            // 다음에 깨어날 시간 (budget, 재시도 대기, tile deadline, hedge 시점 중 가장 빠른 시간)
+            // backend 에 자리가 없어서 보내지 못한 요청은 attempt 가 끝날 때 깨어남
+            auto wake = policy.budget > 0 ? deadline : std::chrono::steady_clock::time_point::max();
+            for (auto tileIdx : retrying) {
+                if (tiles[tileIdx].retryAt > now) {
+                    wake = std::min(wake, tiles[tileIdx].retryAt);
+                }
+            }
+            for (auto& attempt : inflight) {
+                auto& tile = tiles[attempt->m_tileIdx];
+                wake = std::min(wake, attempt->m_start + std::chrono::milliseconds(policy.tileTimeout));
+                // backend 에서 관측된 p95 를 넘긴 tile 은 한번만 중복 요청 (가능하면 다른 backend 로)
+                // hedge 도 backend 마다 routeTasks 개 제한을 지키고, 자리가 없으면 보내지 않음
+                if (!policy.hedge || tile.done || tile.hedged || attempt->m_hedge) {
+                    continue;
+                }
+                int64_t p95 = attempt->m_backend->latency().percentile(0.95);
+                if (p95 < 0) {
+                    continue;
+                }
+                int64_t hedgeDelay = std::max((int64_t) policy.hedgeMinDelay, p95);
+                if (elapsedMs(attempt->m_start, now) < hedgeDelay) {
+                    wake = std::min(wake, attempt->m_start + std::chrono::milliseconds(hedgeDelay));
+                    continue;
+                }
+                auto backend = pickBackend(backends, routeTasks, attempt->m_backend.get(), now);
+                if (backend) {
+                    launch(attempt->m_tileIdx, true, std::move(backend));
+                }
+            }
+
+            signal->waitUntil(seen, wake);
+        }
+    } catch (...) {
+        cancelAll();
+        throw;
+    }
+    // hedge 에서 진 요청은 기다리지 않음
+    cancelAll();
+
+    if (showLog && (retryCount > 0 || hedgeCount > 0 || !failed.empty())) {
+        std::cout << logNow() << " fetchRouteTiles[" << engineName << "] tiles: " << requests.size() << ", retries: " << retryCount
+            << ", hedges: " << hedgeCount << ", failed: " << failed.size() << ", " << elapsedMs(start, std::chrono::steady_clock::now()) << " ms" << std::endl;
+    }
+
+    return failed;
+}
@@ -0,0 +1,343 @@
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <unordered_set>
+#include <gason/gason.h>
+#include <lnsModRoute.h>
+#include <snapCache.h>
+#include <queryPlanner.h>
+#include <routeFetcher.h>
+#include <requestBuilder.h>
+#include <costEstimator.h>
+
+#define METERS_PER_DEGREE           111320.0
+#define VALHALLA_SNAP_LOCATIONS     50      // locate 요청 하나에 넣는 좌표 수
+
+extern std::string logNow();
+
+CSnapCache g_snapCache;
+
+static std::string gridKey(double lat, double lng, double cell)
+{
+    double cellDegree = cell / METERS_PER_DEGREE;
+    return std::to_string((int64_t) std::floor(lat / cellDegree)) + ":" + std::to_string((int64_t) std::floor(lng / cellDegree));
+}
+
+// snapCell 크기의 cell (경도 방향도 m 단위로 같은 크기가 되도록 위도 row 마다 경도 간격을 늘림)
+static int64_t cellRow(double lat)
+{
+    return (int64_t) std::floor(lat / (g_queryPlanPolicy.snapCell / METERS_PER_DEGREE));
+}
+
+static int64_t cellColumn(int64_t row, double lng)
+{
+    double rowLat = (row + 0.5) * g_queryPlanPolicy.snapCell / METERS_PER_DEGREE;
+    double lngDegree = g_queryPlanPolicy.snapCell / (METERS_PER_DEGREE * std::max(0.01, std::cos(rowLat * M_PI / 180.0)));
+    return (int64_t) std::floor(lng / lngDegree);
+}
+
+std::string CSnapCache::cellKey(int64_t row, int64_t column, int direction) const
+{
+    return std::to_string(row) + ":" + std::to_string(column) + "@" + std::to_string(direction);
+}
+
+std::string CSnapCache::cellKey(const Location& loc) const
+{
+    int64_t row = cellRow(loc.lat);
+    return cellKey(row, cellColumn(row, loc.lng), loc.direction);
+}
+
+const CSnapCache::Entry* CSnapCache::findNearest(const Location& loc) const
+{
+    // cell 크기가 snapCell 이므로 주변 3 x 3 cell 에서 snapCell 안의 가장 가까운 조회 좌표를 찾음
+    const Entry* nearest = nullptr;
+    double nearestDistance = g_queryPlanPolicy.snapCell;
+    int64_t row = cellRow(loc.lat);
+    for (int64_t r = row - 1; r <= row + 1; r++) {
+        int64_t column = cellColumn(r, loc.lng);
+        for (int64_t c = column - 1; c <= column + 1; c++) {
+            auto it = m_entries.find(cellKey(r, c, loc.direction));
+            if (it == m_entries.end()) {
+                continue;
+            }
+            double distance = haversineDistance(loc, Location(it->second.lng, it->second.lat, -1));
+            if (distance <= nearestDistance) {
+                nearest = &it->second;
+                nearestDistance = distance;
+            }
+        }
+    }
+    return nearest;
+}
+
+std::string CSnapCache::lookup(const Location& loc)
+{
+    if (g_queryPlanPolicy.snapCell <= 0) {
+        return "";
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = findNearest(loc);
+    if (entry == nullptr || entry->key.empty()) {
+        m_stats.misses++;
+        return "";
+    }
+    m_stats.hits++;
+    return entry->key;
+}
+
+std::vector<Location> CSnapCache::missing(const std::vector<Location>& locs)
+{
+    std::vector<Location> targets;
+    std::unordered_set<std::string> cells;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    for (auto& loc : locs) {
+        auto entry = findNearest(loc);
+        if (entry != nullptr
+            && (!entry->key.empty() || now - entry->updated < std::chrono::seconds(SNAP_FAILURE_RETRY))) {
+            continue;
+        }
+        if (cells.insert(cellKey(loc)).second) {
+            targets.push_back(loc);
+        }
+    }
+    return targets;
+}
+
+void CSnapCache::store(const Location& loc, const std::string& edge, double snappedLat, double snappedLng)
+{
+    std::string cell = cellKey(loc);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(cell);
+    if (it == m_entries.end()) {
+        // 가득 차면 가장 오래 전에 조회한 cell 부터 지움
+        if (m_entries.size() >= SNAP_CACHE_MAX_ENTRIES) {
+            m_entries.erase(m_order.front());
+            m_order.pop_front();
+        }
+        m_order.push_back(cell);
+        it = m_entries.emplace(cell, Entry()).first;
+        it->second.order = std::prev(m_order.end());
+    } else {
+        m_order.splice(m_order.end(), m_order, it->second.order);
+    }
+    auto& entry = it->second;
+    entry.lat = loc.lat;
+    entry.lng = loc.lng;
+    entry.updated = std::chrono::steady_clock::now();
+    if (edge.empty()) {
+        entry.key.clear();
+        m_stats.failed++;
+    } else {
+        entry.key = edge + "/" + gridKey(snappedLat, snappedLng, SNAP_KEY_CELL);
+        m_stats.resolved++;
+    }
+}
+
+CSnapCache::Stats CSnapCache::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void CSnapCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_order.clear();
+}
+
+static JsonValue findJsonValue(const JsonValue& object, const char *key)
+{
+    if (object.getTag() != JSON_OBJECT) {
+        return JsonValue();
+    }
+    for (auto item : object) {
+        if (strcmp(item->key, key) == 0) {
+            return item->value;
+        }
+    }
+    return JsonValue();
+}
+
+// 도로에서 먼 좌표는 snap 하지 않음
+static void storeSnapped(const Location& loc, const std::string& edge, double snappedLat, double snappedLng)
+{
+    if (haversineDistance(loc, Location(snappedLng, snappedLat, -1)) > SNAP_MAX_DISTANCE) {
+        g_snapCache.store(loc, "", 0, 0);
+    } else {
+        g_snapCache.store(loc, edge, snappedLat, snappedLng);
+    }
+}
+
+// OSRM nearest: 좌표마다 요청 하나, edge 는 양 끝 node
+static void snapLocationsOsrm(const std::vector<Location>& targets, const std::string& routePath, const size_t routeTasks, bool showLog)
+{
+    CLocationFragments fragments(targets, CLocationFragments::OSRM_COORDINATE);
+    std::vector<std::shared_ptr<RouteFetchRequest>> requests;
+    for (size_t i = 0; i < targets.size(); i++) {
+        CBufferWriter writer(64 + fragments.maxLength());
+        writer.append("/nearest/v1/driving/").append(fragments[i]).append("?number=1");
+        if (targets[i].direction >= 0) {
+            writer.append("&bearings=").appendInt(targets[i].direction).append(",45");
+        }
+        requests.push_back(std::make_shared<RouteFetchRequest>(writer.release(), ""));
+    }
+
+    std::vector<char> handled(targets.size(), 0);
+    fetchRouteTiles("OSRM", routePath, routeTasks, requests,
+        [&](size_t idx, std::string& body) {
+            char *endptr;
+            JsonValue value;
+            JsonAllocator allocator;
+            if (jsonParse(body.data(), &endptr, &value, allocator) != JSON_OK) {
+                return;
+            }
+            auto waypoints = findJsonValue(value, "waypoints");
+            if (waypoints.getTag() != JSON_ARRAY || !waypoints.toNode()) {
+                return;
+            }
+            auto waypoint = waypoints.toNode()->value;
+            auto nodes = findJsonValue(waypoint, "nodes");
+            auto location = findJsonValue(waypoint, "location");
+            if (nodes.getTag() != JSON_ARRAY || location.getTag() != JSON_ARRAY) {
+                return;
+            }
+            std::vector<double> nodeIds, coordinate;
+            for (auto node : nodes) {
+                nodeIds.push_back(node->value.getTag() == JSON_NUMBER ? node->value.toNumber() : 0);
+            }
+            for (auto item : location) {
+                coordinate.push_back(item->value.getTag() == JSON_NUMBER ? item->value.toNumber() : 0);
+            }
+            if (nodeIds.size() != 2 || coordinate.size() != 2) {
+                return;
+            }
+            std::string edge = "o" + std::to_string((int64_t) nodeIds[0]) + "-" + std::to_string((int64_t) nodeIds[1]);
+            storeSnapped(targets[idx], edge, coordinate[1], coordinate[0]);
+            handled[idx] = 1;
+        }, showLog);
+
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (!handled[i]) {
+            g_snapCache.store(targets[i], "", 0, 0);
+        }
+    }
+}
+
+// Valhalla locate: 요청 하나에 여러 좌표, edge 는 way_id 와 도로의 어느 쪽인지
+static void snapLocationsValhalla(const std::vector<Location>& targets, const std::string& routePath, const size_t routeTasks, bool showLog)
+{
+    CLocationFragments fragments(targets, CLocationFragments::VALHALLA_LOCATION);
+    std::vector<std::shared_ptr<RouteFetchRequest>> requests;
+    for (size_t s = 0; s < targets.size(); s += VALHALLA_SNAP_LOCATIONS) {
+        CBufferWriter writer(64 + VALHALLA_SNAP_LOCATIONS * (fragments.maxLength() + 1));
+        writer.append("{\"locations\":[");
+        for (size_t i = s; i < std::min(targets.size(), s + VALHALLA_SNAP_LOCATIONS); i++) {
+            if (i != s) {
+                writer.append(',');
+            }
+            writer.append(fragments[i]);
+        }
+        writer.append("],\"costing\":\"auto\"}");
+        requests.push_back(std::make_shared<RouteFetchRequest>("/locate", writer.release()));
+    }
+
+    std::vector<char> handled(targets.size(), 0);
+    fetchRouteTiles("Valhalla", routePath, routeTasks, requests,
+        [&](size_t tileIdx, std::string& body) {
+            char *endptr;
+            JsonValue value;
+            JsonAllocator allocator;
+            if (jsonParse(body.data(), &endptr, &value, allocator) != JSON_OK || value.getTag() != JSON_ARRAY) {
+                return;
+            }
+            size_t idx = tileIdx * VALHALLA_SNAP_LOCATIONS;
+            for (auto item : value) {
+                if (idx >= targets.size()) {
+                    break;
+                }
+                auto edges = findJsonValue(item->value, "edges");
+                if (edges.getTag() == JSON_ARRAY && edges.toNode()) {
+                    auto edge = edges.toNode()->value;
+                    auto wayId = findJsonValue(edge, "way_id");
+                    auto lat = findJsonValue(edge, "correlated_lat");
+                    auto lon = findJsonValue(edge, "correlated_lon");
+                    auto side = findJsonValue(edge, "side_of_street");
+                    if (wayId.getTag() == JSON_NUMBER && lat.getTag() == JSON_NUMBER && lon.getTag() == JSON_NUMBER) {
+                        std::string key = "v" + std::to_string((int64_t) wayId.toNumber());
+                        if (side.getTag() == JSON_STRING) {
+                            key += std::string(":") + side.toString();
+                        }
+                        storeSnapped(targets[idx], key, lat.toNumber(), lon.toNumber());
+                        handled[idx] = 1;
+                    }
+                }
+                idx++;
+            }
+        }, showLog);
+
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (!handled[i]) {
+            g_snapCache.store(targets[i], "", 0, 0);
+        }
+    }
+}
+
+void snapRequestLocations(
+    const ModRequest& modRequest,
+    RouteType routeType,
+    const std::string& routePath,
+    const size_t routeTasks,
+    bool showLog)
+{
+    if (g_queryPlanPolicy.snapCell <= 0 || (routeType != ROUTE_OSRM && routeType != ROUTE_VALHALLA)) {
+        return;
+    }
+
+    std::vector<Location> locs;
+    auto add = [&](const Location& loc) {
+        if (loc.station_id.empty()) {
+            locs.push_back(loc);
+        }
+    };
+    for (auto& onboard : modRequest.onboardDemands) {
+        add(onboard.destinationLoc);
+    }
+    for (auto& waiting : modRequest.onboardWaitingDemands) {
+        add(waiting.startLoc);
+        add(waiting.destinationLoc);
+    }
+    for (auto& newDemand : modRequest.newDemands) {
+        add(newDemand.startLoc);
+        add(newDemand.destinationLoc);
+    }
+    auto targets = g_snapCache.missing(locs);
+    if (targets.empty()) {
+        return;
+    }
+    // 모든 backend 에 문제가 있으면 snap 하지 않고 좌표 key 를 사용
+    bool healthy = false;
+    for (auto& backend : getRouteBackends(routePath)) {
+        healthy = healthy || getCircuitBreaker(backend->url()).state() == CCircuitBreaker::CLOSED;
+    }
+    if (!healthy) {
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (routeType == ROUTE_OSRM) {
+        snapLocationsOsrm(targets, routePath, routeTasks, showLog);
+    } else {
+        snapLocationsValhalla(targets, routePath, routeTasks, showLog);
+    }
+    if (showLog) {
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        auto stats = g_snapCache.stats();
+        std::cout << logNow() << " snapRequestLocations[" << targets.size() << "] " << duration << " ms"
+            << " (resolved " << stats.resolved << ", failed " << stats.failed
+            << ", hits " << stats.hits << ", misses " << stats.misses << ")" << std::endl;
+    }
+}
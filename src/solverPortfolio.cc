@@ -0,0 +1,242 @@
+#include <iostream>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <modState.h>
+#include <threadPool.h>
+#include <solverPortfolio.h>
+#include <exactSolver.h>
+
+extern std::string logNow();
+
+SolvePolicy g_solvePolicy;
+
+CThreadPool& solverPool()
+{
+    static CThreadPool pool([]() {
+        if (g_solvePolicy.portfolioThreads > 0) {
+            return (size_t) g_solvePolicy.portfolioThreads;
+        }
+        return (size_t) std::max(1, (int) std::thread::hardware_concurrency() - 1);
+    }());
+    return pool;
+}
+
+Solution* solveLns(const SolveInput& input, const AlgorithmParameters* ap)
+{
+    auto& modState = input.modState;
+    return solve_lns_pdptw(
+        input.nodeCount + 1, input.costMatrix.data(), input.distMatrix.data(), input.timeMatrix.data(),
+        modState.demands.data(), modState.serviceTimes.data(), modState.earliestArrival.data(), modState.latestArrival.data(), modState.acceptableArrival.data(),
+        modState.pickupSibling.data(), modState.deliverySibling.data(), modState.fixedAssignment.data(),
+        (int) input.vehicleCount, modState.vehicleCapacities.data(), modState.startDepots.data(), modState.endDepots.data(),
+        (int) modState.initialSolution.size(), modState.initialSolution.data(), ap
+    );
+}
+
+int remainingTimeLimit(const AlgorithmParameters& ap, std::chrono::steady_clock::time_point start)
+{
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    if (ap.time_limit <= 0 || elapsed <= PORTFOLIO_START_SLACK_MS) {
+        return ap.time_limit;
+    }
+    int64_t remaining = (int64_t) ap.time_limit * 1000 - elapsed + PORTFOLIO_START_SLACK_MS;
+    return remaining >= 1000 ? (int) (remaining / 1000) : -1;
+}
+
+AlgorithmParameters portfolioParameters(const AlgorithmParameters& ap, int k)
+{
+    AlgorithmParameters parameter = ap;
+    if (k == 0) {
+        return parameter;
+    }
+    parameter.seed = ap.seed + k * 7919;
+    switch (k % 4) {
+    case 1:
+        // 많이 제거하고 높은 온도에서 시작 (탐색 범위 확대)
+        parameter.removal_req_iteration_control_e = std::min(0.6, ap.removal_req_iteration_control_e * 1.5);
+        parameter.simulated_annealing_start_temp_control_w = ap.simulated_annealing_start_temp_control_w * 2;
+        break;
+    case 2:
+        // 적게 제거하고 낮은 온도에서 시작 (현재 solution 주변 집중)
+        parameter.removal_req_iteration_control_e = ap.removal_req_iteration_control_e * 0.5;
+        parameter.simulated_annealing_start_temp_control_w = ap.simulated_annealing_start_temp_control_w * 0.5;
+        break;
+    case 3:
+        // 제거, 삽입의 무작위성 증가
+        parameter.shaw_removal_p = std::max<decltype(ap.shaw_removal_p)>(1, ap.shaw_removal_p / 2);
+        parameter.worst_removal_p = std::max<decltype(ap.worst_removal_p)>(1, ap.worst_removal_p / 2);
+        parameter.insertion_objective_noise_n = ap.insertion_objective_noise_n * 2;
+        break;
+    default:
+        // seed 만 다름
+        break;
+    }
+    return parameter;
+}
+
+int64_t solutionCost(const SolveInput& input, const Solution* solution)
+{
+    int64_t cost = 0;
+    size_t width = input.nodeCount + 1;
+    for (int i = 0; i < solution->n_routes; i++) {
+        auto& route = solution->routes[i];
+        int prev = -1;
+        for (int j = 0; j < route.length; j++) {
+            int node = route.path[j];
+            if (node < 0) {
+                continue;
+            }
+            if (prev >= 0) {
+                cost += input.costMatrix[prev * width + node];
+            }
+            prev = node;
+        }
+    }
+    return cost;
+}
+
+bool isBetterSolution(const SolveInput& input, const Solution* a, const Solution* b)
+{
+    if (b == nullptr) {
+        return a != nullptr;
+    }
+    if (a == nullptr) {
+        return false;
+    }
+    if (a->n_missing != b->n_missing) {
+        return a->n_missing < b->n_missing;
+    }
+    if (a->n_unacceptables != b->n_unacceptables) {
+        return a->n_unacceptables < b->n_unacceptables;
+    }
+    return solutionCost(input, a) < solutionCost(input, b);
+}
+
+Solution* solvePortfolio(
+    const SolveInput& input,
+    const AlgorithmParameters* ap,
+    int solvers,
+    bool showLog,
+    std::chrono::steady_clock::time_point start)
+{
+    // pool 에서 늦게 시작한 요청 (solveConcurrently 의 alternative) 은 0 번 solver 도 남은 시간만 풂
+    AlgorithmParameters first = *ap;
+    first.time_limit = remainingTimeLimit(*ap, start);
+    if (first.time_limit < 0) {
+        return nullptr;
+    }
+    if (input.nodeCount <= (size_t) std::max(0, g_solvePolicy.exactMaxNodes)) {
+        Solution* exact = solveExact(input, &first, showLog);
+        if (exact != nullptr) {
+            return exact;
+        }
+    }
+    if (solvers <= 1) {
+        return solveLns(input, &first);
+    }
+
+    enum { PENDING, RUNNING, SKIPPED };
+    struct Slot {
+        std::atomic<int> status{PENDING};
+        AlgorithmParameters parameter;
+        std::future<Solution*> result;
+    };
+    // 시작하지 못하고 pool 에 남은 작업이 참조하므로 shared_ptr 로 유지
+    std::vector<std::shared_ptr<Slot>> slots;
+    for (int k = 1; k < solvers; k++) {
+        auto slot = std::make_shared<Slot>();
+        slot->parameter = portfolioParameters(*ap, k);
+        const SolveInput* in = &input;
+        slot->result = solverPool().enqueue([slot, in, start]() -> Solution* {
+            int expected = PENDING;
+            if (!slot->status.compare_exchange_strong(expected, RUNNING)) {
+                return nullptr;
+            }
+            // 다른 요청의 solver 때문에 늦게 시작하면 남은 시간만 풂
+            slot->parameter.time_limit = remainingTimeLimit(slot->parameter, start);
+            if (slot->parameter.time_limit < 0) {
+                return nullptr;
+            }
+            return solveLns(*in, &slot->parameter);
+        });
+        slots.push_back(slot);
+    }
+
+    Solution* best = solveLns(input, &first);
+    int bestIdx = 0;
+    int solved = 1;
+    for (size_t k = 0; k < slots.size(); k++) {
+        auto& slot = slots[k];
+        int expected = PENDING;
+        if (slot->status.compare_exchange_strong(expected, SKIPPED)) {
+            continue;
+        }
+        Solution* solution = slot->result.get();
+        if (solution == nullptr) {
+            continue;
+        }
+        solved++;
+        if (isBetterSolution(input, solution, best)) {
+            if (best != nullptr) {
+                delete_solution(best);
+            }
+            best = solution;
+            bestIdx = (int) k + 1;
+        } else {
+            delete_solution(solution);
+        }
+    }
+
+    if (showLog) {
+        std::cout << logNow() << " portfolio : solved=" << solved << "/" << solvers << "  best=" << bestIdx << std::endl;
+    }
+    return best;
+}
+
+std::vector<Solution*> solveConcurrently(const std::vector<SolveInput>& inputs, const AlgorithmParameters* ap, int portfolio, bool showLog)
+{
+    std::vector<Solution*> solutions(inputs.size(), nullptr);
+    if (inputs.empty()) {
+        return solutions;
+    }
+    auto start = std::chrono::steady_clock::now();
+    enum { PENDING, RUNNING, SKIPPED };
+    struct Slot {
+        std::atomic<int> status{PENDING};
+        std::future<Solution*> result;
+    };
+    // solvePortfolio 와 같이 0 번이 끝날 때까지 시작하지 못한 input 은 풀지 않고,
+    // 시작한 input 은 start 부터 남은 시간만 풀어서 time_limit 안에 끝남
+    std::vector<std::shared_ptr<Slot>> slots;
+    for (size_t k = 1; k < inputs.size(); k++) {
+        auto slot = std::make_shared<Slot>();
+        const SolveInput* in = &inputs[k];
+        AlgorithmParameters parameter = *ap;
+        slot->result = solverPool().enqueue([slot, in, parameter, portfolio, showLog, start]() -> Solution* {
+            int expected = PENDING;
+            if (!slot->status.compare_exchange_strong(expected, RUNNING)) {
+                return nullptr;
+            }
+            return solvePortfolio(*in, &parameter, portfolio, showLog, start);
+        });
+        slots.push_back(slot);
+    }
+    solutions[0] = solvePortfolio(inputs[0], ap, portfolio, showLog, start);
+    int skipped = 0;
+    for (size_t k = 1; k < inputs.size(); k++) {
+        auto& slot = slots[k - 1];
+        int expected = PENDING;
+        if (slot->status.compare_exchange_strong(expected, SKIPPED)) {
+            skipped++;
+            continue;
+        }
+        solutions[k] = slot->result.get();
+    }
+    if (showLog && skipped > 0) {
+        std::cout << logNow() << " alternatives : skipped=" << skipped << "/" << inputs.size() << std::endl;
+    }
+    return solutions;
+}
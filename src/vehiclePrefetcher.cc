@@ -0,0 +1,113 @@
+#include <iostream>
+#include <stdexcept>
+#include <lnsModRoute.h>
+#include <queryOsrmCost.h>
+#include <queryValhallaCost.h>
+#include <vehiclePrefetcher.h>
+
+#define VEHICLE_PREFETCH_ROUTE_TASKS    1   // backend 마다 동시에 보내는 prefetch 요청 수
+
+extern std::string logNow();
+
+CVehiclePrefetcher g_vehiclePrefetcher;
+
+CVehiclePrefetcher::~CVehiclePrefetcher()
+{
+    stop();
+}
+
+void CVehiclePrefetcher::start(const std::string& routePath, RouteType routeType, bool showLog)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_routePath = routePath;
+    m_routeType = routeType;
+    m_showLog = showLog;
+    if (!m_worker.joinable()) {
+        m_stop = false;
+        m_worker = std::thread(&CVehiclePrefetcher::run, this);
+    }
+}
+
+void CVehiclePrefetcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_pending.clear();
+    }
+    m_condition.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+size_t CVehiclePrefetcher::submit(const std::vector<VehicleLocation>& vehicles)
+{
+    size_t pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_worker.joinable()) {
+            throw std::runtime_error("Vehicle prefetcher is not started");
+        }
+        for (auto& vehicle : vehicles) {
+            m_pending[vehicle.supplyIdx] = vehicle;
+        }
+        pending = m_pending.size();
+    }
+    m_condition.notify_all();
+    return pending;
+}
+
+void CVehiclePrefetcher::beginForeground()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_foreground++;
+}
+
+void CVehiclePrefetcher::endForeground()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_foreground--;
+    }
+    m_condition.notify_all();
+}
+
+void CVehiclePrefetcher::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this]() { return m_stop || (!m_pending.empty() && m_foreground == 0); });
+        if (m_stop) {
+            break;
+        }
+
+        ModRequest telemetry;
+        for (auto& item : m_pending) {
+            telemetry.vehicleLocs.push_back(std::move(item.second));
+        }
+        m_pending.clear();
+        std::string routePath = m_routePath;
+        RouteType routeType = m_routeType;
+        bool showLog = m_showLog;
+        lock.unlock();
+
+        try {
+            size_t prefetched = 0;
+            if (routeType == ROUTE_OSRM) {
+                prefetched = prefetchVehicleRowsOsrm(telemetry, routePath, VEHICLE_PREFETCH_ROUTE_TASKS, false);
+            } else if (routeType == ROUTE_VALHALLA) {
+                prefetched = prefetchVehicleRowsValhalla(telemetry, routePath, VEHICLE_PREFETCH_ROUTE_TASKS, false);
+            }
+            if (showLog && prefetched > 0) {
+                std::cout << logNow() << " prefetch vehicle rows : " << prefetched << "/" << telemetry.vehicleLocs.size() << std::endl;
+            }
+        } catch (std::exception& e) {
+            if (showLog) {
+                std::cout << logNow() << " prefetch vehicle rows failed : " << e.what() << std::endl;
+            }
+        }
+
+        lock.lock();
+    }
+}
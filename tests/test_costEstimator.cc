@@ -0,0 +1,123 @@
+#include <cassert>
+#include <cmath>
+#include <climits>
+#include <thread>
+#include <costEstimator.h>
+#include <routeFetcher.h>
+
+class CCostEstimatorTest {
+public:
+    void testHaversine() {
+        // 서울역 -> 강남역 직선 거리 약 8.1km
+        Location seoul(126.9707, 37.5547, -1);
+        Location gangnam(127.0276, 37.4979, -1);
+        double d = haversineDistance(seoul, gangnam);
+        assert(d > 7900 && d < 8300);
+        assert(haversineDistance(seoul, seoul) == 0.0);
+    }
+
+    void testEstimateDefault() {
+        CCostEstimator estimator;
+        Location from(127.0, 37.5, -1);
+        Location to(127.0, 37.51, -1);
+        int64_t dist, time;
+        estimator.estimate(from, to, dist, time);
+        double straight = haversineDistance(from, to);
+        assert(dist == (int64_t) std::ceil(straight * g_costEstimatePolicy.detourFactor));
+        assert(time == (int64_t) std::ceil(straight * g_costEstimatePolicy.detourFactor / g_costEstimatePolicy.speed));
+    }
+
+    void testEstimateCalibrated() {
+        CCostEstimator estimator;
+        Location from(127.0, 37.5, -1);
+        Location to(127.0, 37.52, -1);
+        double straight = haversineDistance(from, to);
+        // 관측값: detour 1.5, 속도 5 m/s
+        int64_t observedDist = (int64_t) (straight * 1.5);
+        for (int i = 0; i < 10; i++) {
+            estimator.observe(from, to, observedDist, observedDist / 5);
+        }
+        int64_t dist, time;
+        estimator.estimate(from, to, dist, time);
+        assert(std::abs(dist - observedDist) <= 2);
+        assert(std::abs(time - observedDist / 5) <= 2);
+
+        // 도달 불가능 cell 은 보정에 사용하지 않음
+        estimator.observe(from, to, INT_MAX, INT_MAX);
+        int64_t dist2, time2;
+        estimator.estimate(from, to, dist2, time2);
+        assert(dist2 == dist && time2 == time);
+    }
+
+    void testCircuitBreaker() {
+        g_costEstimatePolicy.breakerFailures = 2;
+        g_costEstimatePolicy.breakerCooldown = 20;
+        CCircuitBreaker breaker;
+        assert(breaker.allowRequest());
+        breaker.recordFailure();
+        assert(breaker.state() == CCircuitBreaker::CLOSED);
+        assert(breaker.allowRequest());
+        breaker.recordFailure();
+        assert(breaker.state() == CCircuitBreaker::OPEN);
+        assert(!breaker.allowRequest());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        // cooldown 이후 한 요청만 통과
+        assert(breaker.allowRequest());
+        assert(breaker.state() == CCircuitBreaker::HALF_OPEN);
+        assert(!breaker.allowRequest());
+        breaker.recordFailure();
+        assert(breaker.state() == CCircuitBreaker::OPEN);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        // state() 는 probe 를 잡지 않음, 결과 없이 끝난 probe (4xx, 취소) 는 반납
+        assert(breaker.state() == CCircuitBreaker::HALF_OPEN);
+        assert(breaker.allowRequest());
+        assert(!breaker.allowRequest());
+        breaker.releaseProbe();
+        assert(breaker.state() == CCircuitBreaker::HALF_OPEN);
+        assert(breaker.allowRequest());
+        breaker.recordSuccess();
+        assert(breaker.state() == CCircuitBreaker::CLOSED);
+        assert(breaker.allowRequest());
+
+        breaker.recordFailure();
+        breaker.recordFailure();
+        assert(breaker.state() == CCircuitBreaker::OPEN);
+        breaker.reset();
+        assert(breaker.state() == CCircuitBreaker::CLOSED);
+        assert(breaker.allowRequest());
+    }
+
+    void testBackendBreaker() {
+        // 같은 backend 는 route path 가 달라도 같은 breaker, 모든 backend 가 open 이어야 조회하지 않음
+        g_costEstimatePolicy.breakerFailures = 2;
+        g_costEstimatePolicy.breakerCooldown = 10000;
+        auto backends = getRouteBackends("http://a:5000, http://b:5000");
+        assert(backends.size() == 2 && backends[1]->url() == "http://b:5000");
+        backends[1]->recordFailure();
+        backends[1]->recordFailure();
+        assert(getCircuitBreaker("http://b:5000").state() == CCircuitBreaker::OPEN);
+        assert(!isRoutingAvailable("http://b:5000"));
+        assert(isRoutingAvailable("http://a:5000,http://b:5000"));
+        backends[0]->recordFailure();
+        backends[0]->recordFailure();
+        assert(!isRoutingAvailable("http://a:5000,http://b:5000"));
+        backends[0]->recordSuccess();
+        assert(isRoutingAvailable("http://a:5000"));
+
+        // reset API 는 모든 breaker 를 close
+        resetCircuitBreakers();
+        assert(getCircuitBreaker("http://b:5000").state() == CCircuitBreaker::CLOSED);
+    }
+};
+
+int main(int argc, char **argv) {
+    CCostEstimatorTest test;
+    test.testHaversine();
+    test.testEstimateDefault();
+    test.testEstimateCalibrated();
+    test.testCircuitBreaker();
+    test.testBackendBreaker();
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+#include <costParser.h>
+
+class CCostParserTest {
+protected:
+    const size_t baseVehicle = 1;
+    const size_t nodeCount = 4;
+    std::vector<int64_t> distMatrix;
+    std::vector<int64_t> timeMatrix;
+
+    size_t idx(int from, int to) {
+        return (from + baseVehicle) * (nodeCount + 1) + (to + baseVehicle);
+    }
+
+public:
+    void SetUp() {
+        distMatrix.assign((nodeCount + 1) * (nodeCount + 1), -1);
+        timeMatrix.assign((nodeCount + 1) * (nodeCount + 1), -1);
+    }
+
+    void testOsrm() {
+        std::string body =
+            "{\"code\":\"Ok\",\"sources\":[{\"hint\":\"a\\\"b\",\"distance\":1.5,\"location\":[127.1,37.5]}],"
+            "\"durations\":[[0,12.2,null],[3.9,0,7]],"
+            "\"destinations\":[{\"name\":\"\",\"location\":[127.1,37.5]}],"
+            "\"distances\":[ [0, 100.1, null] , [40, 0, 70.0] ]}";
+        std::vector<int> sources = { 0, 2 };
+        std::vector<int> destinations = { 0, 1, 3 };
+
+        parseOsrmTable(body, baseVehicle, nodeCount, sources, destinations, distMatrix, timeMatrix);
+
+        assert(distMatrix[idx(0, 1)] == 101);
+        assert(distMatrix[idx(0, 3)] == INT_MAX);
+        assert(distMatrix[idx(2, 0)] == 40);
+        assert(distMatrix[idx(2, 3)] == 70);
+        assert(timeMatrix[idx(0, 1)] == 13);
+        assert(timeMatrix[idx(0, 3)] == INT_MAX);
+        assert(timeMatrix[idx(2, 0)] == 4);
+        // tile 에 포함되지 않은 cell 은 그대로
+        assert(distMatrix[idx(1, 1)] == -1);
+        assert(timeMatrix[idx(3, 0)] == -1);
+    }
+
+    void testValhalla() {
+        std::string body =
+            "{\"sources_to_targets\":[[{\"distance\":0.0,\"time\":0,\"to_index\":0,\"from_index\":0},"
+            "{\"distance\":1.2345,\"time\":95.2,\"to_index\":1,\"from_index\":0}],"
+            "[{\"distance\":null,\"time\":null,\"to_index\":0,\"from_index\":1},"
+            "{\"to_index\":1,\"distance\":0.5,\"from_index\":1,\"time\":30,\"begin_heading\":10.5}]],"
+            "\"units\":\"kilometers\",\"targets\":[[{\"lon\":127.1,\"lat\":37.5}]],\"warnings\":[{\"code\":1,\"text\":\"x\"}],"
+            "\"id\":null,\"trivial\":true}";
+        std::vector<int> sources = { 1, 3 };
+        std::vector<int> destinations = { 2, 0 };
+
+        parseValhallaMatrix(body, baseVehicle, nodeCount, sources, destinations, distMatrix, timeMatrix);
+
+        assert(distMatrix[idx(1, 2)] == 0);
+        assert(distMatrix[idx(1, 0)] == 1235);
+        assert(timeMatrix[idx(1, 0)] == 96);
+        assert(distMatrix[idx(3, 2)] == INT_MAX);
+        assert(timeMatrix[idx(3, 2)] == INT_MAX);
+        assert(distMatrix[idx(3, 0)] == 500);
+        assert(timeMatrix[idx(3, 0)] == 30);
+        assert(distMatrix[idx(0, 0)] == -1);
+    }
+
+    void testInvalid() {
+        std::vector<int> sources = { 0 };
+        std::vector<int> destinations = { 0 };
+        const char *bodies[] = {
+            "",
+            "[]",
+            "{\"durations\":[[1,2]]}",      // destination 개수보다 많은 column
+            "{\"durations\":[[1]],}",
+            "{\"durations\":[[1]]",
+            "{\"durations\":[[abc]]}",
+        };
+        for (auto body : bodies) {
+            bool thrown = false;
+            try {
+                parseOsrmTable(body, baseVehicle, nodeCount, sources, destinations, distMatrix, timeMatrix);
+            } catch (const std::runtime_error& e) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+
+        bool thrown = false;
+        try {
+            parseValhallaMatrix("{\"sources_to_targets\":[[{\"to_index\":3,\"from_index\":0}]]}",
+                baseVehicle, nodeCount, sources, destinations, distMatrix, timeMatrix);
+        } catch (const std::runtime_error& e) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+};
+
+int main(int argc, char **argv) {
+    CCostParserTest test;
+    test.SetUp();
+    test.testOsrm();
+    test.SetUp();
+    test.testValhalla();
+    test.SetUp();
+    test.testInvalid();
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#include <exactSolver.h>
+#include <modState.h>
+
+class CExactSolverTest {
+public:
+    // node: vehicle 1, 2, waiting (3, 4) 는 vehicle 1 에 배정, new (5, 6)
+    // 직선 위의 위치 (이동 시간 = cost = 거리)
+    size_t nodeCount = 6;
+    size_t vehicleCount = 2;
+    std::vector<int64_t> position = { 0, 0, 100, 10, 50, 20, 40 };
+    std::vector<int64_t> matrix;
+
+    CModState makeState() {
+        matrix.assign((nodeCount + 1) * (nodeCount + 1), 0);
+        for (size_t i = 1; i <= nodeCount; i++) {
+            for (size_t j = 1; j <= nodeCount; j++) {
+                matrix[i * (nodeCount + 1) + j] = std::abs(position[i] - position[j]);
+            }
+        }
+        CModState modState(nodeCount, vehicleCount);
+        modState.vehicleCapacities = { 4, 4 };
+        modState.startDepots = { 1, 2 };
+        modState.demands = { 0, 0, 0, 1, -1, 1, -1 };
+        modState.deliverySibling[3] = 4;
+        modState.pickupSibling[4] = 3;
+        modState.deliverySibling[5] = 6;
+        modState.pickupSibling[6] = 5;
+        modState.fixedAssignment[3] = 1;
+        modState.fixedAssignment[4] = 1;
+        modState.latestArrival.assign(nodeCount + 1, 1000);
+        modState.acceptableArrival.assign(nodeCount + 1, 1000);
+        return modState;
+    }
+
+    std::vector<int> solve(const CModState& modState, int64_t& score, double waitPenalty = 0.0) {
+        SolveInput input{ nodeCount, vehicleCount, matrix, matrix, matrix, modState };
+        auto ap = default_algorithm_parameters();
+        ap.waittime_penalty = waitPenalty;
+        return solveExactRoutes(input, &ap, &score);
+    }
+
+    void testSolve() {
+        int64_t score = 0;
+        auto routes = solve(makeState(), score);
+        assert((routes == std::vector<int>{ 1, 3, 5, 6, 4, 0 }));
+        assert(score == 50);
+
+        // capacity 1 이면 같이 태울 수 없으므로 내린 후 pickup
+        auto modState = makeState();
+        modState.vehicleCapacities[0] = 1;
+        routes = solve(modState, score);
+        assert((routes == std::vector<int>{ 1, 3, 4, 5, 6, 0 }));
+        assert(score == 100);
+
+        // pickup 5 는 80 부터 가능, 먼저 가서 기다리는 시간에 waittime_penalty 를 더하면 내린 후 pickup 이 좋음
+        modState = makeState();
+        modState.earliestArrival[5] = 80;
+        routes = solve(modState, score);
+        assert((routes == std::vector<int>{ 1, 3, 5, 6, 4, 0 }));
+        assert(score == 50);
+        routes = solve(modState, score, 2.0);
+        assert((routes == std::vector<int>{ 1, 3, 4, 5, 6, 0 }));
+        assert(score == 100);
+    }
+
+    void testConstraints() {
+        // new demand 를 vehicle 2 에 고정
+        int64_t score = 0;
+        auto modState = makeState();
+        modState.fixedAssignment[5] = 2;
+        modState.fixedAssignment[6] = 2;
+        auto routes = solve(modState, score);
+        assert((routes == std::vector<int>{ 1, 3, 4, 0, 2, 5, 6, 0 }));
+        assert(score == 150);
+
+        // pickup-delivery 도 onboard delivery 도 아닌 node 가 있으면 LNS 로 풂
+        modState = makeState();
+        modState.demands[3] = -1;
+        modState.deliverySibling[3] = 0;
+        modState.demands[4] = 0;
+        modState.pickupSibling[4] = 0;
+        assert(solve(modState, score).empty());
+
+        // 시간 안에 갈 수 없는 delivery
+        modState = makeState();
+        modState.latestArrival[6] = 15;
+        assert(solve(modState, score).empty());
+        assert(score < 0);
+    }
+};
+
+int main(int argc, char **argv) {
+    CExactSolverTest test;
+    test.testSolve();
+    test.testConstraints();
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#include <insertionEvaluator.h>
+#include <modState.h>
+
+class CInsertionEvaluatorTest {
+public:
+    // node: vehicle 1, 2, waiting (3, 4) 는 vehicle 1 에 배정, new (5, 6)
+    // 직선 위의 위치 (이동 시간 = cost = 거리)
+    size_t nodeCount = 6;
+    size_t vehicleCount = 2;
+    std::vector<int64_t> position = { 0, 0, 100, 10, 50, 20, 40 };
+    std::vector<int64_t> matrix;
+
+    CModState makeState() {
+        matrix.assign((nodeCount + 1) * (nodeCount + 1), 0);
+        for (size_t i = 1; i <= nodeCount; i++) {
+            for (size_t j = 1; j <= nodeCount; j++) {
+                matrix[i * (nodeCount + 1) + j] = std::abs(position[i] - position[j]);
+            }
+        }
+        CModState modState(nodeCount, vehicleCount);
+        modState.vehicleCapacities = { 4, 4 };
+        modState.startDepots = { 1, 2 };
+        modState.demands = { 0, 0, 0, 1, -1, 1, -1 };
+        modState.deliverySibling[3] = 4;
+        modState.pickupSibling[4] = 3;
+        modState.deliverySibling[5] = 6;
+        modState.pickupSibling[6] = 5;
+        modState.fixedAssignment[3] = 1;
+        modState.fixedAssignment[4] = 1;
+        modState.latestArrival.assign(nodeCount + 1, 1000);
+        modState.acceptableArrival.assign(nodeCount + 1, 1000);
+        modState.initialSolution = { 1, 3, 4, 0 };
+        return modState;
+    }
+
+    void testEvaluate() {
+        auto modState = makeState();
+        CInsertionEvaluator evaluator(modState, nodeCount, vehicleCount, matrix, matrix);
+        assert(evaluator.route(1).size() == 2);
+        auto& state = evaluator.routeState(0);
+        assert((state.arrival == std::vector<int64_t>{ 0, 10, 50, 50 }));
+        assert((state.load == std::vector<int64_t>{ 0, 1, 0, 0 }));
+        assert(state.slack[1] == 950 && state.slack[3] == 950);
+
+        auto options = evaluator.evaluate(5, 0, true);
+        assert(options.size() == 2);
+        // 1 -> 3 -> 5 -> 6 -> 4 (경로 위에 있으므로 cost 증가 없음)
+        assert(options[0].vehicle == 0 && options[0].pickupPos == 1 && options[0].deliveryPos == 1);
+        assert(options[0].costDelta == 0);
+        assert(options[0].pickupArrival == 20 && options[0].deliveryArrival == 40);
+        assert(options[1].vehicle == 1 && options[1].costDelta == 100);
+
+        auto all = evaluator.evaluate(5, 0, false);
+        assert(all.size() > options.size());
+        assert(evaluator.evaluate(5, 1, false).size() == 1);
+    }
+
+    void testConstraints() {
+        // 탑승 중인 waiting demand 때문에 3 과 4 사이에는 넣을 수 없음
+        auto modState = makeState();
+        modState.vehicleCapacities[0] = 1;
+        CInsertionEvaluator evaluator(modState, nodeCount, vehicleCount, matrix, matrix);
+        auto options = evaluator.evaluate(5, 1, true);
+        assert(options.size() == 1 && options[0].vehicle == 0);
+        assert(options[0].pickupPos == 2 && options[0].costDelta == 50);
+
+        // 4 를 늦게 만드는 위치는 제외 (3 보다 먼저 pickup 하면 4 의 도착이 70 이후)
+        modState = makeState();
+        modState.latestArrival[4] = 60;
+        CInsertionEvaluator timed(modState, nodeCount, vehicleCount, matrix, matrix);
+        auto timedOptions = timed.evaluate(5, 0, false);
+        for (auto& option : timedOptions) {
+            assert(option.vehicle != 0 || option.pickupPos != 0);
+        }
+        assert(timedOptions[0].vehicle == 0 && timedOptions[0].costDelta == 0);
+
+        // 시간 안에 갈 수 없는 delivery
+        modState = makeState();
+        modState.latestArrival[6] = 15;
+        CInsertionEvaluator late(modState, nodeCount, vehicleCount, matrix, matrix);
+        assert(late.evaluate(5, 0, false).empty());
+    }
+
+    void testEvaluateBatch() {
+        // chunk 여러 개로 나눠서 평가해도 하나씩 평가한 것과 같음
+        auto modState = makeState();
+        CInsertionEvaluator evaluator(modState, nodeCount, vehicleCount, matrix, matrix);
+        std::vector<int> pickups(3 * INSERTION_BATCH_CHUNK + 1, 5);
+        pickups[1] = 3;     // 이미 route 에 있고 vehicle 1 에 고정된 demand
+        auto results = evaluator.evaluateBatch(pickups, 1, false);
+        assert(results.size() == pickups.size());
+        auto expected = evaluator.evaluate(5, 1, false);
+        for (size_t i = 0; i < results.size(); i++) {
+            if (i == 1) {
+                assert(results[i].empty());
+                continue;
+            }
+            assert(results[i].size() == 1);
+            assert(results[i][0].vehicle == expected[0].vehicle && results[i][0].costDelta == expected[0].costDelta);
+        }
+        assert(evaluator.evaluateBatch({}, 1, false).empty());
+    }
+
+    void testAlternativeStates() {
+        auto modState = makeState();
+        CInsertionEvaluator evaluator(modState, nodeCount, vehicleCount, matrix, matrix);
+        auto states = makeAlternativeStates(modState, evaluator, vehicleCount, 5, 3);
+        // vehicle 이 2 대뿐이므로 alternative 는 2 개
+        assert(states.size() == 2);
+        assert(states[0].fixedAssignment[5] == -1 && states[0].fixedAssignment[6] == -1);
+        assert(states[1].fixedAssignment[5] == -(1 * 3 + 2));
+
+        CInsertionEvaluator first(states[0], nodeCount, vehicleCount, matrix, matrix);
+        auto options = first.evaluate(5, 0, true);
+        assert(options.size() == 1 && options[0].vehicle == 1);
+        CInsertionEvaluator second(states[1], nodeCount, vehicleCount, matrix, matrix);
+        assert(second.evaluate(5, 0, true).empty());
+    }
+};
+
+int main(int argc, char **argv) {
+    CInsertionEvaluatorTest test;
+    test.testEvaluate();
+    test.testConstraints();
+    test.testEvaluateBatch();
+    test.testAlternativeStates();
+    return 0;
+}
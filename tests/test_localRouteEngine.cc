@@ -0,0 +1,88 @@
+#include <cassert>
+#include <climits>
+#include <fstream>
+#include <filesystem>
+#include <localRouteEngine.h>
+
+class CLocalRouteEngineTest {
+protected:
+    std::string graphPath;
+    CLocalRouteEngine engine;
+
+public:
+    void SetUp() {
+        // 0 -> 1 -> 2 일방통행 (약 1.1km 간격), 2 -> 0 우회 도로, 3 은 고립된 node
+        graphPath = (std::filesystem::temp_directory_path() / "test_local_graph.txt").string();
+        std::ofstream file(graphPath);
+        file << "4 4\n";
+        file << "37.50 127.00\n";
+        file << "37.51 127.00\n";
+        file << "37.52 127.00\n";
+        file << "37.60 127.10\n";
+        file << "0 1 1200 100\n";
+        file << "1 2 1100 90\n";
+        file << "2 0 5000 400\n";
+        file << "0 2 9000 1000\n";   // 더 느린 직접 도로 (time 기준으로는 선택되지 않음)
+        file.close();
+        engine.load(graphPath);
+    }
+
+    void TearDown() {
+        std::filesystem::remove(graphPath);
+    }
+
+    void testSnap() {
+        double snapDistance;
+        assert(engine.snap(Location(127.0, 37.5001, -1), snapDistance) == 0);
+        assert(snapDistance > 10 && snapDistance < 12);
+        assert(engine.snap(Location(127.0, 37.5199, -1), snapDistance) == 2);
+        // grid 범위 밖이어도 가장 가까운 node
+        assert(engine.snap(Location(128.0, 38.0, -1), snapDistance) == 3);
+    }
+
+    void testSnapHighLatitude() {
+        // 위도 60도에서 경도 방향 cell 은 약 556m 로 위도 방향의 절반
+        // 같은 cell 의 node 0 (약 740m) 보다 경도로 2 cell 떨어진 node 1 (약 645m) 이 가까움
+        std::string path = (std::filesystem::temp_directory_path() / "test_local_graph_lat60.txt").string();
+        std::ofstream file(path);
+        file << "2 1\n";
+        file << "60.0095 10.0099\n";
+        file << "60.005 9.9885\n";
+        file << "0 1 1000 100\n";
+        file.close();
+        CLocalRouteEngine highLatitude;
+        highLatitude.load(path);
+        std::filesystem::remove(path);
+
+        double snapDistance;
+        assert(highLatitude.snap(Location(10.0001, 60.005, -1), snapDistance) == 1);
+        assert(snapDistance > 600 && snapDistance < 700);
+    }
+
+    void testTable() {
+        std::vector<Location> locs = {
+            Location(127.0, 37.50, -1),
+            Location(127.0, 37.51, -1),
+            Location(127.0, 37.52, -1),
+            Location(127.1, 37.60, -1),
+        };
+        std::vector<int64_t> dist, time;
+        engine.table(locs, locs, 3, dist, time);
+        assert(dist.size() == 16);
+        assert(dist[0 * 4 + 0] == 0 && time[0 * 4 + 0] == 0);
+        assert(dist[0 * 4 + 2] == 2300 && time[0 * 4 + 2] == 190);
+        assert(dist[2 * 4 + 1] == 6200 && time[2 * 4 + 1] == 500);
+        assert(dist[1 * 4 + 0] == 6100 && time[1 * 4 + 0] == 490);
+        assert(dist[0 * 4 + 3] == INT_MAX && time[3 * 4 + 0] == INT_MAX);
+    }
+};
+
+int main(int argc, char **argv) {
+    CLocalRouteEngineTest test;
+    test.SetUp();
+    test.testSnap();
+    test.testSnapHighLatitude();
+    test.testTable();
+    test.TearDown();
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <cassert>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <costCache.h>
+
+// vehicle 1, onboard 0, waiting 1, new 1 (ghost depot 제외 nodeCount = 5)
+// matrix index: 0 ghost depot, 1 vehicle, 2 waiting start, 3 waiting dest, 4 new start, 5 new dest
+#define TEST_NODE_COUNT 5
+
+class CNewDemandCacheTest {
+protected:
+    CCostCache cache;
+    ModRequest modRequest;
+
+    static bool contains(const std::vector<int>& changed, int idx) {
+        return std::find(changed.begin(), changed.end(), idx) != changed.end();
+    }
+
+    static std::vector<int64_t> makeMatrix(int64_t offset) {
+        std::vector<int64_t> matrix((TEST_NODE_COUNT + 1) * (TEST_NODE_COUNT + 1));
+        for (size_t i = 0; i < matrix.size(); i++) {
+            matrix[i] = offset + (int64_t) i;
+        }
+        return matrix;
+    }
+
+    // 조회한 것처럼 matrix 를 채워서 cache 에 반영
+    std::vector<int> query(int64_t offset, std::vector<int64_t>& distMatrix, std::vector<int64_t>& timeMatrix) {
+        std::vector<int> changed;
+        cache.checkChangedItem(modRequest, changed);
+        distMatrix = makeMatrix(offset);
+        timeMatrix = makeMatrix(offset);
+        cache.updateCacheAndCost(modRequest, TEST_NODE_COUNT, changed, distMatrix, timeMatrix);
+        return changed;
+    }
+
+public:
+    void SetUp() {
+        modRequest.vehicleLocs = { VehicleLocation("v1", 4) };
+        modRequest.vehicleLocs[0].location = Location(127.000, 37.500, -1);
+        modRequest.onboardWaitingDemands = { OnboardWaitingDemand("w1", "v1", 1) };
+        modRequest.onboardWaitingDemands[0].startLoc = Location(127.010, 37.510, -1);
+        modRequest.onboardWaitingDemands[0].destinationLoc = Location(127.020, 37.520, -1);
+        modRequest.newDemands = { NewDemand("n1", 1) };
+        modRequest.newDemands[0].startLoc = Location(127.030, 37.530, -1);
+        modRequest.newDemands[0].destinationLoc = Location(127.040, 37.540, -1);
+        modRequest.newDemands[0].etaToStart = {{ 0, 600 }};
+    }
+
+    void testHitWithinMaxAge() {
+        // 처음에는 waiting (0), new (1) 모두 조회
+        std::vector<int64_t> distMatrix, timeMatrix;
+        auto changed = query(1000, distMatrix, timeMatrix);
+        assert(contains(changed, 0) && contains(changed, 1));
+
+        // 같은 new demand 를 다시 quote 하면 조회하지 않고 이전 값을 사용
+        changed = query(5000, distMatrix, timeMatrix);
+        assert(!contains(changed, 1));
+        size_t waitingStart = 2, newStart = 4, newDest = 5;
+        assert(distMatrix[newStart * (TEST_NODE_COUNT + 1) + newDest] == 1000 + newStart * (TEST_NODE_COUNT + 1) + newDest);
+        assert(timeMatrix[waitingStart * (TEST_NODE_COUNT + 1) + newStart] == 1000 + waitingStart * (TEST_NODE_COUNT + 1) + newStart);
+        assert(timeMatrix[newDest * (TEST_NODE_COUNT + 1) + waitingStart] == 1000 + newDest * (TEST_NODE_COUNT + 1) + waitingStart);
+    }
+
+    void testMissOnEtaToStart() {
+        // eta_to_start 의 latest 가 바뀌면 start_loc 으로 가는 arc 의 INT_MAX 여부가 달라지므로 다시 조회
+        std::vector<int64_t> distMatrix, timeMatrix;
+        modRequest.newDemands[0].etaToStart = {{ 0, 300 }};
+        auto changed = query(2000, distMatrix, timeMatrix);
+        assert(contains(changed, 1));
+
+        changed = query(3000, distMatrix, timeMatrix);
+        assert(!contains(changed, 1));
+        modRequest.newDemands[0].etaToStart = {{ 0, 600 }};
+    }
+
+    void testMissAfterMaxAge() {
+        std::vector<int64_t> distMatrix, timeMatrix;
+        cache.setNewDemandMaxAge(std::chrono::seconds(1));
+        auto changed = query(1000, distMatrix, timeMatrix);
+        assert(contains(changed, 1));
+        changed = query(2000, distMatrix, timeMatrix);
+        assert(!contains(changed, 1));
+
+        // 유지 시간이 지나면 다시 조회
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        changed = query(3000, distMatrix, timeMatrix);
+        assert(contains(changed, 1));
+        size_t newStart = 4, newDest = 5;
+        assert(distMatrix[newStart * (TEST_NODE_COUNT + 1) + newDest] == 3000 + newStart * (TEST_NODE_COUNT + 1) + newDest);
+
+        // 0 이면 캐싱하지 않음
+        cache.setNewDemandMaxAge(std::chrono::seconds(0));
+        query(1000, distMatrix, timeMatrix);
+        changed = query(2000, distMatrix, timeMatrix);
+        assert(contains(changed, 1));
+    }
+};
+
+int main(int argc, char **argv) {
+    CNewDemandCacheTest test;
+    test.SetUp();
+    test.testHitWithinMaxAge();
+    test.testMissOnEtaToStart();
+    test.testMissAfterMaxAge();
+    return 0;
+}
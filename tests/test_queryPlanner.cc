@@ -0,0 +1,595 @@
+#include <cassert>
+#include <climits>
+#include <set>
+#include <algorithm>
+#include <lnsModRoute.h>
+#include <queryPlanner.h>
+#include <costCache.h>
+#include <snapCache.h>
+#include <observedArcs.h>
+
+class CQueryPlannerTest {
+public:
+    void testGroupOverlapping() {
+        // new demand 10 개는 모든 vehicle 이 공통, vehicle 마다 assigned stop 1 개씩 추가
+        std::vector<int> common;
+        for (int i = 100; i < 110; i++) {
+            common.push_back(i);
+        }
+        std::vector<VehicleRow> rows;
+        for (int v = 0; v < 20; v++) {
+            std::vector<int> destinations(common);
+            destinations.push_back(200 + v);
+            rows.push_back({ v, destinations });
+        }
+
+        auto groups = groupVehicleRows(rows, 100);
+        assert(groups.size() < rows.size() / 4);
+
+        // 모든 vehicle 의 모든 destination 이 어떤 group 에 포함되어야 함
+        std::set<int> seenSources;
+        size_t cells = 0;
+        size_t needed = 0;
+        for (auto& group : groups) {
+            assert(std::is_sorted(group.destinations.begin(), group.destinations.end()));
+            for (int source : group.sources) {
+                seenSources.insert(source);
+                for (int d : rows[source].destinations) {
+                    assert(std::binary_search(group.destinations.begin(), group.destinations.end(), d));
+                }
+            }
+            cells += group.sources.size() * group.destinations.size();
+            needed += group.neededCells;
+            assert(group.sources.size() * group.destinations.size() <= group.neededCells * (1.0 + VEHICLE_ROW_MAX_EXTRA_RATIO));
+        }
+        assert(seenSources.size() == rows.size());
+        assert(needed == 20 * 11);
+    }
+
+    void testDisjointNotGrouped() {
+        std::vector<VehicleRow> rows = {
+            { 0, { 1, 2, 3, 4 } },
+            { 1, { 5, 6, 7, 8 } },
+            { 2, { 1, 2, 3, 4 } },
+        };
+        auto groups = groupVehicleRows(rows, 100, 0.5);
+        assert(groups.size() == 2);
+        assert(groups[0].sources.size() == 2 && groups[0].destinations.size() == 4);
+        assert(groups[1].sources.size() == 1);
+    }
+
+    void testMaxSources() {
+        std::vector<VehicleRow> rows;
+        for (int v = 0; v < 10; v++) {
+            rows.push_back({ v, { 1, 2, 3 } });
+        }
+        auto groups = groupVehicleRows(rows, 4);
+        assert(groups.size() == 3);
+        for (auto& group : groups) {
+            assert(group.sources.size() <= 4);
+        }
+    }
+
+    void testAssignedArcs() {
+        // node: vehicle 0, onboard 1, waiting (2, 3)
+        ModRequest modRequest;
+        modRequest.vehicleLocs = { VehicleLocation("v1", 4) };
+        modRequest.onboardDemands = { OnboardDemand("o1", "v1", 1) };
+        modRequest.onboardWaitingDemands = { OnboardWaitingDemand("w1", "v1", 1) };
+        VehicleAssigned assigned("v1");
+        assigned.routeOrder = { { "w1", 1 }, { "o1", -1 }, { "w1", -1 } };
+        assigned.routeTimes = { 60, 120, -1 };
+        assigned.routeDistances = { 500, 1000, 700 };
+        modRequest.assigned = { assigned };
+
+        auto arcs = collectAssignedArcs(modRequest);
+        assert(arcs.size() == 3);
+        assert(arcs[0].from == 0 && arcs[0].to == 2);
+        assert(arcs[1].from == 2 && arcs[1].to == 1);
+        assert(arcs[2].from == 1 && arcs[2].to == 3);
+
+        size_t nodeCount = 4;
+        auto known = knownArcKeys(arcs, nodeCount);
+        assert(known.size() == 2);
+        assert(known.count(arcKey(0, 2, nodeCount)) == 1);
+        assert(known.count(arcKey(1, 3, nodeCount)) == 0);
+
+        std::vector<int64_t> dist((nodeCount + 1) * (nodeCount + 1), 0);
+        std::vector<int64_t> time((nodeCount + 1) * (nodeCount + 1), 0);
+        applyAssignedArcs(arcs, 1, nodeCount, dist, time);
+        assert(time[1 * 5 + 3] == 60 && dist[1 * 5 + 3] == 500);
+        assert(time[2 * 5 + 4] == 0 && dist[2 * 5 + 4] == 700);
+
+        // route_times 가 없어도 route 를 따라가는 arc 는 모두 찾음 (값은 -1)
+        modRequest.assigned[0].routeTimes.clear();
+        modRequest.assigned[0].routeDistances.clear();
+        assert(collectAssignedArcs(modRequest).empty());
+        auto routeArcs = collectRouteArcs(modRequest);
+        assert(routeArcs.size() == 3);
+        assert(routeArcs[0].from == 0 && routeArcs[0].to == 2 && routeArcs[0].time < 0);
+        assert(routeArcs[2].from == 1 && routeArcs[2].to == 3 && routeArcs[2].vehicle == 0);
+
+        // route 평가는 route 의 다음 stop 으로 가는 arc 만 조회하고 나머지는 INT_MAX
+        modRequest.routeArcsOnly = true;
+        CArcPruner pruner(modRequest, { 0, 1, 2, 3 }, 0);
+        assert(!pruner.isPruned(0, 2) && !pruner.isPruned(2, 1) && !pruner.isPruned(1, 3));
+        assert(pruner.isPruned(0, 1) && pruner.isPruned(2, 3) && pruner.isPruned(3, 2));
+        std::vector<int> destinations = { 1, 2, 3 };
+        assert(pruner.filter(0, destinations) == 2);
+        assert((destinations == std::vector<int>{ 2 }));
+        std::fill(time.begin(), time.end(), 1);
+        assert(pruner.fillInfeasible(1, nodeCount, dist, time) == 4 * 3 - 3);
+        assert(time[1 * 5 + 3] == 1 && time[1 * 5 + 2] == INT_MAX && time[4 * 5 + 3] == INT_MAX);
+        assert(time[4 * 5 + 0] == 1);   // ghost depot 으로 가는 arc 는 그대로
+    }
+
+    void testFixedAssignment() {
+        // node: vehicle 0(A), 1(B), onboard 2(A), waiting (3, 4)(B), new (5, 6)
+        ModRequest modRequest;
+        modRequest.vehicleLocs = { VehicleLocation("A", 4), VehicleLocation("B", 4) };
+        modRequest.onboardDemands = { OnboardDemand("o1", "A", 1) };
+        modRequest.onboardWaitingDemands = { OnboardWaitingDemand("w1", "B", 1) };
+        modRequest.newDemands = { NewDemand("n1", 1) };
+        size_t nodeCount = 7;
+
+        auto nodeVehicles = fixedNodeVehicles(modRequest, nodeCount);
+        assert((nodeVehicles == std::vector<int>{ 0, 1, 0, 1, 1, -1, -1 }));
+        assert(isArcReachable(nodeVehicles, 2, 5) && isArcReachable(nodeVehicles, 3, 4));
+        assert(!isArcReachable(nodeVehicles, 2, 3) && !isArcReachable(nodeVehicles, 0, 4));
+
+        // 3 은 2 와 같은 station 이라서 2 가 대표 node
+        std::vector<int> representative = { 0, 1, 2, 2, 4, 5, 6 };
+        auto merged = mergeNodeVehicles(nodeVehicles, representative);
+        assert(merged[2] == -1 && merged[4] == 1);
+
+        // onboard 2(A) -> waiting 4(B) 는 조회하지 않음
+        auto groups = planReachableTiles({ 2, 4, 5 }, { 2, 4, 5 }, nodeVehicles, 100);
+        std::set<std::pair<int, int>> cells;
+        size_t needed = 0;
+        for (auto& group : groups) {
+            needed += group.neededCells;
+            for (int s : group.sources) {
+                for (int d : group.destinations) {
+                    cells.insert({ s, d });
+                }
+            }
+        }
+        assert(cells.count({ 2, 5 }) && cells.count({ 5, 4 }) && cells.count({ 4, 4 }));
+        assert(needed == 7);
+
+        std::vector<int64_t> dist((nodeCount + 1) * (nodeCount + 1), 1);
+        std::vector<int64_t> time((nodeCount + 1) * (nodeCount + 1), 1);
+        fillUnreachableArcs(nodeVehicles, 1, nodeCount, dist, time);
+        auto cell = [&](int from, int to) { return time[(from + 1) * (nodeCount + 1) + to + 1]; };
+        assert(cell(2, 3) == INT_MAX && cell(3, 2) == INT_MAX && cell(0, 3) == INT_MAX && cell(1, 2) == INT_MAX);
+        assert(cell(2, 5) == 1 && cell(5, 3) == 1 && cell(3, 4) == 1 && cell(0, 2) == 1 && cell(0, 1) == 1);
+    }
+
+    void testCandidateVehicles() {
+        // new demand 위치 (127.0, 37.5) 에서 vehicle i 는 약 i km 북쪽
+        ModRequest modRequest;
+        for (int i = 0; i < 30; i++) {
+            VehicleLocation vehicle("v" + std::to_string(i), 4);
+            vehicle.location = Location(127.0, 37.5 + i * 0.009, -1);
+            modRequest.vehicleLocs.push_back(vehicle);
+        }
+        modRequest.vehicleLocs[1].operationTime = { 0, 100 };   // 운행 종료
+        modRequest.onboardDemands = { OnboardDemand("o1", "v2", 4) };  // 자리 없음
+        NewDemand newDemand("n1", 1);
+        newDemand.startLoc = Location(127.0, 37.5, -1);
+        newDemand.etaToStart = { 600, 1200 };
+        modRequest.newDemands = { newDemand };
+
+        CCandidateVehicleIndex index(modRequest);
+        assert((index.nearest(newDemand, 3) == std::vector<int>{ 0, 3, 4 }));
+        assert(index.nearest(newDemand, 0).size() == 28);
+
+        g_queryPlanPolicy.candidateVehicles = 5;
+        auto candidates = findCandidateVehicles(modRequest);
+        assert((candidates[0] == std::vector<int>{ 0, 3, 4, 5, 6 }));
+
+        size_t nodeCount = 30 + 1 + 2;
+        std::vector<int64_t> dist((nodeCount + 1) * (nodeCount + 1), 1);
+        std::vector<int64_t> time((nodeCount + 1) * (nodeCount + 1), 1);
+        fillNonCandidateArcs(modRequest, candidates, 1, nodeCount, dist, time);
+        size_t startNode = 31 + 1;
+        assert(time[(0 + 1) * (nodeCount + 1) + startNode] == 1);
+        assert(time[(1 + 1) * (nodeCount + 1) + startNode] == INT_MAX);
+        assert(time[(7 + 1) * (nodeCount + 1) + startNode] == INT_MAX);
+        assert(time[(7 + 1) * (nodeCount + 1) + startNode + 1] == 1);
+    }
+
+    void testArcPruner() {
+        // new demand 위치 (127.0, 37.5) 에서 vehicle 0, 1, 2, 3 은 약 0, 10, 50, 10 km 북쪽
+        ModRequest modRequest;
+        double offsets[] = { 0.0, 0.09, 0.45, 0.09 };
+        for (int i = 0; i < 4; i++) {
+            VehicleLocation vehicle("v" + std::to_string(i), 4);
+            vehicle.location = Location(127.0, 37.5 + offsets[i], -1);
+            modRequest.vehicleLocs.push_back(vehicle);
+        }
+        modRequest.vehicleLocs[3].operationTime = { 500, 0 };  // 500초 후부터 운행
+        NewDemand newDemand("n1", 1);
+        newDemand.startLoc = Location(127.0, 37.5, -1);
+        newDemand.destinationLoc = Location(127.0, 38.5, -1);
+        newDemand.etaToStart = { 0, 600 };  // 30 m/s 로 18 km 까지
+        modRequest.newDemands = { newDemand };
+
+        size_t nodeCount = 4 + 2;
+        std::vector<int> representative = { 0, 1, 2, 3, 4, 5 };
+        CArcPruner pruner(modRequest, representative, 30.0);
+        assert(!pruner.isPruned(0, 4));
+        assert(!pruner.isPruned(1, 4));
+        assert(pruner.isPruned(2, 4));
+        assert(pruner.isPruned(3, 4));
+        assert(!pruner.isPruned(2, 5));     // destination_loc 은 latestArrival 을 모름
+        assert(!pruner.isPruned(4, 2));
+
+        std::vector<int> destinations = { 4, 5 };
+        assert(pruner.filter(2, destinations) == 1);
+        assert((destinations == std::vector<int>{ 5 }));
+
+        std::vector<int64_t> dist((nodeCount + 1) * (nodeCount + 1), 1);
+        std::vector<int64_t> time((nodeCount + 1) * (nodeCount + 1), 1);
+        assert(pruner.fillInfeasible(1, nodeCount, dist, time) == 3);   // vehicle 2, 3 과 destination_loc (110 km)
+        assert(time[(2 + 1) * (nodeCount + 1) + 4 + 1] == INT_MAX);
+        assert(time[(1 + 1) * (nodeCount + 1) + 4 + 1] == 1);
+        assert(dist[(5 + 1) * (nodeCount + 1) + 4 + 1] == INT_MAX);
+
+        // station 으로 다른 node 를 대표하는 node 는 조회에서 제외하지 않음
+        CArcPruner shared(modRequest, { 0, 1, 2, 3, 4, 4 }, 30.0);
+        assert(!shared.isPruned(2, 4));
+
+        CArcPruner disabled(modRequest, representative, 0);
+        assert(!disabled.isPruned(2, 4));
+
+        // 독립된 후보 trip 은 다른 new demand 사이의 arc 를 조회하지 않고 INT_MAX 로 채움
+        NewDemand other("n2", 1);
+        other.startLoc = Location(127.001, 37.5, -1);
+        other.destinationLoc = Location(127.002, 37.5, -1);
+        modRequest.newDemands.push_back(other);
+        modRequest.independentNewDemands = true;
+        nodeCount = 4 + 4;
+        CArcPruner independent(modRequest, { 0, 1, 2, 3, 4, 5, 6, 7 }, 0);
+        assert(!independent.isPruned(4, 5) && !independent.isPruned(5, 4));
+        assert(!independent.isPruned(0, 6) && !independent.isPruned(7, 1));
+        assert(independent.isPruned(4, 6) && independent.isPruned(5, 7) && independent.isPruned(7, 4));
+        destinations = { 0, 4, 5, 6, 7 };
+        assert(independent.filter(6, destinations) == 2);
+        assert((destinations == std::vector<int>{ 0, 6, 7 }));
+        dist.assign((nodeCount + 1) * (nodeCount + 1), 1);
+        time.assign((nodeCount + 1) * (nodeCount + 1), 1);
+        assert(independent.fillInfeasible(1, nodeCount, dist, time) == 8);
+        assert(time[(4 + 1) * (nodeCount + 1) + 6 + 1] == INT_MAX);
+        assert(time[(4 + 1) * (nodeCount + 1) + 5 + 1] == 1);
+        // station 으로 다른 후보를 같이 대표하는 node 는 조회하고, 조회 후 node 별로 채움
+        CArcPruner sharedIndependent(modRequest, { 0, 1, 2, 3, 4, 5, 4, 7 }, 0);
+        assert(!sharedIndependent.isPruned(4, 7));
+        assert(sharedIndependent.isPruned(5, 7));
+    }
+
+    void testCoordinateDedup() {
+        // 5m grid 에서 1m 떨어진 위치는 같은 가상 station, 50m 떨어진 위치는 다른 station
+        Location depot(127.00001, 37.50001, -1);
+        Location near(127.00001, 37.500019, -1);
+        Location far(127.0005, 37.50001, -1);
+        assert(coordinateStationId(depot, 5.0) == coordinateStationId(near, 5.0));
+        assert(coordinateStationId(depot, 5.0) != coordinateStationId(far, 5.0));
+
+        ModRequest modRequest;
+        NewDemand newDemand("n1", 1);
+        newDemand.startLoc = depot;
+        newDemand.destinationLoc = Location(127.1, 37.6, -1, "S1");
+        modRequest.newDemands = { newDemand };
+        assert(assignCoordinateStations(modRequest, 5.0) == 1);
+        assert(modRequest.newDemands[0].startLoc.station_id == coordinateStationId(depot, 5.0));
+        assert(modRequest.newDemands[0].destinationLoc.station_id == "S1");
+
+        // vehicle 0, 1 은 같은 차고지, vehicle 2 는 다른 위치
+        std::vector<std::pair<std::string, int>> keys = { { "A", -1 }, { "A", -1 }, { "B", -1 } };
+        std::vector<RowCopy> copies;
+        auto rows = mergeColocatedRows({ { 1, { 5, 6 } }, { 0, { 3, 5 } }, { 2, { 3 } } }, keys, copies);
+        assert(rows.size() == 2);
+        assert(rows[0].source == 0 && (rows[0].destinations == std::vector<int>{ 3, 5, 6 }));
+        assert(rows[1].source == 2);
+        assert(copies.size() == 1 && copies[0].from == 0 && copies[0].to == 1);
+
+        size_t nodeCount = 7;
+        std::vector<int64_t> dist((nodeCount + 1) * (nodeCount + 1), 0);
+        std::vector<int64_t> time((nodeCount + 1) * (nodeCount + 1), 0);
+        time[(0 + 1) * (nodeCount + 1) + 6 + 1] = 42;
+        time[(0 + 1) * (nodeCount + 1) + 3 + 1] = 7;
+        applyRowCopies(copies, 1, nodeCount, dist, time);
+        assert(time[(1 + 1) * (nodeCount + 1) + 6 + 1] == 42);
+        assert(time[(1 + 1) * (nodeCount + 1) + 3 + 1] == 0);    // vehicle 1 에 필요 없는 cell 은 복사하지 않음
+    }
+
+    void testVehicleRowCache() {
+        ModRequest modRequest;
+        modRequest.vehicleLocs = { VehicleLocation("v1", 4) };
+        std::vector<Location> locs = {
+            Location(127.0, 37.5, 0),       // vehicle (북쪽 heading)
+            Location(127.01, 37.52, -1),
+            Location(127.02, 37.53, -1),
+        };
+        size_t nodeCount = 3;
+        std::vector<int64_t> dist((nodeCount + 1) * (nodeCount + 1), 0);
+        std::vector<int64_t> time((nodeCount + 1) * (nodeCount + 1), 0);
+        dist[(0 + 1) * (nodeCount + 1) + 1 + 1] = 3000;
+        time[(0 + 1) * (nodeCount + 1) + 1 + 1] = 300;
+
+        CVehicleRowCache cache;
+        std::vector<VehicleRow> rows = { { 0, { 1 } } };
+        std::vector<RowFill> fills;
+        auto reused = cache.reuse(modRequest, locs, rows, fills);
+        assert(!reused[0] && fills.empty());
+        cache.store(modRequest, locs, rows, reused, 1, nodeCount, dist, time);
+
+        // 약 19m 이동: 이동 거리만큼 보정해서 재사용, 보관하지 않은 destination 은 조회
+        locs[0] = Location(127.0, 37.50017, 0);
+        rows = { { 0, { 1, 2 } } };
+        reused = cache.reuse(modRequest, locs, rows, fills);
+        assert(reused[0]);
+        assert((rows[0].destinations == std::vector<int>{ 2 }));
+        assert(fills.size() == 1 && fills[0].destination == 1);
+        assert(fills[0].dist == 3019 && fills[0].time == 304);
+
+        // heading 방향으로 약 100m: 그대로 재사용
+        locs[0] = Location(127.0, 37.5009, 10);
+        rows = { { 0, { 1 } } };
+        fills.clear();
+        cache.reuse(modRequest, locs, rows, fills);
+        assert(fills.size() == 1 && fills[0].dist == 3000 && fills[0].time == 300);
+
+        // 새로 조회한 destination 2 는 재사용한 row 에 추가됨
+        locs[0] = Location(127.0, 37.50017, 0);
+        rows = { { 0, { 2 } } };
+        dist[(0 + 1) * (nodeCount + 1) + 2 + 1] = 4000;
+        time[(0 + 1) * (nodeCount + 1) + 2 + 1] = 400;
+        cache.store(modRequest, locs, rows, { 1 }, 1, nodeCount, dist, time);
+        rows = { { 0, { 1, 2 } } };
+        fills.clear();
+        cache.reuse(modRequest, locs, rows, fills);
+        assert(fills.size() == 2 && rows[0].destinations.empty());
+
+        // heading 방향으로 약 100m 지나친 destination (heading 뒤쪽, 또는 움직인 거리보다 가까움) 은 다시 조회
+        locs[0] = Location(127.0, 37.5009, 10);
+        locs[2] = Location(127.0, 37.5005, -1);
+        rows = { { 0, { 1, 2 } } };
+        dist[(0 + 1) * (nodeCount + 1) + 2 + 1] = 60;
+        cache.store(modRequest, locs, { { 0, { 2 } } }, { 1 }, 1, nodeCount, dist, time);
+        fills.clear();
+        cache.reuse(modRequest, locs, rows, fills);
+        assert(fills.size() == 1 && fills[0].destination == 1);
+        assert((rows[0].destinations == std::vector<int>{ 2 }));
+        locs[2] = Location(127.02, 37.53, -1);
+
+        // 반대 방향으로 약 100m: 다시 조회
+        locs[0] = Location(127.0, 37.4991, 0);
+        rows = { { 0, { 1 } } };
+        fills.clear();
+        reused = cache.reuse(modRequest, locs, rows, fills);
+        assert(!reused[0] && fills.empty() && rows[0].destinations.size() == 1);
+
+        g_queryPlanPolicy.rowReuseRadius = 0;
+        locs[0] = Location(127.0, 37.5, 0);
+        fills.clear();
+        cache.reuse(modRequest, locs, rows, fills);
+        assert(fills.empty());
+        g_queryPlanPolicy.rowReuseRadius = 30.0;
+    }
+
+    void testVehicleRowPrefetch() {
+        ModRequest modRequest;
+        modRequest.vehicleLocs = { VehicleLocation("v1", 4), VehicleLocation("v2", 4) };
+        std::vector<Location> locs = {
+            Location(127.0, 37.5, 0),
+            Location(127.1, 37.6, 0),
+            Location(127.01, 37.52, -1),
+            Location(127.02, 37.53, -1),
+        };
+        size_t nodeCount = 4;
+        std::vector<int64_t> dist((nodeCount + 1) * (nodeCount + 1), 1000);
+        std::vector<int64_t> time((nodeCount + 1) * (nodeCount + 1), 100);
+
+        CVehicleRowCache cache;
+        std::vector<VehicleRow> rows = { { 0, { 2, 3 } }, { 1, { 3 } } };
+        cache.store(modRequest, locs, rows, { 0, 0 }, 1, nodeCount, dist, time);
+
+        // v1 은 약 1km 이동 (재사용 불가), v2 는 그대로, v3 는 조회한 적 없음
+        ModRequest telemetry;
+        telemetry.vehicleLocs = { VehicleLocation("v1", 0), VehicleLocation("v2", 0), VehicleLocation("v3", 0) };
+        telemetry.vehicleLocs[0].location = Location(127.0, 37.509, 90);
+        telemetry.vehicleLocs[1].location = locs[1];
+        telemetry.vehicleLocs[2].location = locs[0];
+        auto prefetch = cache.prepare(telemetry);
+        assert((prefetch.supplyIdxs == std::vector<std::string>{ "v1" }));
+        assert(prefetch.locs.size() == 3 && prefetch.rows.size() == 1);
+        assert((prefetch.rows[0].destinations == std::vector<int>{ 1, 2 }));
+
+        // 미리 조회한 row 는 새 위치에서 그대로 재사용
+        size_t prefetchCount = prefetch.locs.size();
+        std::vector<int64_t> prefetchDist((prefetchCount + 1) * (prefetchCount + 1), INT_MAX);
+        std::vector<int64_t> prefetchTime((prefetchCount + 1) * (prefetchCount + 1), INT_MAX);
+        prefetchDist[1 * (prefetchCount + 1) + 2] = 2000;
+        prefetchTime[1 * (prefetchCount + 1) + 2] = 200;
+        cache.storePrefetched(prefetch, 1, prefetchCount, prefetchDist, prefetchTime);
+
+        locs[0] = telemetry.vehicleLocs[0].location;
+        rows = { { 0, { 2, 3 } } };
+        std::vector<RowFill> fills;
+        auto reused = cache.reuse(modRequest, locs, rows, fills);
+        assert(reused[0]);
+        assert(fills.size() == 1 && fills[0].destination == 2 && fills[0].dist == 2000 && fills[0].time == 200);
+        assert((rows[0].destinations == std::vector<int>{ 3 }));
+
+        // 다시 조회할 필요 없음
+        assert(cache.prepare(telemetry).rows.empty());
+
+        g_queryPlanPolicy.prefetchIdle = 0;
+        telemetry.vehicleLocs[0].location = Location(127.0, 37.52, 90);
+        assert(cache.prepare(telemetry).rows.empty());
+        g_queryPlanPolicy.prefetchIdle = 600;
+    }
+
+    void testSnapCache() {
+        // 같은 도로 위로 snap 되는 두 GPS 좌표 (약 8m 차이)
+        Location first(127.0, 37.5, -1);
+        Location second(127.00009, 37.5, -1);
+        assert(makeLocationKey(first) != makeLocationKey(second));
+        auto targets = g_snapCache.missing({ first, second, first });
+        assert(targets.size() == 2);
+        g_snapCache.store(first, "v100:right", 37.50001, 127.00001);
+        g_snapCache.store(second, "v100:right", 37.50001, 127.00002);
+        assert(g_snapCache.missing({ first, second }).empty());
+        assert(makeLocationKey(first) == makeLocationKey(second));
+        assert(makeLocationKey(first) != makeLocationKey(Location(127.0, 37.5, 90)));
+
+        ModRequest modRequest;
+        modRequest.onboardDemands.resize(2);
+        modRequest.onboardDemands[0].destinationLoc = first;
+        modRequest.onboardDemands[1].destinationLoc = second;
+        assignCoordinateStations(modRequest, 5.0);
+        assert(modRequest.onboardDemands[0].destinationLoc.station_id == modRequest.onboardDemands[1].destinationLoc.station_id);
+
+        // snap 하지 못한 좌표는 좌표 key, 일정 시간 동안 다시 조회하지 않음
+        Location far(127.1, 37.6, -1);
+        g_snapCache.store(far, "", 0, 0);
+        assert(g_snapCache.lookup(far).empty());
+        assert(g_snapCache.missing({ far }).empty());
+
+        // snapCell 안에서 흔들린 좌표는 cell 경계를 넘어도 조회한 결과를 사용 (약 3m 이동)
+        Location drift(127.00002, 37.50002, -1);
+        assert(g_snapCache.missing({ drift }).empty());
+        assert(makeLocationKey(drift) == makeLocationKey(first));
+        Location moved(127.0, 37.50008, -1);
+        assert(g_snapCache.missing({ moved }).size() == 1);
+
+        g_queryPlanPolicy.snapCell = 0;
+        assert(makeLocationKey(first) != makeLocationKey(second));
+        g_queryPlanPolicy.snapCell = 5.0;
+        g_snapCache.clear();
+
+        // 가득 차면 가장 오래 전에 조회한 좌표 하나만 지움
+        for (size_t i = 0; i < SNAP_CACHE_MAX_ENTRIES; i++) {
+            g_snapCache.store(Location(126.0 + i * 0.0001, 37.0, -1), "v" + std::to_string(i), 37.0, 126.0 + i * 0.0001);
+        }
+        g_snapCache.store(Location(126.0, 37.0, -1), "v0", 37.0, 126.0);
+        g_snapCache.store(Location(127.0, 38.0, -1), "new", 38.0, 127.0);
+        assert(!g_snapCache.lookup(Location(126.0, 37.0, -1)).empty());
+        assert(g_snapCache.lookup(Location(126.0001, 37.0, -1)).empty());
+        assert(!g_snapCache.lookup(Location(126.0002, 37.0, -1)).empty());
+        assert(!g_snapCache.lookup(Location(127.0, 38.0, -1)).empty());
+        g_snapCache.clear();
+    }
+
+    void testObservedArcs() {
+        // node: vehicle 0, onboard 1 (C), waiting (2 = A, 3 = B)
+        ModRequest modRequest;
+        modRequest.vehicleLocs = { VehicleLocation("v1", 4) };
+        modRequest.onboardDemands = { OnboardDemand("o1", "v1", 1) };
+        modRequest.onboardDemands[0].destinationLoc = Location(127.02, 37.50, -1);
+        modRequest.onboardWaitingDemands = { OnboardWaitingDemand("w1", "v1", 1) };
+        modRequest.onboardWaitingDemands[0].startLoc = Location(127.00, 37.50, -1);
+        modRequest.onboardWaitingDemands[0].destinationLoc = Location(127.03, 37.51, -1);
+        modRequest.dateTime = "2024-05-01T08:30";
+        VehicleAssigned assigned("v1");
+        assigned.routeOrder = { { "w1", 1 }, { "o1", -1 }, { "w1", -1 } };
+        assigned.routeTimes = { 60, 300, 200 };
+        assigned.routeDistances = { 500, 2000, 1500 };
+        modRequest.assigned = { assigned };
+        assert(observedArcBucket(modRequest.dateTime) == 8 / OBSERVED_ARC_BUCKET_HOURS);
+
+        size_t nodeCount = 4;
+        std::vector<int64_t> dist((nodeCount + 1) * (nodeCount + 1), 1);
+        std::vector<int64_t> time((nodeCount + 1) * (nodeCount + 1), 1);
+        auto arcs = collectAssignedArcs(modRequest);
+        // 같은 assigned 를 다시 보낸 요청은 같은 관측으로 봄
+        recordObservedArcs(modRequest, arcs);
+        recordObservedArcs(modRequest, arcs);
+        assert(g_observedArcs.stats().pairs == 2);   // vehicle 에서 출발하는 arc 는 보관하지 않음
+        assert(g_observedArcs.stats().recorded == 2);
+        assert(applyObservedArcs(modRequest, 1, nodeCount, dist, time) == 0);
+
+        arcs[1].time = 400;
+        recordObservedArcs(modRequest, arcs);
+        arcs[1].time = 300;
+        recordObservedArcs(modRequest, arcs);
+        assert(applyObservedArcs(modRequest, 1, nodeCount, dist, time) == 1);
+        // A(2) -> C(1): 300, 300 + 0.2 * 100, 320 + 0.2 * (300 - 320)
+        assert(dist[3 * 5 + 2] == 2000 && time[3 * 5 + 2] == 316);
+        assert(time[2 * 5 + 4] == 1);
+
+        // 다른 시간대는 전체 시간대 값, 사용할 수 없는 arc 는 그대로 둠
+        modRequest.dateTime = "2024-05-01T20:00";
+        time[3 * 5 + 2] = INT_MAX;
+        assert(applyObservedArcs(modRequest, 1, nodeCount, dist, time) == 0);
+        time[3 * 5 + 2] = 1;
+        assert(applyObservedArcs(modRequest, 1, nodeCount, dist, time) == 1);
+        assert(time[3 * 5 + 2] == 316);
+
+        // 같은 assigned 를 다시 보내도 표본이 늘지 않고, 같은 위치의 다른 trip 은 새 관측
+        size_t recorded = g_observedArcs.stats().recorded;
+        recordObservedArcs(modRequest, arcs);
+        assert(g_observedArcs.stats().recorded == recorded);
+        auto trip = modRequest;
+        trip.onboardWaitingDemands[0].id = "w2";
+        trip.assigned[0].routeOrder = { { "w2", 1 }, { "o1", -1 }, { "w2", -1 } };
+        auto tripArcs = collectAssignedArcs(trip);
+        assert(tripArcs[1].vehicle == 0);
+        recordObservedArcs(trip, tripArcs);
+        assert(g_observedArcs.stats().recorded == recorded + 2);
+        assert(applyObservedArcs(modRequest, 1, nodeCount, dist, time) == 1);
+        assert(time[3 * 5 + 2] == 313);
+
+        // 관측값이 충분한 arc 는 조회 전에 known arc 로 tile 에서 제외 (fillInfeasible 은 채우지 않음)
+        auto observed = collectObservedArcs(modRequest, nodeCount);
+        assert(observed.size() == 1 && observed[0].from == 2 && observed[0].to == 1 && observed[0].time == 313);
+        CArcPruner pruner(modRequest, { 0, 1, 2, 3 }, 0);
+        pruner.setKnownArcs(knownArcKeys(observed, nodeCount));
+        std::vector<int> destinations = { 0, 1, 3 };
+        assert(pruner.filter(2, destinations) == 1);
+        assert((destinations == std::vector<int>{ 0, 3 }));
+        auto tiles = planReachableTiles({ 2 }, { 1, 3 }, std::vector<int>(nodeCount, -1), 10, &pruner);
+        assert(tiles.size() == 1 && (tiles[0].destinations == std::vector<int>{ 3 }));
+        assert(pruner.fillInfeasible(1, nodeCount, dist, time) == 0);
+
+        g_queryPlanPolicy.observedMinSamples = 0;
+        time[3 * 5 + 2] = 1;
+        assert(applyObservedArcs(modRequest, 1, nodeCount, dist, time) == 0);
+        g_queryPlanPolicy.observedMinSamples = 3;
+        g_observedArcs.clear();
+
+        // 가득 차면 가장 오래 전에 갱신한 위치 쌍 하나만 지움
+        CObservedArcStore store;
+        store.record("K0", "X", 0, 10, 10, "o0");
+        store.record("K1", "X", 0, 10, 10, "o1");
+        for (size_t i = 2; i < OBSERVED_ARC_MAX_ENTRIES; i++) {
+            store.record("K" + std::to_string(i), "X", 0, 10, 10, "o" + std::to_string(i));
+        }
+        store.record("K0", "X", 0, 20, 20, "o0");
+        store.record("K" + std::to_string(OBSERVED_ARC_MAX_ENTRIES), "X", 0, 10, 10, "new");
+        assert(store.stats().pairs == OBSERVED_ARC_MAX_ENTRIES);
+        int64_t d, t;
+        assert(store.lookup("K0", "X", 0, 1, d, t) && t == 12);
+        assert(!store.lookup("K1", "X", 0, 1, d, t));
+        assert(store.lookup("K2", "X", 0, 1, d, t));
+    }
+};
+
+int main(int argc, char **argv) {
+    CQueryPlannerTest test;
+    test.testGroupOverlapping();
+    test.testDisjointNotGrouped();
+    test.testMaxSources();
+    test.testAssignedArcs();
+    test.testFixedAssignment();
+    test.testCandidateVehicles();
+    test.testArcPruner();
+    test.testCoordinateDedup();
+    test.testVehicleRowCache();
+    test.testVehicleRowPrefetch();
+    test.testSnapCache();
+    test.testObservedArcs();
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <cassert>
+#include <sstream>
+#include <iomanip>
+#include <requestBuilder.h>
+
+class CRequestBuilderTest {
+protected:
+    std::vector<Location> locs;
+
+public:
+    void SetUp() {
+        locs = {
+            { 127.02758, 37.49794, -1 },
+            { 126.9779692, 37.566535, 90 },
+            { -0.1, -33.123456789, 0 },
+            { 0.0, 0.0, 359 },
+        };
+    }
+
+    // 기존 ostringstream 기반 형식과 동일해야 함
+    void testOsrmCoordinate() {
+        CLocationFragments fragments(locs, CLocationFragments::OSRM_COORDINATE);
+        assert(fragments.size() == locs.size());
+        for (size_t i = 0; i < locs.size(); i++) {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(8) << locs[i].lng << "," << locs[i].lat;
+            assert(fragments[i] == oss.str());
+            assert(fragments[i].size() <= fragments.maxLength());
+        }
+    }
+
+    void testValhallaLocation() {
+        CLocationFragments fragments(locs, CLocationFragments::VALHALLA_LOCATION);
+        for (size_t i = 0; i < locs.size(); i++) {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(8) << "{\"lat\":" << locs[i].lat << ",\"lon\":" << locs[i].lng;
+            if (locs[i].direction != -1) oss << ",\"heading\":" << locs[i].direction;
+            oss << "}";
+            assert(fragments[i] == oss.str());
+        }
+    }
+
+    void testBufferWriter() {
+        CBufferWriter writer;
+        writer.append("a=").appendInt(-12).append(';').appendInt(0).append(';').appendFixed(1.5, 2);
+        assert(writer.view() == "a=-12;0;1.50");
+        std::string str = writer.release();
+        assert(str == "a=-12;0;1.50");
+    }
+};
+
+int main(int argc, char **argv) {
+    CRequestBuilderTest test;
+    test.SetUp();
+    test.testOsrmCoordinate();
+    test.testValhallaLocation();
+    test.testBufferWriter();
+    return 0;
+}
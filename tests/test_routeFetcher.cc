@@ -0,0 +1,300 @@
+#include <cassert>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cpp-httplib/httplib.h>
+#include <routeFetcher.h>
+#include <costEstimator.h>
+
+// 127.0.0.1 의 빈 port 로 띄우는 routing backend (test 마다 새 url 이라 backend, circuit breaker 상태를 공유하지 않음)
+class CTestBackend {
+public:
+    httplib::Server server;
+    std::atomic<int> hits{0};
+
+    CTestBackend() {
+        m_port = server.bind_to_any_port("127.0.0.1");
+    }
+
+    ~CTestBackend() {
+        server.stop();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void start() {
+        m_thread = std::thread([this]() { server.listen_after_bind(); });
+        server.wait_until_ready();
+    }
+
+    std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(m_port);
+    }
+
+private:
+    int m_port;
+    std::thread m_thread;
+};
+
+static int64_t elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<std::shared_ptr<RouteFetchRequest>> makeRequests(const std::string& path, size_t count)
+{
+    std::vector<std::shared_ptr<RouteFetchRequest>> requests;
+    for (size_t i = 0; i < count; i++) {
+        requests.push_back(std::make_shared<RouteFetchRequest>(path + "?tile=" + std::to_string(i), ""));
+    }
+    return requests;
+}
+
+class CRouteFetcherTest {
+public:
+    void testRetryBackoff() {
+        // 5xx 두번 후 성공: 재시도마다 retryBackoff * 2^(n-1) * [0.5, 1.5) 를 기다림
+        g_routeFetchPolicy = RouteFetchPolicy();
+        g_routeFetchPolicy.retryBackoff = 40;
+        g_routeFetchPolicy.maxRetries = 2;
+        CTestBackend backend;
+        std::vector<std::chrono::steady_clock::time_point> arrivals;
+        std::mutex mutex;
+        backend.server.Get("/table", [&](const httplib::Request&, httplib::Response& res) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                arrivals.push_back(std::chrono::steady_clock::now());
+            }
+            if (++backend.hits <= 2) {
+                res.status = 503;
+            } else {
+                res.set_content("ok", "text/plain");
+            }
+        });
+        backend.start();
+
+        std::string body;
+        auto failed = fetchRouteTiles("TEST", backend.url(), 4, makeRequests("/table", 1),
+            [&](size_t tileIdx, std::string& response) { body = response; }, false);
+        assert(failed.empty());
+        assert(body == "ok");
+        assert(backend.hits == 3);
+        assert(arrivals.size() == 3);
+        auto firstDelay = std::chrono::duration_cast<std::chrono::milliseconds>(arrivals[1] - arrivals[0]).count();
+        auto secondDelay = std::chrono::duration_cast<std::chrono::milliseconds>(arrivals[2] - arrivals[1]).count();
+        assert(firstDelay >= 20);
+        assert(secondDelay >= 40);
+
+        // 재시도를 소진하면 실패한 tile 로 반환
+        backend.hits = 0;
+        g_routeFetchPolicy.maxRetries = 1;
+        failed = fetchRouteTiles("TEST", backend.url(), 4, makeRequests("/table", 1),
+            [&](size_t tileIdx, std::string& response) { assert(false); }, false);
+        assert(failed.size() == 1 && failed[0] == 0);
+        assert(backend.hits == 2);
+    }
+
+    void testNoRetryOnClientError() {
+        // 4xx 는 재시도해도 같은 결과
+        g_routeFetchPolicy = RouteFetchPolicy();
+        CTestBackend backend;
+        backend.server.Get("/table", [&](const httplib::Request&, httplib::Response& res) {
+            backend.hits++;
+            res.status = 400;
+        });
+        backend.start();
+
+        auto failed = fetchRouteTiles("TEST", backend.url(), 4, makeRequests("/table", 2),
+            [&](size_t tileIdx, std::string& response) { assert(false); }, false);
+        assert(failed.size() == 2);
+        assert(backend.hits == 2);
+    }
+
+    void testHedge() {
+        // 관측된 p95 를 넘긴 tile 은 한번 더 보내고 먼저 온 응답을 사용
+        g_routeFetchPolicy = RouteFetchPolicy();
+        g_routeFetchPolicy.hedgeMinDelay = 20;
+        CTestBackend backend;
+        backend.server.Get("/table", [&](const httplib::Request&, httplib::Response& res) {
+            if (++backend.hits == 1) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+                res.set_content("slow", "text/plain");
+            } else {
+                res.set_content("fast", "text/plain");
+            }
+        });
+        backend.start();
+        auto backends = getRouteBackends(backend.url());
+        for (int i = 0; i < 20; i++) {
+            backends[0]->latency().record(10);
+        }
+
+        std::string body;
+        auto start = std::chrono::steady_clock::now();
+        auto failed = fetchRouteTiles("TEST", backend.url(), 4, makeRequests("/table", 1),
+            [&](size_t tileIdx, std::string& response) { body = response; }, false);
+        assert(failed.empty());
+        assert(body == "fast");
+        assert(backend.hits == 2);
+        assert(elapsedMs(start) < 500);
+
+        // hedge 를 끄면 느린 응답을 기다림
+        backend.hits = 0;
+        g_routeFetchPolicy.hedge = false;
+        start = std::chrono::steady_clock::now();
+        failed = fetchRouteTiles("TEST", backend.url(), 4, makeRequests("/table", 1),
+            [&](size_t tileIdx, std::string& response) { body = response; }, false);
+        assert(failed.empty());
+        assert(body == "slow");
+        assert(backend.hits == 1);
+        assert(elapsedMs(start) >= 900);
+    }
+
+    void testBudget() {
+        // budget 안에 응답하지 않은 tile 은 기다리지 않고 실패로 반환, backend 의 circuit breaker 에 실패로 기록
+        g_routeFetchPolicy = RouteFetchPolicy();
+        g_routeFetchPolicy.budget = 100;
+        g_routeFetchPolicy.hedge = false;
+        g_costEstimatePolicy.breakerFailures = 1;
+        CTestBackend backend;
+        backend.server.Get("/table", [&](const httplib::Request& req, httplib::Response& res) {
+            backend.hits++;
+            if (req.get_param_value("tile") == "1") {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+            }
+            res.set_content("ok", "text/plain");
+        });
+        backend.start();
+
+        std::vector<size_t> received;
+        auto start = std::chrono::steady_clock::now();
+        auto failed = fetchRouteTiles("TEST", backend.url(), 4, makeRequests("/table", 3),
+            [&](size_t tileIdx, std::string& response) { received.push_back(tileIdx); }, false);
+        assert(elapsedMs(start) < 500);
+        assert(failed.size() == 1 && failed[0] == 1);
+        assert(received.size() == 2);
+        assert(getCircuitBreaker(backend.url()).state() == CCircuitBreaker::OPEN);
+        g_costEstimatePolicy = CostEstimatePolicy();
+        g_routeFetchPolicy = RouteFetchPolicy();
+    }
+
+    void testLeastOutstanding() {
+        // 처리 중인 요청이 적은 backend 로 보냄
+        g_routeFetchPolicy = RouteFetchPolicy();
+        CTestBackend first, second;
+        for (auto backend : { &first, &second }) {
+            backend->server.Get("/table", [backend](const httplib::Request&, httplib::Response& res) {
+                backend->hits++;
+                res.set_content("ok", "text/plain");
+            });
+            backend->start();
+        }
+        std::string routePath = first.url() + "," + second.url();
+        auto backends = getRouteBackends(routePath);
+        assert(backends.size() == 2);
+
+        backends[0]->acquire();
+        auto failed = fetchRouteTiles("TEST", routePath, 4, makeRequests("/table", 1), [](size_t, std::string&) {}, false);
+        assert(failed.empty());
+        assert(first.hits == 0 && second.hits == 1);
+        backends[0]->release();
+
+        backends[1]->acquire();
+        backends[1]->acquire();
+        backends[0]->acquire();
+        failed = fetchRouteTiles("TEST", routePath, 4, makeRequests("/table", 1), [](size_t, std::string&) {}, false);
+        assert(failed.empty());
+        assert(first.hits == 1 && second.hits == 1);
+        backends[0]->release();
+        backends[1]->release();
+        backends[1]->release();
+    }
+
+    void testPerBackendLimit() {
+        // backend 마다 routeTasks 개 까지만 동시에 보내고, backend 를 늘리면 동시 요청 수도 늘어남
+        g_routeFetchPolicy = RouteFetchPolicy();
+        g_routeFetchPolicy.hedge = false;
+        CTestBackend first, second;
+        std::atomic<int> running[2] = { {0}, {0} };
+        std::atomic<int> peak[2] = { {0}, {0} };
+        int idx = 0;
+        for (auto backend : { &first, &second }) {
+            backend->server.Get("/table", [&, backend, idx](const httplib::Request&, httplib::Response& res) {
+                backend->hits++;
+                int now = ++running[idx];
+                int prev = peak[idx];
+                while (now > prev && !peak[idx].compare_exchange_weak(prev, now)) {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                running[idx]--;
+                res.set_content("ok", "text/plain");
+            });
+            backend->start();
+            idx++;
+        }
+
+        std::vector<size_t> received;
+        auto start = std::chrono::steady_clock::now();
+        auto failed = fetchRouteTiles("TEST", first.url() + "," + second.url(), 2, makeRequests("/table", 8),
+            [&](size_t tileIdx, std::string&) { received.push_back(tileIdx); }, false);
+        assert(failed.empty() && received.size() == 8);
+        assert(peak[0] <= 2 && peak[1] <= 2);
+        assert(first.hits + second.hits == 8);
+        assert(first.hits > 0 && second.hits > 0);
+        // 8 tile / (2 backend x 2) = 50 ms 씩 2번
+        assert(elapsedMs(start) >= 90);
+    }
+
+    void testEjection() {
+        // 연속으로 3번 실패한 backend 는 제외하고, 실패한 tile 은 다른 backend 로 재시도
+        g_routeFetchPolicy = RouteFetchPolicy();
+        g_routeFetchPolicy.hedge = false;
+        g_routeFetchPolicy.retryBackoff = 1;
+        CTestBackend broken, healthy;
+        broken.server.Get("/table", [&](const httplib::Request&, httplib::Response& res) {
+            broken.hits++;
+            res.status = 503;
+        });
+        healthy.server.Get("/table", [&](const httplib::Request&, httplib::Response& res) {
+            healthy.hits++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            res.set_content("ok", "text/plain");
+        });
+        broken.start();
+        healthy.start();
+
+        std::string routePath = broken.url() + "," + healthy.url();
+        std::vector<size_t> received;
+        auto failed = fetchRouteTiles("TEST", routePath, 1, makeRequests("/table", 6),
+            [&](size_t tileIdx, std::string&) { received.push_back(tileIdx); }, false);
+        assert(failed.empty() && received.size() == 6);
+        assert(broken.hits == 3);
+        assert(healthy.hits == 6);
+        auto backends = getRouteBackends(routePath);
+        assert(backends[0]->isEjected(std::chrono::steady_clock::now()));
+        assert(!backends[1]->isEjected(std::chrono::steady_clock::now()));
+
+        // 제외된 backend 에는 보내지 않음
+        failed = fetchRouteTiles("TEST", routePath, 1, makeRequests("/table", 2), [](size_t, std::string&) {}, false);
+        assert(failed.empty());
+        assert(broken.hits == 3);
+        assert(healthy.hits == 8);
+        resetCircuitBreakers();
+    }
+};
+
+int main(int argc, char **argv) {
+    CRouteFetcherTest test;
+    test.testRetryBackoff();
+    test.testNoRetryOnClientError();
+    test.testHedge();
+    test.testBudget();
+    test.testLeastOutstanding();
+    test.testPerBackendLimit();
+    test.testEjection();
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <cassert>
+#include <vector>
+#include <solverPortfolio.h>
+#include <modState.h>
+
+class CSolverPortfolioTest {
+public:
+    // vehicle 1 개 (node 1), waiting demand 1 개 (node 2, 3)
+    size_t nodeCount = 3;
+    size_t vehicleCount = 1;
+    std::vector<int64_t> cost = {
+        0, 0, 0, 0,
+        0, 0, 10, 30,
+        0, 10, 0, 20,
+        0, 30, 20, 0,
+    };
+
+    CModState makeState() {
+        CModState modState(nodeCount, vehicleCount);
+        modState.vehicleCapacities[0] = 4;
+        modState.startDepots[0] = 1;
+        modState.demands[2] = 1;
+        modState.demands[3] = -1;
+        modState.deliverySibling[2] = 3;
+        modState.pickupSibling[3] = 2;
+        std::fill(modState.latestArrival.begin(), modState.latestArrival.end(), 7200);
+        std::fill(modState.acceptableArrival.begin(), modState.acceptableArrival.end(), 7200);
+        return modState;
+    }
+
+    void testParameters() {
+        auto ap = default_algorithm_parameters();
+        auto same = portfolioParameters(ap, 0);
+        assert(same.seed == ap.seed);
+        std::vector<int> seeds = { ap.seed };
+        for (int k = 1; k < 8; k++) {
+            auto parameter = portfolioParameters(ap, k);
+            assert(parameter.time_limit == ap.time_limit);
+            for (int seed : seeds) {
+                assert(parameter.seed != seed);
+            }
+            seeds.push_back(parameter.seed);
+        }
+        assert(portfolioParameters(ap, 1).removal_req_iteration_control_e > ap.removal_req_iteration_control_e);
+        assert(portfolioParameters(ap, 2).removal_req_iteration_control_e < ap.removal_req_iteration_control_e);
+    }
+
+    void testRemainingTimeLimit() {
+        auto ap = default_algorithm_parameters();
+        ap.time_limit = 3;
+        auto now = std::chrono::steady_clock::now();
+        assert(remainingTimeLimit(ap, now) == 3);
+        assert(remainingTimeLimit(ap, now - std::chrono::milliseconds(1500)) == 1);
+        // 1초가 남지 않으면 풀지 않음
+        assert(remainingTimeLimit(ap, now - std::chrono::milliseconds(2500)) == -1);
+        assert(remainingTimeLimit(ap, now - std::chrono::seconds(10)) == -1);
+        ap.time_limit = 0;
+        assert(remainingTimeLimit(ap, now - std::chrono::seconds(10)) == 0);
+    }
+
+    void testCompare() {
+        auto modState = makeState();
+        SolveInput input{ nodeCount, vehicleCount, cost, cost, cost, modState };
+
+        int shortPath[] = { 1, 2, 3, 0 };
+        int longPath[] = { 1, 3, 2, 0 };
+        int vehicles[] = { 0 };
+        Route shortRoute{ shortPath, nullptr, 4 };
+        Route longRoute{ longPath, nullptr, 4 };
+        Solution a{};
+        a.n_routes = 1;
+        a.routes = &shortRoute;
+        a.vehicles = vehicles;
+        Solution b = a;
+        b.routes = &longRoute;
+        assert(solutionCost(input, &a) == 30);
+        assert(solutionCost(input, &b) == 50);
+        assert(isBetterSolution(input, &a, &b));
+        assert(!isBetterSolution(input, &b, &a));
+        assert(isBetterSolution(input, &b, nullptr));
+        assert(!isBetterSolution(input, nullptr, &b));
+
+        // 배정하지 못한 demand 가 적은 solution 이 cost 와 상관없이 좋음
+        int missing[] = { 2 };
+        a.n_missing = 1;
+        a.missing = missing;
+        assert(isBetterSolution(input, &b, &a));
+    }
+
+    void testSolve() {
+        auto modState = makeState();
+        SolveInput input{ nodeCount, vehicleCount, cost, cost, cost, modState };
+        auto ap = default_algorithm_parameters();
+        ap.time_limit = 1;
+        auto single = solveLns(input, &ap);
+        assert(single != nullptr);
+        auto best = solvePortfolio(input, &ap, 4, false);
+        assert(best != nullptr);
+        assert(!isBetterSolution(input, single, best));
+        delete_solution(single);
+        delete_solution(best);
+
+        // time_limit 이 지난 요청은 풀지 않음
+        best = solvePortfolio(input, &ap, 4, false, std::chrono::steady_clock::now() - std::chrono::seconds(5));
+        assert(best == nullptr);
+    }
+
+    void testSolveConcurrently() {
+        auto modState = makeState();
+        auto excluded = makeState();
+        excluded.fixedAssignment[2] = -1;
+        excluded.fixedAssignment[3] = -1;
+        std::vector<SolveInput> inputs = {
+            { nodeCount, vehicleCount, cost, cost, cost, modState },
+            { nodeCount, vehicleCount, cost, cost, cost, excluded },
+        };
+        for (int k = 0; k < 16; k++) {
+            inputs.push_back({ nodeCount, vehicleCount, cost, cost, cost, modState });
+        }
+        auto ap = default_algorithm_parameters();
+        ap.time_limit = 1;
+        auto begin = std::chrono::steady_clock::now();
+        auto solutions = solveConcurrently(inputs, &ap, 2, false);
+        // alternative 가 모두 pool 에서 기다려도 time_limit 과 여유 시간 안에 끝남
+        assert(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(ap.time_limit * 1000 + 500));
+        assert(solutions.size() == inputs.size());
+        assert(solutions[0] != nullptr);
+        for (auto solution : solutions) {
+            if (solution != nullptr) {
+                delete_solution(solution);
+            }
+        }
+    }
+};
+
+int main(int argc, char **argv) {
+    // 작은 요청이므로 exact 탐색을 끄고 portfolio 만 확인
+    g_solvePolicy.exactMaxNodes = 0;
+    CSolverPortfolioTest test;
+    test.testParameters();
+    test.testRemainingTimeLimit();
+    test.testCompare();
+    test.testSolve();
+    test.testSolveConcurrently();
+    return 0;
+}